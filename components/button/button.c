@@ -1,15 +1,46 @@
 #include "button.h"
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "esp_attr.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
 #include "hal/gpio_types.h"
+#include "sdkconfig.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
 
 ESP_EVENT_DEFINE_BASE(BUTTON_EVENTS);
 
 static bool isr_service_installed = false;
 
+// Edges posted from the ISR carry the state in bit 0 and the low 31 bits
+// of the timestamp above it, an ISR post holds only 4 bytes
+#define EDGE_TIME_MASK 0x7FFFFFFFu
+
+typedef struct button_edge_binding {
+  gpio_num_t pin;
+  esp_event_handler_t handler;
+  void *arg;
+} button_edge_binding_t;
+
+// Edge-first state is changed by the GPIO ISR and the lockout timer ISR,
+// which can run on different cores
+static portMUX_TYPE edge_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Reads the input registers directly, gpio_get_level may be in flash
+// while the ISRs run with the cache disabled
+uint64_t IRAM_ATTR _button_read_inputs(void) {
+  uint64_t in = REG_READ(GPIO_IN_REG);
+#if SOC_GPIO_PIN_COUNT > 32
+  in |= (uint64_t)REG_READ(GPIO_IN1_REG) << 32;
+#endif
+  return in;
+}
+
 bool _button_get_raw_state(button_t *btn) {
   bool ret = gpio_get_level(btn->pin);
   return ret ^ btn->_active_low;
@@ -44,9 +75,88 @@ void _debounce_timer_callback(void *arg) {
   }
 }
 
+void IRAM_ATTR _button_post_edge(button_t *btn, bool state, int64_t now,
+                                  BaseType_t *task_woken) {
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+  uint32_t edge = (((uint32_t)now & EDGE_TIME_MASK) << 1) | state;
+  esp_event_isr_post(BUTTON_EVENTS, BUTTON_EDGE_EVENT_ID(btn->pin), &edge,
+                     sizeof(edge), task_woken);
+#endif
+}
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+void IRAM_ATTR _lockout_timer_callback(void *arg) {
+  button_t *btn = (button_t *)arg;
+  int64_t now = esp_timer_get_time();
+
+  // an edge ignored during the lockout is reported now, the edge ISR
+  // must not run between the check and the unlock
+  portENTER_CRITICAL_ISR(&edge_lock);
+  bool state = ((_button_read_inputs() >> btn->pin) & 1) ^ btn->_active_low;
+  if (state == btn->_state_info.state) {
+    btn->_locked = false;
+    portEXIT_CRITICAL_ISR(&edge_lock);
+    return;
+  }
+  btn->_state_info.state = state;
+  btn->_state_info.timestamp = now;
+  portEXIT_CRITICAL_ISR(&edge_lock);
+
+  BaseType_t task_woken = pdFALSE;
+  _button_post_edge(btn, state, now, &task_woken);
+  esp_timer_start_once(btn->_lockout_timer,
+                       btn->debounce_cfg.debounce_checks *
+                           btn->debounce_cfg.debounce_interval_ms * 1000);
+  if (task_woken) {
+    esp_timer_isr_dispatch_need_yield();
+  }
+}
+#endif
+
+void _button_edge_event_handler(void *handler_args, esp_event_base_t base,
+                                int32_t id, void *event_data) {
+  button_edge_binding_t *binding = (button_edge_binding_t *)handler_args;
+  uint32_t edge = *(uint32_t *)event_data;
+
+  // the event is younger than 2^31 us, so the time since it fits the mask
+  int64_t now = esp_timer_get_time();
+  button_state_info_t state_info = {
+      .state = edge & 1,
+      .timestamp = now - (((uint32_t)now - (edge >> 1)) & EDGE_TIME_MASK),
+  };
+  binding->handler(binding->arg, base, binding->pin, &state_info);
+}
+
 void IRAM_ATTR _button_isr_handler(void *args) {
   button_t *btn = (button_t *)args;
 
+  if (btn->_mode == BUTTON_DEBOUNCE_EDGE_FIRST) {
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&edge_lock);
+    bool state = ((_button_read_inputs() >> btn->pin) & 1) ^ btn->_active_low;
+    if (btn->_locked || state == btn->_state_info.state) {
+      portEXIT_CRITICAL_ISR(&edge_lock);
+      return;
+    }
+    btn->_locked = true;
+    btn->_state_info.state = state;
+    btn->_state_info.timestamp = now;
+    portEXIT_CRITICAL_ISR(&edge_lock);
+
+    BaseType_t task_woken = pdFALSE;
+    _button_post_edge(btn, state, now, &task_woken);
+    esp_timer_start_once(btn->_lockout_timer,
+                         btn->debounce_cfg.debounce_checks *
+                             btn->debounce_cfg.debounce_interval_ms * 1000);
+    if (task_woken) {
+      portYIELD_FROM_ISR(task_woken);
+    }
+#endif
+    return;
+  }
+
   btn->_raw_state = gpio_get_level(btn->pin);
 
   esp_timer_start_periodic(btn->_debounce_timer,
@@ -84,6 +194,10 @@ esp_err_t button_init(button_t *btn, gpio_num_t pin, bool active_low) {
   btn->_debounce_counter = 0;
   btn->debounce_cfg.debounce_checks = 5;
   btn->debounce_cfg.debounce_interval_ms = 10;
+  btn->_mode = BUTTON_DEBOUNCE_STABLE;
+  btn->_locked = false;
+  btn->_lockout_timer = NULL;
+  btn->_edge_binding = NULL;
 
   _button_init_debounce_timer(btn);
 
@@ -97,6 +211,36 @@ esp_err_t button_init(button_t *btn, gpio_num_t pin, bool active_low) {
   return ret;
 }
 
+void _button_remove_event_handler(button_t *btn) {
+  button_edge_binding_t *binding = btn->_edge_binding;
+  if (binding == NULL) return;
+
+  // once unregistered the event loop no longer holds the binding
+  esp_event_handler_unregister(BUTTON_EVENTS, btn->pin, binding->handler);
+  esp_event_handler_unregister(BUTTON_EVENTS, BUTTON_EDGE_EVENT_ID(btn->pin),
+                               _button_edge_event_handler);
+  btn->_edge_binding = NULL;
+  free(binding);
+}
+
+esp_err_t button_deinit(button_t *btn) {
+  esp_err_t ret = gpio_isr_handler_remove(btn->pin);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  esp_timer_stop(btn->_debounce_timer);
+  esp_timer_delete(btn->_debounce_timer);
+  btn->_debounce_timer = NULL;
+  if (btn->_lockout_timer != NULL) {
+    esp_timer_stop(btn->_lockout_timer);
+    esp_timer_delete(btn->_lockout_timer);
+    btn->_lockout_timer = NULL;
+  }
+  _button_remove_event_handler(btn);
+  return ret;
+}
+
 esp_err_t button_set_pullmode(button_t *btn, gpio_pull_mode_t pull) {
   return gpio_set_pull_mode(btn->pin, pull);
 }
@@ -110,15 +254,201 @@ esp_err_t button_set_debounce_conf(button_t *btn, button_debounce_cfg cfg) {
   return ret;
 }
 
+esp_err_t button_set_debounce_mode(button_t *btn,
+                                   button_debounce_mode_t mode) {
+  esp_err_t ret = ESP_OK;
+
+  if (mode == BUTTON_DEBOUNCE_EDGE_FIRST) {
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD && \
+    CONFIG_ESP_EVENT_POST_FROM_ISR
+    if (btn->_lockout_timer == NULL) {
+      const esp_timer_create_args_t timer_args = {
+          .callback = &_lockout_timer_callback,
+          .arg = btn,
+          .dispatch_method = ESP_TIMER_ISR,
+          .name = "lockout_timer"};
+
+      ret = esp_timer_create(&timer_args, &btn->_lockout_timer);
+      if (ret != ESP_OK) {
+        return ret;
+      }
+    }
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+  }
+
+  gpio_intr_disable(btn->pin);
+  esp_timer_stop(btn->_debounce_timer);
+  if (btn->_lockout_timer != NULL) {
+    esp_timer_stop(btn->_lockout_timer);
+  }
+  btn->_locked = false;
+  btn->_debounce_counter = 0;
+  btn->_mode = mode;
+  if (mode == BUTTON_DEBOUNCE_EDGE_FIRST) {
+    btn->_state_info.state = _button_get_raw_state(btn);
+  }
+  gpio_intr_enable(btn->pin);
+
+  return ret;
+}
+
 esp_err_t button_set_event_handler(button_t *btn, esp_event_handler_t handler,
                                    void *event_handler_arg) {
   esp_err_t ret = ESP_OK;
 
+  _button_remove_event_handler(btn);
+
+  // edges posted from the ISR reach the same handler
+  button_edge_binding_t *binding = malloc(sizeof(button_edge_binding_t));
+  if (binding == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  binding->pin = btn->pin;
+  binding->handler = handler;
+  binding->arg = event_handler_arg;
+
   ret = esp_event_handler_register(BUTTON_EVENTS, btn->pin, handler,
                                    event_handler_arg);
+  if (ret != ESP_OK) {
+    free(binding);
+    return ret;
+  }
+  ret = esp_event_handler_register(BUTTON_EVENTS, BUTTON_EDGE_EVENT_ID(btn->pin),
+                                   _button_edge_event_handler, binding);
+  if (ret != ESP_OK) {
+    esp_event_handler_unregister(BUTTON_EVENTS, btn->pin, handler);
+    free(binding);
+    return ret;
+  }
+  btn->_edge_binding = binding;
   return ret;
 }
 
 button_state_info_t button_get_state_info(button_t *btn) {
   return btn->_state_info;
 }
+
+void _button_group_scan_callback(void *arg) {
+  button_group_t *grp = (button_group_t *)arg;
+
+  uint64_t pressed = (_button_read_inputs() ^ grp->_active_low) &
+                     grp->_pins;
+  uint64_t delta = pressed ^ grp->_state;
+
+  // count samples that differ from the state, restart on a matching one
+  uint64_t carry = delta;
+  uint64_t reached = delta;
+  for (int i = 0; i < BUTTON_GROUP_COUNTER_BITS; i++) {
+    uint64_t next = grp->_counter[i] & carry;
+    grp->_counter[i] = (grp->_counter[i] ^ carry) & delta;
+    carry = next;
+    reached &= (grp->debounce_cfg.debounce_checks >> i) & 1
+                   ? grp->_counter[i]
+                   : ~grp->_counter[i];
+  }
+  if (!reached) return;
+
+  for (int i = 0; i < BUTTON_GROUP_COUNTER_BITS; i++) {
+    grp->_counter[i] &= ~reached;
+  }
+  grp->_state ^= reached;
+  grp->_timestamp = esp_timer_get_time();
+
+  button_group_event_t event = {
+      .state = grp->_state,
+      .changed = reached,
+      .timestamp = grp->_timestamp,
+  };
+  esp_event_post(BUTTON_EVENTS, BUTTON_GROUP_EVENT_ID, &event,
+                 sizeof(button_group_event_t), 0);
+}
+
+esp_err_t button_group_init(button_group_t *grp, button_debounce_cfg cfg) {
+  memset(grp, 0, sizeof(button_group_t));
+  grp->_timestamp = esp_timer_get_time();
+  grp->debounce_cfg = cfg;
+  if (grp->debounce_cfg.debounce_checks < 1) {
+    grp->debounce_cfg.debounce_checks = 1;
+  }
+  if (grp->debounce_cfg.debounce_checks >= (1 << BUTTON_GROUP_COUNTER_BITS)) {
+    grp->debounce_cfg.debounce_checks = (1 << BUTTON_GROUP_COUNTER_BITS) - 1;
+  }
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = &_button_group_scan_callback,
+      .arg = grp,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "button_scan"};
+
+  return esp_timer_create(&timer_args, &grp->_scan_timer);
+}
+
+esp_err_t button_group_add(button_group_t *grp, gpio_num_t pin,
+                           bool active_low, gpio_pull_mode_t pull) {
+  esp_err_t ret = ESP_OK;
+
+  if (grp->_running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  gpio_config_t io_conf = {.pin_bit_mask = (1ULL << pin),
+                           .mode = GPIO_MODE_INPUT,
+                           .pull_up_en = GPIO_PULLUP_DISABLE,
+                           .pull_down_en = GPIO_PULLDOWN_DISABLE,
+                           .intr_type = GPIO_INTR_DISABLE};
+  ret = gpio_config(&io_conf);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  ret = gpio_set_pull_mode(pin, pull);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  grp->_pins |= 1ULL << pin;
+  if (active_low) {
+    grp->_active_low |= 1ULL << pin;
+  } else {
+    grp->_active_low &= ~(1ULL << pin);
+  }
+  return ret;
+}
+
+esp_err_t button_group_start(button_group_t *grp) {
+  if (grp->_running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // buttons held at start are pressed without an event
+  grp->_state = (_button_read_inputs() ^ grp->_active_low) & grp->_pins;
+  memset(grp->_counter, 0, sizeof(grp->_counter));
+
+  esp_err_t ret = esp_timer_start_periodic(
+      grp->_scan_timer, grp->debounce_cfg.debounce_interval_ms * 1000);
+  if (ret == ESP_OK) {
+    grp->_running = true;
+  }
+  return ret;
+}
+
+esp_err_t button_group_stop(button_group_t *grp) {
+  if (!grp->_running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  grp->_running = false;
+  return esp_timer_stop(grp->_scan_timer);
+}
+
+esp_err_t button_group_set_event_handler(button_group_t *grp,
+                                         esp_event_handler_t handler,
+                                         void *event_handler_arg) {
+  return esp_event_handler_register(BUTTON_EVENTS, BUTTON_GROUP_EVENT_ID,
+                                    handler, event_handler_arg);
+}
+
+bool button_group_get_state(button_group_t *grp, gpio_num_t pin) {
+  return (grp->_state >> pin) & 1;
+}
@@ -20,6 +20,14 @@ typedef struct {
   uint8_t debounce_interval_ms;
 } button_debounce_cfg;
 
+typedef enum {
+  // Report a change after debounce_checks equal samples
+  BUTTON_DEBOUNCE_STABLE,
+  // Report the first edge from the ISR, then ignore edges for
+  // debounce_checks * debounce_interval_ms
+  BUTTON_DEBOUNCE_EDGE_FIRST,
+} button_debounce_mode_t;
+
 typedef struct {
   gpio_num_t pin;
   bool _active_low;
@@ -30,13 +38,65 @@ typedef struct {
   uint8_t _debounce_counter;
   esp_timer_handle_t _debounce_timer;
   button_debounce_cfg debounce_cfg;
+
+  button_debounce_mode_t _mode;
+  volatile bool _locked;
+  esp_timer_handle_t _lockout_timer;
+
+  struct button_edge_binding *_edge_binding;
 } button_t;
 
+// Bits of the vertical debounce counters, debounce_checks up to 15
+#define BUTTON_GROUP_COUNTER_BITS 4
+
+// Event id of button group changes, the ids below are pin numbers
+#define BUTTON_GROUP_EVENT_ID 0x100
+
+// Event id of edges posted from the ISR in BUTTON_DEBOUNCE_EDGE_FIRST mode.
+// Handlers set with button_set_event_handler get them as pin events.
+#define BUTTON_EDGE_EVENT_ID(pin) (0x200 + (pin))
+
+// Posted with BUTTON_GROUP_EVENT_ID, one bit per GPIO number
+typedef struct {
+  uint64_t state;    // Debounced state, set while pressed
+  uint64_t changed;  // Buttons changed by this scan
+  int64_t timestamp;
+} button_group_event_t;
+
+// Buttons scanned together by one periodic timer. Every scan reads the
+// GPIO input registers once and debounces all buttons at the same time
+// with vertical counters, one counter bit of every button per word.
+typedef struct {
+  uint64_t _pins;
+  uint64_t _active_low;
+
+  uint64_t _state;
+  uint64_t _counter[BUTTON_GROUP_COUNTER_BITS];
+  int64_t _timestamp;
+
+  esp_timer_handle_t _scan_timer;
+  bool _running;
+  button_debounce_cfg debounce_cfg;
+} button_group_t;
+
 esp_err_t button_init(button_t *btn, gpio_num_t pin, bool active_low);
+esp_err_t button_deinit(button_t *btn);
 esp_err_t button_set_pullmode(button_t *btn, gpio_pull_mode_t pull);
 esp_err_t button_set_debounce_conf(button_t *btn, button_debounce_cfg cfg);
+esp_err_t button_set_debounce_mode(button_t *btn, button_debounce_mode_t mode);
+// Replaces the handler set before
 esp_err_t button_set_event_handler(button_t *btn, esp_event_handler_t handler,
                                    void *event_handler_arg);
 button_state_info_t button_get_state_info(button_t *btn);
 
+esp_err_t button_group_init(button_group_t *grp, button_debounce_cfg cfg);
+esp_err_t button_group_add(button_group_t *grp, gpio_num_t pin,
+                           bool active_low, gpio_pull_mode_t pull);
+esp_err_t button_group_start(button_group_t *grp);
+esp_err_t button_group_stop(button_group_t *grp);
+esp_err_t button_group_set_event_handler(button_group_t *grp,
+                                         esp_event_handler_t handler,
+                                         void *event_handler_arg);
+bool button_group_get_state(button_group_t *grp, gpio_num_t pin);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "blend.h"
+#include "mono.h"
+#include "aafont.h"
+
+#define TAG "AAFONT"
+
+static const AAFONT_GLYPH_t *aaGlyph(const AAFONT_t *font, uint8_t ascii) {
+	if (ascii < font->first || ascii >= font->first + font->count) return NULL;
+	return &font->glyphs[ascii - font->first];
+}
+
+// Measure string drawn with lcdDrawAAString
+// Returns width in pixels
+uint16_t lcdMeasureAAString(const AAFONT_t *font, const uint8_t *ascii) {
+	uint16_t w = 0;
+	for (; *ascii; ascii++) {
+		const AAFONT_GLYPH_t *g = aaGlyph(font, *ascii);
+		if (g) w += g->advance;
+	}
+	return w;
+}
+
+// Clip glyph columns to x1..x2 and rows to y1..y2
+// gx,gy:Top left of the glyph box
+static bool aaClip(const AAFONT_GLYPH_t *g, int gx, int gy, int x1, int y1, int x2, int y2, int *i0, int *i1, int *j0, int *j1) {
+	*i0 = (gx < x1) ? x1 - gx : 0;
+	*i1 = (gx + g->w > x2 + 1) ? x2 + 1 - gx : g->w;
+	*j0 = (gy < y1) ? y1 - gy : 0;
+	*j1 = (gy + g->h > y2 + 1) ? y2 + 1 - gy : g->h;
+	return (*i0 < *i1 && *j0 < *j1);
+}
+
+// Draw pixels at least half covered, one rectangle per run
+static void aaDrawRuns(TFT_t * dev, const AAFONT_t *font, const AAFONT_GLYPH_t *g, int gx, int gy, uint16_t color) {
+	int i0, i1, j0, j1;
+	if (!aaClip(g, gx, gy, 0, 0, dev->_width - 1, dev->_height - 1, &i0, &i1, &j0, &j1)) return;
+	uint16_t stride = (g->w * font->bpp + 7) / 8;
+	for (int j = j0; j < j1; j++) {
+		const uint8_t *row = &font->bitmaps[g->offset + j * stride];
+		int start = -1;
+		for (int i = i0; i <= i1; i++) {
+			bool on = (i < i1) && rgb565MaskAlpha(row, font->bpp, i) >= MONO_ALPHA_THRESHOLD;
+			if (on && start < 0) start = i;
+			if (!on && start >= 0) {
+				lcdDrawFillRect(dev, gx + start, gy + j, gx + i - 1, gy + j, color);
+				start = -1;
+			}
+		}
+	}
+}
+
+// Blend glyph into the frame buffer
+static void aaBlendGlyph(TFT_t * dev, const AAFONT_t *font, const AAFONT_GLYPH_t *g, int gx, int gy, uint16_t color) {
+	int i0, i1, j0, j1;
+	if (!aaClip(g, gx, gy, 0, 0, dev->_width - 1, dev->_height - 1, &i0, &i1, &j0, &j1)) return;
+	uint16_t stride = (g->w * font->bpp + 7) / 8;
+	for (int j = j0; j < j1; j++) {
+		rgb565BlendMask(&dev->_frame_buffer[(gy + j) * dev->_stride + gx + i0], color,
+			&font->bitmaps[g->offset + j * stride], font->bpp, i0, i1 - i0);
+	}
+}
+
+// Blend glyph against the fill color and send the cell x1..x2,y1..y2
+// Pixels of the glyph outside the cell are not drawn.
+static void aaSendCell(TFT_t * dev, const AAFONT_t *font, const AAFONT_GLYPH_t *g, int gx, int gy, int x1, int y1, int x2, int y2, uint16_t color) {
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 >= dev->_width) x2 = dev->_width - 1;
+	if (y2 >= dev->_height) y2 = dev->_height - 1;
+	if (x1 > x2 || y1 > y2) return;
+	int cw = x2 - x1 + 1;
+	int rows = AAFONT_WINDOW_MAX / cw;
+	int i0, i1, j0, j1;
+	bool visible = aaClip(g, gx, gy, x1, y1, x2, y2, &i0, &i1, &j0, &j1);
+	uint16_t stride = (g->w * font->bpp + 7) / 8;
+	uint16_t cell[AAFONT_WINDOW_MAX];
+
+	spi_master_write_command(dev, 0x2A);	// set column(x) address
+	spi_master_write_addr(dev, x1 + dev->_offsetx, x2 + dev->_offsetx);
+	spi_master_write_command(dev, 0x2B);	// set Page(y) address
+	spi_master_write_addr(dev, y1 + dev->_offsety, y2 + dev->_offsety);
+	spi_master_write_command(dev, 0x2C);	// Memory Write
+	for (int y = y1; y <= y2; y += rows) {
+		int n = (y2 - y + 1 < rows) ? y2 - y + 1 : rows;
+		for (int k = 0; k < n; k++) {
+			uint16_t *line = &cell[k * cw];
+			rgb565Fill(line, dev->_font_fill_color, cw);
+			int j = y + k - gy;
+			if (!visible || j < j0 || j >= j1) continue;
+			rgb565BlendMask(&line[gx + i0 - x1], color, &font->bitmaps[g->offset + j * stride], font->bpp, i0, i1 - i0);
+		}
+		spi_master_write_colors(dev, cell, n * cw);
+	}
+}
+
+// Draw anti-aliased character
+// x:X coordinate of the pen
+// y:Y coordinate of the baseline
+// ascii:ascii code
+// color:color
+// Returns X coordinate of the next character
+int lcdDrawAAChar(TFT_t * dev, const AAFONT_t *font, uint16_t x, uint16_t y, uint8_t ascii, uint16_t color) {
+	const AAFONT_GLYPH_t *g = aaGlyph(font, ascii);
+	if (g == NULL) return x;
+	int top = y - font->ascent + 1;
+	int gx = x + g->x;
+	int gy = top + g->y;
+	int x2 = x + g->advance - 1;
+	int y2 = top + font->height - 1;
+	bool fill = dev->_font_fill && g->advance > 0;
+
+	if (dev->_use_frame_buffer && !dev->_mono) {
+		if (fill) lcdDrawFillRect(dev, x, top, x2, y2, dev->_font_fill_color);
+		aaBlendGlyph(dev, font, g, gx, gy, color);
+	} else if (fill && !dev->_mono) {
+		aaSendCell(dev, font, g, gx, gy, x, top, x2, y2, color);
+	} else {
+		if (fill) lcdDrawFillRect(dev, x, top, x2, y2, dev->_font_fill_color);
+		aaDrawRuns(dev, font, g, gx, gy, color);
+	}
+	if (dev->_font_underline && g->advance > 0) {
+		lcdDrawFillRect(dev, x, y2 - 1, x2, y2, dev->_font_underline_color);
+	}
+	return x + g->advance;
+}
+
+// Draw anti-aliased string
+// x:X coordinate of the pen
+// y:Y coordinate of the baseline
+// ascii:String
+// color:color
+// Returns X coordinate after the string
+int lcdDrawAAString(TFT_t * dev, const AAFONT_t *font, uint16_t x, uint16_t y, const uint8_t *ascii, uint16_t color) {
+	if (font->bpp != 2 && font->bpp != 4) {
+		ESP_LOGE(TAG, "Unsupported bits per pixel %d.", font->bpp);
+		return x;
+	}
+	for (; *ascii; ascii++) x = lcdDrawAAChar(dev, font, x, y, *ascii, color);
+	return x;
+}
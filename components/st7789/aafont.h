@@ -0,0 +1,44 @@
+#ifndef MAIN_AAFONT_H_
+#define MAIN_AAFONT_H_
+
+#include "st7789.h"
+
+// Anti-aliased fonts.
+// Glyphs keep 2 or 4 bits of coverage per pixel, MSB first, each row
+// starting at a byte boundary. Only the bounding box of a glyph is stored
+// and every glyph has its own advance width. Fonts are compiled into the
+// application by tools/aafont2c.py.
+// Coverage is blended into the frame buffer, or against the fill color
+// of lcdSetFontFill when there is no frame buffer. Without a frame buffer
+// and without fill, and on the 1-bpp buffer, pixels are drawn when they
+// are at least half covered. Text is drawn horizontally only.
+
+// Pixels of one window sent without a frame buffer
+#define AAFONT_WINDOW_MAX 512
+
+typedef struct {
+	uint16_t offset;	// First byte of the coverage in bitmaps
+	uint8_t w;		// Bounding box
+	uint8_t h;
+	int8_t x;		// Left edge of the box from the pen
+	int8_t y;		// Top edge of the box from the top of the line
+	uint8_t advance;	// Pen step
+} AAFONT_GLYPH_t;
+
+// Codes first..first+count-1 have a glyph
+typedef struct {
+	const char *name;
+	uint8_t bpp;		// 2 or 4
+	uint8_t height;		// Line height
+	uint8_t ascent;		// Rows of the line down to the baseline
+	uint16_t first;
+	uint16_t count;
+	const AAFONT_GLYPH_t *glyphs;
+	const uint8_t *bitmaps;
+} AAFONT_t;
+
+uint16_t lcdMeasureAAString(const AAFONT_t *font, const uint8_t *ascii);
+int lcdDrawAAChar(TFT_t * dev, const AAFONT_t *font, uint16_t x, uint16_t y, uint8_t ascii, uint16_t color);
+int lcdDrawAAString(TFT_t * dev, const AAFONT_t *font, uint16_t x, uint16_t y, const uint8_t *ascii, uint16_t color);
+
+#endif /* MAIN_AAFONT_H_ */
@@ -0,0 +1,462 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "mono.h"
+
+#define TAG "BATCH"
+
+// Batched primitives.
+// A batch is validated and clipped once, then sorted by row so the frame
+// buffer is written top to bottom. In direct mode neighbouring pixels are
+// merged into runs and the column/page address is only sent when it
+// changes, so a batch costs far fewer SPI transactions than the same
+// primitives drawn one by one.
+
+// Most colors of one spi_master_write_colors call
+#define BATCH_RUN_MAX 512
+
+// Address window of direct mode
+// The panel keeps the column and page address between writes.
+typedef struct {
+	uint32_t column;
+	uint32_t page;
+} WINDOW_t;
+
+static void windowInit(WINDOW_t *win) {
+	win->column = UINT32_MAX;
+	win->page = UINT32_MAX;
+}
+
+// Start a memory write, sending only the changed addresses
+static void windowSet(TFT_t * dev, WINDOW_t *win, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+	uint16_t _x1 = x1 + dev->_offsetx;
+	uint16_t _x2 = x2 + dev->_offsetx;
+	uint16_t _y1 = y1 + dev->_offsety;
+	uint16_t _y2 = y2 + dev->_offsety;
+	uint32_t column = (uint32_t)_x1 << 16 | _x2;
+	uint32_t page = (uint32_t)_y1 << 16 | _y2;
+
+	if (column != win->column) {
+		spi_master_write_command(dev, 0x2A);	// set column(x) address
+		spi_master_write_addr(dev, _x1, _x2);
+		win->column = column;
+	}
+	if (page != win->page) {
+		spi_master_write_command(dev, 0x2B);	// set Page(y) address
+		spi_master_write_addr(dev, _y1, _y2);
+		win->page = page;
+	}
+	spi_master_write_command(dev, 0x2C);	// Memory Write
+}
+
+// Write a solid color window
+static void windowFill(TFT_t * dev, WINDOW_t *win, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	windowSet(dev, win, x1, y1, x2, y2);
+	uint32_t size = (uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+	while (size) {
+		uint16_t n = (size > BATCH_RUN_MAX) ? BATCH_RUN_MAX : size;
+		spi_master_write_color(dev, color, n);
+		size -= n;
+	}
+}
+
+// Stable counting sort of item indexes
+// key:Sort key of each item, keys >= range are dropped
+// src:Indexes to sort, NULL for 0..n-1
+// dst:Sorted indexes
+// count:Work area of range+1 entries
+// Returns number of indexes kept
+static uint16_t batchSort(const uint16_t *key, uint16_t range, const uint16_t *src, uint16_t n, uint16_t *dst, uint16_t *count) {
+	memset(count, 0, (range + 1) * sizeof(uint16_t));
+	for (uint16_t i = 0; i < n; i++) {
+		uint16_t k = key[src ? src[i] : i];
+		if (k < range) count[k + 1]++;
+	}
+	for (uint16_t k = 0; k < range; k++) count[k + 1] += count[k];
+	uint16_t kept = count[range];
+	for (uint16_t i = 0; i < n; i++) {
+		uint16_t item = src ? src[i] : i;
+		uint16_t k = key[item];
+		if (k < range) dst[count[k]++] = item;
+	}
+	return kept;
+}
+
+// Work area of a batch
+typedef struct {
+	uint16_t *key;
+	uint16_t *order;
+	uint16_t *tmp;
+	uint16_t *count;
+} BATCH_t;
+
+static bool batchAlloc(TFT_t * dev, BATCH_t *b, uint16_t n) {
+	uint16_t range = (dev->_width > dev->_height) ? dev->_width : dev->_height;
+	b->key = malloc(((size_t)n * 3 + range + 1) * sizeof(uint16_t));
+	if (b->key == NULL) {
+		ESP_LOGW(TAG, "Batch of %d items is not sorted, out of memory.", n);
+		return false;
+	}
+	b->order = b->key + n;
+	b->tmp = b->order + n;
+	b->count = b->tmp + n;
+	return true;
+}
+
+static void batchFree(BATCH_t *b) {
+	free(b->key);
+}
+
+// Draw pixels
+// points:Pixel coordinates
+// colors:Color of each pixel, NULL to use color
+// n:Number of pixels
+// color:Color when colors is NULL
+void lcdDrawPixels(TFT_t * dev, const POINT_t *points, const uint16_t *colors, uint16_t n, uint16_t color) {
+	BATCH_t b;
+	if (n == 0) return;
+	if (!batchAlloc(dev, &b, n)) {
+		for (uint16_t i = 0; i < n; i++)
+			lcdDrawPixel(dev, points[i].x, points[i].y, colors ? colors[i] : color);
+		return;
+	}
+
+	// Off-screen pixels get an out of range key and are dropped.
+	// Pixels at the same position keep their order, so the last one wins.
+	uint16_t m;
+	if (dev->_use_frame_buffer) {
+		for (uint16_t i = 0; i < n; i++)
+			b.key[i] = ((uint16_t)points[i].x < dev->_width) ? points[i].y : UINT16_MAX;
+		m = batchSort(b.key, dev->_height, NULL, n, b.order, b.count);
+		for (uint16_t i = 0; i < m; i++) {
+			uint16_t k = b.order[i];
+			if (dev->_mono) {
+				monoSetPixel(dev, points[k].x, points[k].y, colors ? colors[k] : color);
+			} else {
+				dev->_frame_buffer[points[k].y*dev->_stride+points[k].x] = colors ? colors[k] : color;
+			}
+		}
+		batchFree(&b);
+		return;
+	}
+
+	// Sort by X, then by Y, and send each horizontal run as one window
+	for (uint16_t i = 0; i < n; i++)
+		b.key[i] = ((uint16_t)points[i].y < dev->_height) ? points[i].x : UINT16_MAX;
+	m = batchSort(b.key, dev->_width, NULL, n, b.tmp, b.count);
+	for (uint16_t i = 0; i < n; i++) b.key[i] = points[i].y;
+	m = batchSort(b.key, dev->_height, b.tmp, m, b.order, b.count);
+
+	WINDOW_t win;
+	windowInit(&win);
+	uint16_t run[BATCH_RUN_MAX];
+	uint16_t i = 0;
+	while (i < m) {
+		uint16_t k = b.order[i];
+		uint16_t x1 = points[k].x;
+		uint16_t y = points[k].y;
+		uint16_t size = 0;
+		for (; i < m; i++) {
+			k = b.order[i];
+			if (points[k].y != y) break;
+			uint16_t x = points[k].x;
+			if (x == x1 + size - 1) {
+				run[size - 1] = colors ? colors[k] : color;
+				continue;
+			}
+			if (x != x1 + size || size == BATCH_RUN_MAX) break;
+			run[size++] = colors ? colors[k] : color;
+		}
+		windowSet(dev, &win, x1, y, x1 + size - 1, y);
+		spi_master_write_colors(dev, run, size);
+	}
+	batchFree(&b);
+}
+
+// Clip rectangle to the screen
+static bool batchClipRect(TFT_t * dev, const RECT_t *r, RECT_t *c) {
+	c->x1 = (r->x1 < r->x2) ? r->x1 : r->x2;
+	c->x2 = (r->x1 < r->x2) ? r->x2 : r->x1;
+	c->y1 = (r->y1 < r->y2) ? r->y1 : r->y2;
+	c->y2 = (r->y1 < r->y2) ? r->y2 : r->y1;
+	if (c->x1 < 0) c->x1 = 0;
+	if (c->y1 < 0) c->y1 = 0;
+	if (c->x2 >= dev->_width) c->x2 = dev->_width - 1;
+	if (c->y2 >= dev->_height) c->y2 = dev->_height - 1;
+	return (c->x1 <= c->x2 && c->y1 <= c->y2);
+}
+
+// Can b be sent in the same window as a
+static bool batchMergeRect(const RECT_t *a, const RECT_t *b) {
+	if (a->y1 == b->y1 && a->y2 == b->y2 && a->x2 + 1 == b->x1) return true;
+	if (a->x1 == b->x1 && a->x2 == b->x2 && a->y2 + 1 == b->y1) return true;
+	return false;
+}
+
+// Draw rectangles of filling
+// Overlapping rectangles are drawn in the order of the array.
+// rects:Rectangles, corners are inclusive
+// colors:Color of each rectangle, NULL to use color
+// n:Number of rectangles
+// color:Color when colors is NULL
+void lcdDrawFillRects(TFT_t * dev, const RECT_t *rects, const uint16_t *colors, uint16_t n, uint16_t color) {
+	if (n == 0) return;
+
+	if (!dev->_use_frame_buffer) {
+		// The panel is written immediately, so keep the order and merge
+		// neighbouring rectangles of the same color into one window.
+		WINDOW_t win;
+		windowInit(&win);
+		RECT_t cur = {0};
+		uint16_t cur_color = 0;
+		bool pending = false;
+		for (uint16_t i = 0; i < n; i++) {
+			RECT_t c;
+			uint16_t _color = colors ? colors[i] : color;
+			if (!batchClipRect(dev, &rects[i], &c)) continue;
+			if (pending && _color == cur_color && batchMergeRect(&cur, &c)) {
+				if (c.x2 > cur.x2) cur.x2 = c.x2;
+				if (c.y2 > cur.y2) cur.y2 = c.y2;
+				continue;
+			}
+			if (pending) windowFill(dev, &win, cur.x1, cur.y1, cur.x2, cur.y2, cur_color);
+			cur = c;
+			cur_color = _color;
+			pending = true;
+		}
+		if (pending) windowFill(dev, &win, cur.x1, cur.y1, cur.x2, cur.y2, cur_color);
+		return;
+	}
+
+	// Sweep the rows once. The active list is kept in array order so that
+	// overlapping rectangles are painted as if drawn one by one.
+	BATCH_t b;
+	RECT_t *clip = NULL;
+	if (batchAlloc(dev, &b, n)) {
+		clip = malloc(n * sizeof(RECT_t));
+		if (clip == NULL) batchFree(&b);
+	}
+	if (clip == NULL) {
+		for (uint16_t i = 0; i < n; i++) {
+			RECT_t c;
+			if (!batchClipRect(dev, &rects[i], &c)) continue;
+			lcdDrawFillRect(dev, c.x1, c.y1, c.x2, c.y2, colors ? colors[i] : color);
+		}
+		return;
+	}
+	for (uint16_t i = 0; i < n; i++)
+		b.key[i] = batchClipRect(dev, &rects[i], &clip[i]) ? clip[i].y1 : UINT16_MAX;
+	uint16_t m = batchSort(b.key, dev->_height, NULL, n, b.order, b.count);
+	uint16_t *active = b.tmp;
+	uint16_t nactive = 0;
+	uint16_t next = 0;
+	for (int16_t y = 0; y < dev->_height && (next < m || nactive); y++) {
+		if (nactive == 0) y = clip[b.order[next]].y1;
+		for (; next < m && clip[b.order[next]].y1 == y; next++) {
+			uint16_t k = b.order[next];
+			uint16_t j = nactive++;
+			for (; j > 0 && active[j - 1] > k; j--) active[j] = active[j - 1];
+			active[j] = k;
+		}
+		uint16_t keep = 0;
+		for (uint16_t j = 0; j < nactive; j++) {
+			uint16_t k = active[j];
+			if (dev->_mono) {
+				monoFillRect(dev, clip[k].x1, y, clip[k].x2, y, colors ? colors[k] : color);
+			} else {
+				rgb565Fill(&dev->_frame_buffer[y*dev->_stride+clip[k].x1], colors ? colors[k] : color, clip[k].x2 - clip[k].x1 + 1);
+			}
+			if (clip[k].y2 > y) active[keep++] = k;
+		}
+		nactive = keep;
+	}
+	free(clip);
+	batchFree(&b);
+}
+
+// Send a line run as one window, clipped to the screen
+static void batchLineRun(TFT_t * dev, WINDOW_t *win, int x1, int y1, int x2, int y2, uint16_t color) {
+	if (x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+	if (y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+	if (x2 < 0 || y2 < 0 || x1 >= dev->_width || y1 >= dev->_height) return;
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 >= dev->_width) x2 = dev->_width - 1;
+	if (y2 >= dev->_height) y2 = dev->_height - 1;
+	windowFill(dev, win, x1, y1, x2, y2, color);
+}
+
+// Draw line in direct mode as runs
+// Same pixels as lcdDrawLine, one window per horizontal or vertical run.
+static void batchLine(TFT_t * dev, WINDOW_t *win, int x1, int y1, int x2, int y2, uint16_t color) {
+	int dx = (x2 > x1) ? x2 - x1 : x1 - x2;
+	int dy = (y2 > y1) ? y2 - y1 : y1 - y2;
+	int sx = (x2 > x1) ? 1 : -1;
+	int sy = (y2 > y1) ? 1 : -1;
+	int rx = x1;
+	int ry = y1;
+	int E;
+
+	if (dx > dy) {
+		E = -dx;
+		for (int i = 0; i <= dx; i++) {
+			E += 2 * dy;
+			if (E >= 0 || i == dx) {
+				batchLineRun(dev, win, rx, y1, x1, y1, color);
+				rx = x1 + sx;
+			}
+			x1 += sx;
+			if (E >= 0) {
+				y1 += sy;
+				E -= 2 * dx;
+			}
+		}
+	} else {
+		E = -dy;
+		for (int i = 0; i <= dy; i++) {
+			E += 2 * dx;
+			if (E >= 0 || i == dy) {
+				batchLineRun(dev, win, x1, ry, x1, y1, color);
+				ry = y1 + sy;
+			}
+			y1 += sy;
+			if (E >= 0) {
+				x1 += sx;
+				E -= 2 * dy;
+			}
+		}
+	}
+}
+
+// Draw lines
+// lines:Start point x1,y1 and end point x2,y2 of each line
+// colors:Color of each line, NULL to use color
+// n:Number of lines
+// color:Color when colors is NULL
+void lcdDrawLines(TFT_t * dev, const RECT_t *lines, const uint16_t *colors, uint16_t n, uint16_t color) {
+	if (n == 0) return;
+
+	if (!dev->_use_frame_buffer) {
+		WINDOW_t win;
+		windowInit(&win);
+		for (uint16_t i = 0; i < n; i++) {
+			const RECT_t *l = &lines[i];
+			batchLine(dev, &win, l->x1, l->y1, l->x2, l->y2, colors ? colors[i] : color);
+		}
+		return;
+	}
+
+	// Lines of different colors may cross, so only one color batches
+	// are reordered.
+	BATCH_t b;
+	if (colors != NULL || !batchAlloc(dev, &b, n)) {
+		for (uint16_t i = 0; i < n; i++) {
+			const RECT_t *l = &lines[i];
+			lcdDrawLine(dev, l->x1, l->y1, l->x2, l->y2, colors ? colors[i] : color);
+		}
+		return;
+	}
+	for (uint16_t i = 0; i < n; i++) {
+		int16_t top = (lines[i].y1 < lines[i].y2) ? lines[i].y1 : lines[i].y2;
+		int16_t bottom = (lines[i].y1 < lines[i].y2) ? lines[i].y2 : lines[i].y1;
+		if (bottom < 0 || top >= dev->_height) {
+			b.key[i] = UINT16_MAX;
+		} else {
+			b.key[i] = (top < 0) ? 0 : top;
+		}
+	}
+	uint16_t m = batchSort(b.key, dev->_height, NULL, n, b.order, b.count);
+	for (uint16_t i = 0; i < m; i++) {
+		const RECT_t *l = &lines[b.order[i]];
+		lcdDrawLine(dev, l->x1, l->y1, l->x2, l->y2, color);
+	}
+	batchFree(&b);
+}
+
+// Draw glyph runs in direct mode, one text row at a time
+// Horizontal text only. Glyphs of a run are expanded together so the page
+// address is sent once per text row and set bits go out as runs.
+static void batchGlyphRun(TFT_t * dev, WINDOW_t *win, FontxFile *fx, const GLYPH_RUN_t *gr) {
+	uint8_t pw, ph;
+	uint16_t len = strlen((const char *)gr->text);
+	if (len == 0) return;
+	if (!GetFontx(fx, gr->text[0], &pw, &ph)) return;
+	uint16_t bpr = (pw + 7) / 8;
+	uint16_t fsz = bpr * ph;
+	uint8_t *glyphs = malloc((size_t)fsz * len);
+	if (glyphs == NULL) {
+		lcdDrawString(dev, fx, gr->x, gr->y, (uint8_t *)gr->text, gr->color);
+		return;
+	}
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < len; i++) {
+		if (!GetFontx(fx, gr->text[i], &pw, &ph)) break;
+		memcpy(&glyphs[count * fsz], fx->fonts, fsz);
+		count++;
+	}
+
+	int x0 = gr->x;
+	int y0 = gr->y - (ph - 1);
+	int x1 = x0 + count * pw - 1;
+	if (dev->_font_fill) batchLineRun(dev, win, x0, y0, x1, gr->y, dev->_font_fill_color);
+
+	uint16_t rows = dev->_font_underline ? ph - 2 : ph;
+	for (uint16_t h = 0; h < rows; h++) {
+		int y = y0 + h;
+		if (y < 0 || y >= dev->_height) continue;
+		int start = -1;
+		for (int x = 0; x <= count * pw; x++) {
+			bool on = false;
+			if (x < count * pw) {
+				uint8_t *row = &glyphs[(x / pw) * fsz + h * bpr];
+				uint16_t bit = x % pw;
+				on = row[bit / 8] & (0x80 >> (bit % 8));
+			}
+			if (on && start < 0) start = x;
+			if (!on && start >= 0) {
+				batchLineRun(dev, win, x0 + start, y, x0 + x - 1, y, gr->color);
+				start = -1;
+			}
+		}
+	}
+	if (dev->_font_underline) batchLineRun(dev, win, x0, gr->y - 1, x1, gr->y, dev->_font_underline_color);
+	free(glyphs);
+}
+
+// Draw glyph runs
+// Runs are drawn from top to bottom.
+// fx:Font
+// runs:Text, position and color of each run, as lcdDrawString
+// n:Number of runs
+void lcdDrawGlyphRuns(TFT_t * dev, FontxFile *fx, const GLYPH_RUN_t *runs, uint16_t n) {
+	BATCH_t b;
+	if (n == 0) return;
+	if (!batchAlloc(dev, &b, n)) {
+		for (uint16_t i = 0; i < n; i++)
+			lcdDrawString(dev, fx, runs[i].x, runs[i].y, (uint8_t *)runs[i].text, runs[i].color);
+		return;
+	}
+	// Text may extend above or below its base line, so nothing is dropped
+	uint16_t range = (dev->_width > dev->_height) ? dev->_width : dev->_height;
+	for (uint16_t i = 0; i < n; i++) {
+		int16_t y = runs[i].y;
+		b.key[i] = (y < 0) ? 0 : (y >= range) ? range - 1 : y;
+	}
+	uint16_t m = batchSort(b.key, range, NULL, n, b.order, b.count);
+
+	WINDOW_t win;
+	windowInit(&win);
+	for (uint16_t i = 0; i < m; i++) {
+		const GLYPH_RUN_t *gr = &runs[b.order[i]];
+		// Scaled glyphs take the lcdDrawString path
+		if (!dev->_use_frame_buffer && dev->_font_direction == DIRECTION0 && dev->_font_scale <= 1) {
+			batchGlyphRun(dev, &win, fx, gr);
+		} else {
+			lcdDrawString(dev, fx, gr->x, gr->y, (uint8_t *)gr->text, gr->color);
+		}
+	}
+	batchFree(&b);
+}
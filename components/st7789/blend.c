@@ -0,0 +1,200 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blend.h"
+
+// Two pixels in one 32-bit word (p1 << 16 | p0) are split into two words:
+//  even: p0.B p0.R p1.G   (word & 0x07E0F81F)
+//  odd:  p0.G p1.B p1.R   ((word >> 5) & 0x07C0F83F)
+// Each field then has at least 5 free bits above it, so it can be
+// multiplied by an alpha of 0-32 without carrying into the next field.
+#define EVEN_MASK 0x07E0F81FU
+#define ODD_MASK  0x07C0F83FU
+
+// Alpha 0-255 to 0-32
+static inline uint32_t alpha5(uint8_t alpha) {
+	return ((uint32_t)alpha + 4) >> 3;
+}
+
+// Alpha 0-15 to 0-32
+static const uint8_t alpha4to5[16] = {
+	0, 2, 4, 6, 9, 11, 13, 15, 17, 19, 21, 23, 26, 28, 30, 32
+};
+
+// Alpha 0-3 to 0-32
+static const uint8_t alpha2to5[4] = {
+	0, 11, 21, 32
+};
+
+static inline uint16_t blend1(uint16_t fg, uint16_t bg, uint32_t a) {
+	uint32_t f = (fg | ((uint32_t)fg << 16)) & EVEN_MASK;
+	uint32_t b = (bg | ((uint32_t)bg << 16)) & EVEN_MASK;
+	uint32_t r = ((f * a + b * (32 - a)) >> 5) & EVEN_MASK;
+	return (uint16_t)(r | (r >> 16));
+}
+
+static inline uint32_t blend2(uint32_t fg, uint32_t bg, uint32_t a) {
+	uint32_t e = (fg & EVEN_MASK) * a + (bg & EVEN_MASK) * (32 - a);
+	uint32_t o = ((fg >> 5) & ODD_MASK) * a + ((bg >> 5) & ODD_MASK) * (32 - a);
+	return ((e >> 5) & EVEN_MASK) | (o & (ODD_MASK << 5));
+}
+
+// Fill a row with a solid color
+// Pixel pairs are stored as 32-bit words.
+// dst:Row to fill
+// color:color
+// size:Number of pixels
+void rgb565Fill(uint16_t *dst, uint16_t color, uint16_t size) {
+	if (size && ((uintptr_t)dst & 2)) {
+		*dst++ = color;
+		size--;
+	}
+	uint32_t color2 = color | ((uint32_t)color << 16);
+	uint32_t *d = (uint32_t *)dst;
+	for (uint16_t i = 0; i < size / 2; i++) d[i] = color2;
+	if (size & 1) dst[size-1] = color;
+}
+
+// Blend one color
+// fg:Foreground color
+// bg:Background color
+// alpha:Opacity of foreground(0-255)
+uint16_t rgb565Blend(uint16_t fg, uint16_t bg, uint8_t alpha) {
+	return blend1(fg, bg, alpha5(alpha));
+}
+
+// Blend a solid color over a row
+// dst:Row to blend into
+// color:color
+// size:Number of pixels
+// alpha:Opacity(0-255)
+void rgb565BlendFill(uint16_t *dst, uint16_t color, uint16_t size, uint8_t alpha) {
+	uint32_t a = alpha5(alpha);
+	if (a == 0) return;
+	if (a == 32) {
+		rgb565Fill(dst, color, size);
+		return;
+	}
+	if (size && ((uintptr_t)dst & 2)) {
+		*dst = blend1(color, *dst, a);
+		dst++;
+		size--;
+	}
+	// Foreground terms are the same for every pair
+	uint32_t fg = color | ((uint32_t)color << 16);
+	uint32_t fe = (fg & EVEN_MASK) * a;
+	uint32_t fo = ((fg >> 5) & ODD_MASK) * a;
+	uint32_t *d = (uint32_t *)dst;
+	for (uint16_t i = 0; i < size / 2; i++) {
+		uint32_t bg = d[i];
+		uint32_t e = fe + (bg & EVEN_MASK) * (32 - a);
+		uint32_t o = fo + ((bg >> 5) & ODD_MASK) * (32 - a);
+		d[i] = ((e >> 5) & EVEN_MASK) | (o & (ODD_MASK << 5));
+	}
+	if (size & 1) dst[size-1] = blend1(color, dst[size-1], a);
+}
+
+// Blend a row of colors over a row
+// dst:Row to blend into
+// src:Colors
+// size:Number of pixels
+// alpha:Opacity(0-255)
+void rgb565BlendRow(uint16_t *dst, const uint16_t *src, uint16_t size, uint8_t alpha) {
+	uint32_t a = alpha5(alpha);
+	if (a == 0) return;
+	if (a == 32) {
+		for (uint16_t i = 0; i < size; i++) dst[i] = src[i];
+		return;
+	}
+	if (((uintptr_t)dst ^ (uintptr_t)src) & 2) {
+		// Word pairs can not be aligned on both sides
+		for (uint16_t i = 0; i < size; i++) dst[i] = blend1(src[i], dst[i], a);
+		return;
+	}
+	if (size && ((uintptr_t)dst & 2)) {
+		*dst = blend1(*src, *dst, a);
+		dst++;
+		src++;
+		size--;
+	}
+	uint32_t *d = (uint32_t *)dst;
+	const uint32_t *s = (const uint32_t *)src;
+	for (uint16_t i = 0; i < size / 2; i++) {
+		d[i] = blend2(s[i], d[i], a);
+	}
+	if (size & 1) dst[size-1] = blend1(src[size-1], dst[size-1], a);
+}
+
+// Get alpha(0-255) of one mask pixel
+// mask:Mask row, MSB first
+// bpp:Bits per pixel of mask(1/2/4/8)
+// index:Pixel index in row
+uint8_t rgb565MaskAlpha(const uint8_t *mask, uint8_t bpp, uint16_t index) {
+	switch (bpp) {
+	case 8:
+		return mask[index];
+	case 4:
+		return ((mask[index >> 1] >> ((~index & 1) << 2)) & 0x0F) * 17;
+	case 2:
+		return ((mask[index >> 2] >> ((~index & 3) << 1)) & 0x03) * 85;
+	case 1:
+		return (mask[index >> 3] & (0x80 >> (index & 7))) ? 255 : 0;
+	}
+	return 0;
+}
+
+// Get alpha(0-32) of one mask pixel
+static inline uint32_t mask_alpha5(const uint8_t *mask, uint8_t bpp, uint16_t index) {
+	switch (bpp) {
+	case 8:
+		return alpha5(mask[index]);
+	case 4:
+		return alpha4to5[(mask[index >> 1] >> ((~index & 1) << 2)) & 0x0F];
+	case 2:
+		return alpha2to5[(mask[index >> 2] >> ((~index & 3) << 1)) & 0x03];
+	case 1:
+		return (mask[index >> 3] & (0x80 >> (index & 7))) ? 32 : 0;
+	}
+	return 0;
+}
+
+// Blend a solid color over a row through an alpha mask
+// dst:Row to blend into
+// color:color
+// mask:Mask row, MSB first
+// bpp:Bits per pixel of mask(1/2/4/8)
+// start:Index of first mask pixel
+// size:Number of pixels
+void rgb565BlendMask(uint16_t *dst, uint16_t color, const uint8_t *mask, uint8_t bpp, uint16_t start, uint16_t size) {
+	uint32_t fe = (color | ((uint32_t)color << 16)) & EVEN_MASK;
+	for (uint16_t i = 0; i < size; i++) {
+		uint32_t a = mask_alpha5(mask, bpp, start + i);
+		if (a == 0) continue;
+		if (a == 32) {
+			dst[i] = color;
+			continue;
+		}
+		uint32_t b = (dst[i] | ((uint32_t)dst[i] << 16)) & EVEN_MASK;
+		uint32_t r = ((fe * a + b * (32 - a)) >> 5) & EVEN_MASK;
+		dst[i] = (uint16_t)(r | (r >> 16));
+	}
+}
+
+// Blend a row of colors over a row through an alpha mask
+// dst:Row to blend into
+// src:Colors
+// mask:Mask row, MSB first
+// bpp:Bits per pixel of mask(1/2/4/8)
+// start:Index of first mask pixel
+// size:Number of pixels
+void rgb565BlendRowMask(uint16_t *dst, const uint16_t *src, const uint8_t *mask, uint8_t bpp, uint16_t start, uint16_t size) {
+	for (uint16_t i = 0; i < size; i++) {
+		uint32_t a = mask_alpha5(mask, bpp, start + i);
+		if (a == 0) continue;
+		if (a == 32) {
+			dst[i] = src[i];
+			continue;
+		}
+		dst[i] = blend1(src[i], dst[i], a);
+	}
+}
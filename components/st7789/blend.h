@@ -0,0 +1,22 @@
+#ifndef MAIN_BLEND_H_
+#define MAIN_BLEND_H_
+
+#include <stdint.h>
+
+// RGB565 row fill and alpha blending kernels.
+// The kernels split pixels with the 0x07E0F81F mask so that R, G and B get
+// enough headroom for an integer multiply. Rows are processed two pixels
+// per 32-bit word. Alpha is 0-255 and is reduced to 0-32 internally.
+
+// Alpha value of a fully opaque pixel
+#define BLEND_OPAQUE 255
+
+void rgb565Fill(uint16_t *dst, uint16_t color, uint16_t size);
+uint16_t rgb565Blend(uint16_t fg, uint16_t bg, uint8_t alpha);
+void rgb565BlendFill(uint16_t *dst, uint16_t color, uint16_t size, uint8_t alpha);
+void rgb565BlendRow(uint16_t *dst, const uint16_t *src, uint16_t size, uint8_t alpha);
+void rgb565BlendMask(uint16_t *dst, uint16_t color, const uint8_t *mask, uint8_t bpp, uint16_t start, uint16_t size);
+void rgb565BlendRowMask(uint16_t *dst, const uint16_t *src, const uint8_t *mask, uint8_t bpp, uint16_t start, uint16_t size);
+uint8_t rgb565MaskAlpha(const uint8_t *mask, uint8_t bpp, uint16_t index);
+
+#endif /* MAIN_BLEND_H_ */
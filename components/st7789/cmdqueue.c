@@ -0,0 +1,280 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "render.h"
+#include "cmdqueue.h"
+#include "ring.h"
+
+#define TAG "CMDQUEUE"
+
+// Initialize queue
+// size:Slots per priority, rounded up to a power of 2
+bool lcdQueueInit(CMD_QUEUE_t *queue, TFT_t *dev, uint16_t size) {
+	memset(queue, 0, sizeof(CMD_QUEUE_t));
+	queue->dev = dev;
+	uint32_t slots = 2;
+	while (slots < size) slots <<= 1;
+	for (int p = 0; p < CMD_QUEUE_PRIORITIES; p++) {
+		CMD_RING_t *ring = &queue->rings[p];
+		ring->slots = malloc(slots * sizeof(CMD_SLOT_t));
+		if (ring->slots == NULL) {
+			ESP_LOGE(TAG, "Error allocating command queue.");
+			lcdQueueDelete(queue);
+			return false;
+		}
+		ring->mask = slots - 1;
+		ringInit(&ring->head, ring->slots, sizeof(CMD_SLOT_t), slots);
+	}
+	return true;
+}
+
+// Free queue
+// No producer may post after this.
+void lcdQueueDelete(CMD_QUEUE_t *queue) {
+	for (int p = 0; p < CMD_QUEUE_PRIORITIES; p++) {
+		free(queue->rings[p].slots);
+		queue->rings[p].slots = NULL;
+	}
+}
+
+// Initialize producer
+// priority:CMD_PRIORITY_NORMAL or CMD_PRIORITY_HIGH
+// wait:Ticks to wait when the ring is full, 0 from interrupts
+void lcdQueueProducer(CMD_QUEUE_t *queue, CMD_PRODUCER_t *producer, uint8_t priority, TickType_t wait) {
+	memset(producer, 0, sizeof(CMD_PRODUCER_t));
+	producer->queue = queue;
+	producer->priority = (priority < CMD_QUEUE_PRIORITIES) ? priority : CMD_QUEUE_PRIORITIES - 1;
+	producer->wait = wait;
+}
+
+static bool queueClaim(CMD_RING_t *ring, uint32_t n, uint32_t *pos) {
+	return ringClaim(&ring->head, ring->slots, sizeof(CMD_SLOT_t), ring->mask, n, pos);
+}
+
+// Claim slots, waiting up to the producer wait time
+static CMD_RING_t *queueReserve(CMD_PRODUCER_t *producer, uint32_t n, uint32_t *pos) {
+	CMD_RING_t *ring = &producer->queue->rings[producer->priority];
+	if (n > ring->mask + 1) n = ring->mask + 1;
+	if (queueClaim(ring, n, pos)) return ring;
+	producer->stats.full++;
+	// Interrupts post with wait 0 and must not read the task tick count
+	if (producer->wait) {
+		TickType_t start = xTaskGetTickCount();
+		while (xTaskGetTickCount() - start < producer->wait) {
+			vTaskDelay(1);
+			if (queueClaim(ring, n, pos)) return ring;
+		}
+	}
+	producer->stats.dropped += n;
+	return NULL;
+}
+
+// Hand a filled slot to the consumer
+static void queuePublish(CMD_RING_t *ring, uint32_t pos) {
+	ringPublish(ring->slots, sizeof(CMD_SLOT_t), ring->mask, pos);
+}
+
+static bool queuePost(CMD_PRODUCER_t *producer, RENDER_OP_t op, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t width, uint16_t color) {
+	uint32_t pos;
+	CMD_RING_t *ring = queueReserve(producer, 1, &pos);
+	if (ring == NULL) return false;
+	RENDER_CMD_t *cmd = &ring->slots[pos & ring->mask].cmd;
+	memset(cmd, 0, sizeof(RENDER_CMD_t));
+	cmd->op = op;
+	cmd->x1 = x1;
+	cmd->y1 = y1;
+	cmd->x2 = x2;
+	cmd->y2 = y2;
+	cmd->width = width;
+	cmd->color = color;
+	queuePublish(ring, pos);
+	producer->stats.posted++;
+	return true;
+}
+
+// Post screen fill
+bool lcdQueueFillScreen(CMD_PRODUCER_t *producer, uint16_t color) {
+	return queuePost(producer, RENDER_FILL_RECT, 0, 0, INT16_MAX, INT16_MAX, 0, color);
+}
+
+// Post pixel
+bool lcdQueueDrawPixel(CMD_PRODUCER_t *producer, int16_t x, int16_t y, uint16_t color) {
+	return queuePost(producer, RENDER_PIXEL, x, y, 0, 0, 0, color);
+}
+
+// Post line
+bool lcdQueueDrawLine(CMD_PRODUCER_t *producer, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	return queuePost(producer, RENDER_LINE, x1, y1, x2, y2, 0, color);
+}
+
+// Post rectangle
+bool lcdQueueDrawRect(CMD_PRODUCER_t *producer, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	return queuePost(producer, RENDER_RECT, x1, y1, x2, y2, 0, color);
+}
+
+// Post rectangle of filling
+bool lcdQueueDrawFillRect(CMD_PRODUCER_t *producer, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	return queuePost(producer, RENDER_FILL_RECT, x1, y1, x2, y2, 0, color);
+}
+
+// Post circle
+bool lcdQueueDrawCircle(CMD_PRODUCER_t *producer, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	return queuePost(producer, RENDER_CIRCLE, x0, y0, 0, 0, r, color);
+}
+
+// Post circle of filling
+bool lcdQueueDrawFillCircle(CMD_PRODUCER_t *producer, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	return queuePost(producer, RENDER_FILL_CIRCLE, x0, y0, 0, 0, r, color);
+}
+
+// Post string
+// The text is copied. Glyphs are read by the consumer, so fx must not be
+// used by other tasks meanwhile. Strings longer than CMD_QUEUE_TEXT-1
+// characters take consecutive slots, each continuing where the last ended.
+bool lcdQueueDrawString(CMD_PRODUCER_t *producer, FontxFile *fx, int16_t x, int16_t y, const uint8_t *ascii, uint16_t color) {
+	size_t length = strlen((const char *)ascii);
+	if (length == 0) return true;
+	uint32_t n = (length + CMD_QUEUE_TEXT - 2) / (CMD_QUEUE_TEXT - 1);
+	uint32_t pos;
+	CMD_RING_t *ring = queueReserve(producer, n, &pos);
+	if (ring == NULL) return false;
+	if (n > ring->mask + 1) n = ring->mask + 1;
+	for (uint32_t i = 0; i < n; i++) {
+		CMD_SLOT_t *slot = &ring->slots[(pos + i) & ring->mask];
+		RENDER_CMD_t *cmd = &slot->cmd;
+		memset(cmd, 0, sizeof(RENDER_CMD_t));
+		cmd->op = RENDER_STRING;
+		cmd->x1 = x;
+		cmd->y1 = y;
+		cmd->n = (i > 0);	// Continue the previous slot
+		cmd->color = color;
+		cmd->direction = producer->font_direction;
+		cmd->fill = producer->font_fill;
+		cmd->fill_color = producer->font_fill_color;
+		cmd->underline = producer->font_underline;
+		cmd->underline_color = producer->font_underline_color;
+		slot->fx = fx;
+		size_t k = length - i * (CMD_QUEUE_TEXT - 1);
+		if (k > CMD_QUEUE_TEXT - 1) k = CMD_QUEUE_TEXT - 1;
+		memcpy(slot->text, &ascii[i * (CMD_QUEUE_TEXT - 1)], k);
+		slot->text[k] = 0;
+		queuePublish(ring, pos + i);
+	}
+	producer->stats.posted += n;
+	return true;
+}
+
+// Set font direction of posted strings
+void lcdQueueSetFontDirection(CMD_PRODUCER_t *producer, uint16_t dir) {
+	producer->font_direction = dir;
+}
+
+// Set font filling of posted strings
+void lcdQueueSetFontFill(CMD_PRODUCER_t *producer, uint16_t color) {
+	producer->font_fill = true;
+	producer->font_fill_color = color;
+}
+
+// UnSet font filling of posted strings
+void lcdQueueUnsetFontFill(CMD_PRODUCER_t *producer) {
+	producer->font_fill = false;
+}
+
+// Set font underline of posted strings
+void lcdQueueSetFontUnderLine(CMD_PRODUCER_t *producer, uint16_t color) {
+	producer->font_underline = true;
+	producer->font_underline_color = color;
+}
+
+// UnSet font underline of posted strings
+void lcdQueueUnsetFontUnderLine(CMD_PRODUCER_t *producer) {
+	producer->font_underline = false;
+}
+
+// Draw string of a slot with the font state it was posted with
+static void queueString(TFT_t *dev, CMD_RING_t *ring, CMD_SLOT_t *slot) {
+	const RENDER_CMD_t *cmd = &slot->cmd;
+	uint16_t direction = dev->_font_direction;
+	uint16_t fill = dev->_font_fill;
+	uint16_t fill_color = dev->_font_fill_color;
+	uint16_t underline = dev->_font_underline;
+	uint16_t underline_color = dev->_font_underline_color;
+	dev->_font_direction = cmd->direction;
+	dev->_font_fill = cmd->fill;
+	dev->_font_fill_color = cmd->fill_color;
+	dev->_font_underline = cmd->underline;
+	dev->_font_underline_color = cmd->underline_color;
+
+	int16_t x = cmd->n ? ring->next_x : cmd->x1;
+	int16_t y = cmd->n ? ring->next_y : cmd->y1;
+	int next = lcdDrawString(dev, slot->fx, x, y, slot->text, cmd->color);
+	ring->next_x = x;
+	ring->next_y = y;
+	if (cmd->direction == DIRECTION0 || cmd->direction == DIRECTION180) {
+		ring->next_x = next;
+	} else {
+		ring->next_y = next;
+	}
+
+	dev->_font_direction = direction;
+	dev->_font_fill = fill;
+	dev->_font_fill_color = fill_color;
+	dev->_font_underline = underline;
+	dev->_font_underline_color = underline_color;
+}
+
+static void queueCommand(TFT_t *dev, CMD_RING_t *ring, CMD_SLOT_t *slot) {
+	const RENDER_CMD_t *cmd = &slot->cmd;
+	switch (cmd->op) {
+	case RENDER_PIXEL:
+		lcdDrawPixel(dev, cmd->x1, cmd->y1, cmd->color);
+		break;
+	case RENDER_LINE:
+		lcdDrawLine(dev, cmd->x1, cmd->y1, cmd->x2, cmd->y2, cmd->color);
+		break;
+	case RENDER_RECT:
+		lcdDrawRect(dev, cmd->x1, cmd->y1, cmd->x2, cmd->y2, cmd->color);
+		break;
+	case RENDER_FILL_RECT:
+		lcdDrawFillRect(dev, cmd->x1, cmd->y1, cmd->x2, cmd->y2, cmd->color);
+		break;
+	case RENDER_CIRCLE:
+		lcdDrawCircle(dev, cmd->x1, cmd->y1, cmd->width, cmd->color);
+		break;
+	case RENDER_FILL_CIRCLE:
+		lcdDrawFillCircle(dev, cmd->x1, cmd->y1, cmd->width, cmd->color);
+		break;
+	case RENDER_STRING:
+		queueString(dev, ring, slot);
+		break;
+	default:
+		break;
+	}
+}
+
+// Draw queued commands
+// Only the task that owns TFT_t may call this.
+// max:Most commands to draw, higher priorities first
+// Returns the number of commands drawn
+uint16_t lcdQueueDrain(CMD_QUEUE_t *queue, uint16_t max) {
+	TFT_t *dev = queue->dev;
+	uint16_t count = 0;
+	for (int p = CMD_QUEUE_PRIORITIES - 1; p >= 0; p--) {
+		CMD_RING_t *ring = &queue->rings[p];
+		uint32_t used = atomic_load_explicit(&ring->head, memory_order_relaxed) - ring->tail;
+		if (used > ring->high_water) ring->high_water = used;
+		while (count < max) {
+			if (!ringReady(ring->slots, sizeof(CMD_SLOT_t), ring->mask, ring->tail)) break;
+			queueCommand(dev, ring, &ring->slots[ring->tail & ring->mask]);
+			ringRelease(ring->slots, sizeof(CMD_SLOT_t), ring->mask, ring->tail);
+			ring->tail++;
+			count++;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,88 @@
+#ifndef MAIN_CMDQUEUE_H_
+#define MAIN_CMDQUEUE_H_
+
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "st7789.h"
+#include "render.h"
+
+// Multi-producer draw command queue.
+// Any task posts draw commands, the task that owns TFT_t drains them with
+// lcdQueueDrain and draws them in order. Each priority has its own ring of
+// slots. Producers claim slots with a compare-and-swap on the ring head
+// and publish them through a per-slot sequence number, so posting never
+// takes a lock and works from interrupts with wait 0. Rings of higher
+// priority are drained first. Within a ring, commands run in the order
+// they were claimed.
+
+#define CMD_QUEUE_PRIORITIES 2
+#define CMD_PRIORITY_NORMAL 0
+#define CMD_PRIORITY_HIGH 1
+
+// Characters of a string command per slot, longer strings take
+// consecutive slots
+#define CMD_QUEUE_TEXT 24
+
+typedef struct {
+	_Atomic uint32_t sequence;	// First member, see ring.h
+	FontxFile *fx;
+	RENDER_CMD_t cmd;
+	uint8_t text[CMD_QUEUE_TEXT];
+} CMD_SLOT_t;
+
+typedef struct {
+	CMD_SLOT_t *slots;
+	uint32_t mask;
+	_Atomic uint32_t head;	// Next slot to claim
+	uint32_t tail;		// Next slot to drain
+	uint32_t high_water;	// Most slots in use seen by lcdQueueDrain
+	int16_t next_x;		// End of the last string
+	int16_t next_y;
+} CMD_RING_t;
+
+typedef struct {
+	TFT_t *dev;
+	CMD_RING_t rings[CMD_QUEUE_PRIORITIES];
+} CMD_QUEUE_t;
+
+// Backpressure counters of one producer
+typedef struct {
+	uint32_t posted;	// Commands queued
+	uint32_t full;		// Posts that found the ring full
+	uint32_t dropped;	// Commands given up after the wait
+} CMD_STATS_t;
+
+// Producer state, owned by one task
+typedef struct {
+	CMD_QUEUE_t *queue;
+	uint8_t priority;
+	TickType_t wait;	// Ticks to wait for a free slot
+	uint16_t font_direction;
+	uint16_t font_fill;
+	uint16_t font_fill_color;
+	uint16_t font_underline;
+	uint16_t font_underline_color;
+	CMD_STATS_t stats;
+} CMD_PRODUCER_t;
+
+bool lcdQueueInit(CMD_QUEUE_t *queue, TFT_t *dev, uint16_t size);
+void lcdQueueDelete(CMD_QUEUE_t *queue);
+void lcdQueueProducer(CMD_QUEUE_t *queue, CMD_PRODUCER_t *producer, uint8_t priority, TickType_t wait);
+uint16_t lcdQueueDrain(CMD_QUEUE_t *queue, uint16_t max);
+bool lcdQueueFillScreen(CMD_PRODUCER_t *producer, uint16_t color);
+bool lcdQueueDrawPixel(CMD_PRODUCER_t *producer, int16_t x, int16_t y, uint16_t color);
+bool lcdQueueDrawLine(CMD_PRODUCER_t *producer, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+bool lcdQueueDrawRect(CMD_PRODUCER_t *producer, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+bool lcdQueueDrawFillRect(CMD_PRODUCER_t *producer, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+bool lcdQueueDrawCircle(CMD_PRODUCER_t *producer, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+bool lcdQueueDrawFillCircle(CMD_PRODUCER_t *producer, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+bool lcdQueueDrawString(CMD_PRODUCER_t *producer, FontxFile *fx, int16_t x, int16_t y, const uint8_t *ascii, uint16_t color);
+void lcdQueueSetFontDirection(CMD_PRODUCER_t *producer, uint16_t dir);
+void lcdQueueSetFontFill(CMD_PRODUCER_t *producer, uint16_t color);
+void lcdQueueUnsetFontFill(CMD_PRODUCER_t *producer);
+void lcdQueueSetFontUnderLine(CMD_PRODUCER_t *producer, uint16_t color);
+void lcdQueueUnsetFontUnderLine(CMD_PRODUCER_t *producer);
+
+#endif /* MAIN_CMDQUEUE_H_ */
@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "blend.h"
+#include "mono.h"
+#include "console.h"
+#include "ring.h"
+
+#define TAG "CONSOLE"
+
+// Pixels of one window sent without a frame buffer
+#define CONSOLE_WINDOW_MAX 512
+
+// ANSI colors, normal then bright
+static const uint16_t console_palette[16] = {
+	rgb565(0, 0, 0), rgb565(170, 0, 0), rgb565(0, 170, 0), rgb565(170, 85, 0),
+	rgb565(0, 0, 170), rgb565(170, 0, 170), rgb565(0, 170, 170), rgb565(170, 170, 170),
+	rgb565(85, 85, 85), rgb565(255, 85, 85), rgb565(85, 255, 85), rgb565(255, 255, 85),
+	rgb565(85, 85, 255), rgb565(255, 85, 255), rgb565(85, 255, 255), rgb565(255, 255, 255),
+};
+
+// Console mirroring ESP_LOG and the log function it replaced
+static CONSOLE_t *_Atomic log_console;
+static vprintf_like_t log_vprintf;
+
+// Tasks inside consoleLogVprintf
+static _Atomic uint32_t log_writers;
+
+// Create console
+// fx:Font of the cells
+// x:X coordinate of the top left
+// y:Y coordinate of the top left
+// cols:Cells per row
+// rows:Rows of cells
+// slots:Queue slots, rounded up to a power of 2
+bool lcdConsoleInit(CONSOLE_t *con, TFT_t *dev, FontxFile *fx, uint16_t x, uint16_t y, uint16_t cols, uint16_t rows, uint16_t slots) {
+	memset(con, 0, sizeof(CONSOLE_t));
+	uint8_t pw, ph;
+	if (!GetFontx(fx, ' ', &pw, &ph)) {
+		ESP_LOGE(TAG, "Font not found.");
+		return false;
+	}
+	if (cols == 0 || rows == 0 || x + cols * pw > dev->_width || y + rows * ph > dev->_height) {
+		ESP_LOGE(TAG, "Console does not fit the screen.");
+		return false;
+	}
+	con->dev = dev;
+	con->fx = fx;
+	con->x = x;
+	con->y = y;
+	con->pw = pw;
+	con->ph = ph;
+	con->cols = cols;
+	con->rows = rows;
+	con->words = (cols + 31) / 32;
+	con->attr = CONSOLE_ATTR_DEFAULT;
+	memcpy(con->palette, console_palette, sizeof(console_palette));
+
+	uint32_t size = 2;
+	while (size < slots) size <<= 1;
+	con->cells = malloc(cols * rows * sizeof(CONSOLE_CELL_t));
+	con->dirty = malloc(con->words * rows * sizeof(uint32_t));
+	con->slots = malloc(size * sizeof(CONSOLE_SLOT_t));
+	if (!dev->_use_frame_buffer && !dev->_mono) con->band = malloc(cols * pw * ph * sizeof(uint16_t));
+	if (con->cells == NULL || con->dirty == NULL || con->slots == NULL
+			|| (!dev->_use_frame_buffer && !dev->_mono && con->band == NULL)) {
+		ESP_LOGE(TAG, "Error allocating console.");
+		lcdConsoleDelete(con);
+		return false;
+	}
+	con->mask = size - 1;
+	ringInit(&con->head, con->slots, sizeof(CONSOLE_SLOT_t), size);
+	atomic_init(&con->dropped, 0);
+
+	con->hw_scroll = !dev->_use_frame_buffer && !dev->_mono && x == 0 && cols * pw == dev->_width
+		&& dev->_offsety + y + rows * ph <= LCD_MEMORY_HEIGHT;
+	if (con->hw_scroll) lcdSetScrollArea(dev, dev->_offsety + y, rows * ph);
+	lcdConsoleClear(con);
+	return true;
+}
+
+// Delete console
+// The panel scrolls as a whole again. Mirroring ESP_LOG on the console
+// stops first. Other tasks calling lcdConsoleWrite must be done.
+void lcdConsoleDelete(CONSOLE_t *con) {
+	if (atomic_load(&log_console) == con) lcdConsoleMirrorLog(NULL);
+	if (con->hw_scroll) {
+		lcdSetScrollArea(con->dev, 0, LCD_MEMORY_HEIGHT);
+		lcdSetScrollStart(con->dev, 0);
+	}
+	free(con->cells);
+	free(con->dirty);
+	free(con->slots);
+	free(con->band);
+	con->cells = NULL;
+	con->dirty = NULL;
+	con->slots = NULL;
+	con->band = NULL;
+	con->hw_scroll = false;
+}
+
+// Set palette color
+// index:Palette index 0-15, 8-15 are the bright colors
+// color:color
+void lcdConsoleSetPalette(CONSOLE_t *con, uint8_t index, uint16_t color) {
+	if (index >= 16) return;
+	con->palette[index] = color;
+	memset(con->dirty, 0xFF, con->words * con->rows * sizeof(uint32_t));
+}
+
+// Fill ring row with blanks of the current attribute
+static void consoleClearRow(CONSOLE_t *con, uint16_t p) {
+	CONSOLE_CELL_t *cell = &con->cells[p * con->cols];
+	for (uint16_t c = 0; c < con->cols; c++) {
+		cell[c].ch = ' ';
+		cell[c].attr = con->attr;
+	}
+	memset(&con->dirty[p * con->words], 0xFF, con->words * sizeof(uint32_t));
+}
+
+// Clear console and move the cursor to the top left
+// Call from the task drawing the console.
+void lcdConsoleClear(CONSOLE_t *con) {
+	con->top = 0;
+	con->cx = 0;
+	con->cy = 0;
+	con->scrolled = 0;
+	for (uint16_t p = 0; p < con->rows; p++) consoleClearRow(con, p);
+	if (con->hw_scroll) lcdSetScrollStart(con->dev, con->dev->_offsety + con->y);
+}
+
+// Queue text
+// Safe from any task. Text is shown by the next lcdConsoleUpdate.
+// text:Text with ANSI color escapes
+// length:Characters of text
+// Returns false when the queue is full and the text was dropped
+bool lcdConsoleWrite(CONSOLE_t *con, const char *text, size_t length) {
+	if (length == 0) return true;
+	uint32_t n = (length + CONSOLE_SLOT_TEXT - 1) / CONSOLE_SLOT_TEXT;
+	if (n > con->mask + 1) {
+		n = con->mask + 1;
+		atomic_fetch_add_explicit(&con->dropped, length - n * CONSOLE_SLOT_TEXT, memory_order_relaxed);
+		length = n * CONSOLE_SLOT_TEXT;
+	}
+	uint32_t pos;
+	if (!ringClaim(&con->head, con->slots, sizeof(CONSOLE_SLOT_t), con->mask, n, &pos)) {
+		atomic_fetch_add_explicit(&con->dropped, length, memory_order_relaxed);
+		return false;
+	}
+	for (uint32_t i = 0; i < n; i++) {
+		CONSOLE_SLOT_t *slot = &con->slots[(pos + i) & con->mask];
+		size_t k = (length > CONSOLE_SLOT_TEXT) ? CONSOLE_SLOT_TEXT : length;
+		memcpy(slot->text, text, k);
+		slot->length = k;
+		text += k;
+		length -= k;
+		ringPublish(con->slots, sizeof(CONSOLE_SLOT_t), con->mask, pos + i);
+	}
+	return true;
+}
+
+// Queue formatted text, at most CONSOLE_LOG_LINE-1 characters
+// Returns characters queued or a negative value on a format error
+int lcdConsolePrintf(CONSOLE_t *con, const char *format, ...) {
+	char buf[CONSOLE_LOG_LINE];
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	if (n < 0) return n;
+	if (n >= (int)sizeof(buf)) n = sizeof(buf) - 1;
+	lcdConsoleWrite(con, buf, n);
+	return n;
+}
+
+static int consoleLogVprintf(const char *format, va_list args) {
+	// Counted before the console is read, so lcdConsoleMirrorLog either
+	// sees this task or this task sees the new console
+	atomic_fetch_add(&log_writers, 1);
+	CONSOLE_t *con = atomic_load(&log_console);
+	if (con) {
+		char buf[CONSOLE_LOG_LINE];
+		va_list copy;
+		va_copy(copy, args);
+		int n = vsnprintf(buf, sizeof(buf), format, copy);
+		va_end(copy);
+		if (n >= (int)sizeof(buf)) {
+			// Cut line, reset the color for the next one
+			n = sizeof(buf) - 1;
+			memcpy(&buf[n - 5], "\033[0m\n", 5);
+		}
+		if (n > 0) lcdConsoleWrite(con, buf, n);
+	}
+	vprintf_like_t next = log_vprintf;
+	atomic_fetch_sub(&log_writers, 1);
+	return next ? next(format, args) : 0;
+}
+
+// Mirror ESP_LOG output on the console
+// Output still goes to the previous log function, usually the UART.
+// Returns once no task writes to the console mirrored before.
+// con:Console, NULL stops mirroring
+void lcdConsoleMirrorLog(CONSOLE_t *con) {
+	CONSOLE_t *old = atomic_load(&log_console);
+	if (con && old == NULL) {
+		// Read the current function before the hook can run. Lines logged
+		// in between go straight to vprintf.
+		log_vprintf = esp_log_set_vprintf(vprintf);
+		esp_log_set_vprintf(consoleLogVprintf);
+	} else if (con == NULL && old) {
+		// log_vprintf is kept for tasks still inside consoleLogVprintf
+		esp_log_set_vprintf(log_vprintf);
+	}
+	atomic_store(&log_console, con);
+	if (old == NULL || old == con) return;
+	while (atomic_load(&log_writers)) vTaskDelay(1);
+}
+
+static void consoleNewline(CONSOLE_t *con) {
+	con->cx = 0;
+	if (con->cy + 1 < con->rows) {
+		con->cy++;
+		return;
+	}
+	// The top row becomes the bottom row
+	uint16_t p = con->top;
+	con->top = (con->top + 1) % con->rows;
+	consoleClearRow(con, p);
+	if (con->scrolled < con->rows) con->scrolled++;
+}
+
+// Apply SGR parameter
+static void consoleAttribute(CONSOLE_t *con, uint8_t n) {
+	uint8_t fg = con->attr & 0x0F;
+	uint8_t bg = con->attr >> 4;
+	if (n == 0) {
+		fg = CONSOLE_ATTR_DEFAULT & 0x0F;
+		bg = CONSOLE_ATTR_DEFAULT >> 4;
+	} else if (n == 1) {
+		fg |= 0x08;
+	} else if (n == 22) {
+		fg &= 0x07;
+	} else if (n >= 30 && n <= 37) {
+		fg = (fg & 0x08) | (n - 30);
+	} else if (n == 39) {
+		fg = CONSOLE_ATTR_DEFAULT & 0x0F;
+	} else if (n >= 40 && n <= 47) {
+		bg = n - 40;
+	} else if (n == 49) {
+		bg = CONSOLE_ATTR_DEFAULT >> 4;
+	} else if (n >= 90 && n <= 97) {
+		fg = n - 90 + 8;
+	} else if (n >= 100 && n <= 107) {
+		bg = n - 100 + 8;
+	}
+	con->attr = (bg << 4) | fg;
+}
+
+// Escape sequences, only ESC [ ... m is applied
+static void consoleEscape(CONSOLE_t *con, uint8_t ch) {
+	if (con->esc == 1) {
+		con->esc = (ch == '[') ? 2 : 0;
+		con->esc_n = 0;
+		con->esc_params[0] = 0;
+		return;
+	}
+	if (ch >= '0' && ch <= '9') {
+		uint8_t *v = &con->esc_params[con->esc_n];
+		if (*v < 200) *v = *v * 10 + (ch - '0');
+		return;
+	}
+	if (ch == ';') {
+		if (con->esc_n < sizeof(con->esc_params) - 1) con->esc_n++;
+		con->esc_params[con->esc_n] = 0;
+		return;
+	}
+	if (ch == 'm') {
+		for (uint8_t i = 0; i <= con->esc_n; i++) consoleAttribute(con, con->esc_params[i]);
+	}
+	con->esc = 0;
+}
+
+static void consolePut(CONSOLE_t *con, uint8_t ch) {
+	if (con->esc) {
+		consoleEscape(con, ch);
+		return;
+	}
+	switch (ch) {
+	case 0x1B:
+		con->esc = 1;
+		return;
+	case '\n':
+		consoleNewline(con);
+		return;
+	case '\r':
+		con->cx = 0;
+		return;
+	case '\t':
+		con->cx = (con->cx + 8) & ~7;
+		if (con->cx > con->cols) con->cx = con->cols;
+		return;
+	case '\b':
+		if (con->cx > 0) con->cx--;
+		return;
+	}
+	if (ch < 0x20) return;
+	if (con->cx >= con->cols) consoleNewline(con);
+	uint16_t p = (con->top + con->cy) % con->rows;
+	CONSOLE_CELL_t *cell = &con->cells[p * con->cols + con->cx];
+	if (cell->ch != ch || cell->attr != con->attr) {
+		cell->ch = ch;
+		cell->attr = con->attr;
+		con->dirty[p * con->words + (con->cx >> 5)] |= 1u << (con->cx & 31);
+	}
+	con->cx++;
+}
+
+// Expand cells c0..c1-1 of ring row p to pixels
+// dst:First pixel of the run, stride:Pixels per line of dst
+static void consoleExpand(CONSOLE_t *con, uint16_t p, uint16_t c0, uint16_t c1, uint16_t *dst, uint16_t stride) {
+	uint16_t bpr = (con->pw + 7) / 8;
+	for (uint16_t c = c0; c < c1; c++) {
+		const CONSOLE_CELL_t *cell = &con->cells[p * con->cols + c];
+		uint16_t fg = con->palette[cell->attr & 0x0F];
+		uint16_t bg = con->palette[cell->attr >> 4];
+		uint16_t *d = &dst[(c - c0) * con->pw];
+		if (!GetFontx(con->fx, cell->ch, NULL, NULL)) {
+			for (uint8_t h = 0; h < con->ph; h++) rgb565Fill(&d[h * stride], bg, con->pw);
+			continue;
+		}
+		const uint8_t *glyph = con->fx->fonts;
+		for (uint8_t h = 0; h < con->ph; h++) {
+			const uint8_t *bits = &glyph[h * bpr];
+			uint16_t *line = &d[h * stride];
+			for (uint8_t i = 0; i < con->pw; i++) {
+				line[i] = (bits[i >> 3] & (0x80 >> (i & 7))) ? fg : bg;
+			}
+		}
+	}
+}
+
+// Draw cells c0..c1-1 of ring row p with the top at screen row sy
+static void consoleDrawRun(CONSOLE_t *con, uint16_t p, uint16_t c0, uint16_t c1, uint16_t sy) {
+	TFT_t *dev = con->dev;
+	uint16_t sx = con->x + c0 * con->pw;
+	uint16_t w = (c1 - c0) * con->pw;
+
+	if (dev->_mono) {
+		uint16_t bpr = (con->pw + 7) / 8;
+		for (uint16_t c = c0; c < c1; c++) {
+			const CONSOLE_CELL_t *cell = &con->cells[p * con->cols + c];
+			uint16_t fg = con->palette[cell->attr & 0x0F];
+			uint16_t bg = con->palette[cell->attr >> 4];
+			uint16_t cx = sx + (c - c0) * con->pw;
+			if (!GetFontx(con->fx, cell->ch, NULL, NULL)) {
+				lcdDrawFillRect(dev, cx, sy, cx + con->pw - 1, sy + con->ph - 1, bg);
+				continue;
+			}
+			const uint8_t *glyph = con->fx->fonts;
+			for (uint8_t h = 0; h < con->ph; h++) {
+				for (uint8_t i = 0; i < con->pw; i++) {
+					bool on = glyph[h * bpr + (i >> 3)] & (0x80 >> (i & 7));
+					monoSetPixel(dev, cx + i, sy + h, on ? fg : bg);
+				}
+			}
+		}
+	} else if (dev->_use_frame_buffer) {
+		consoleExpand(con, p, c0, c1, &dev->_frame_buffer[sy * dev->_stride + sx], dev->_stride);
+	} else {
+		consoleExpand(con, p, c0, c1, con->band, w);
+		spi_master_write_command(dev, 0x2A);	// set column(x) address
+		spi_master_write_addr(dev, sx + dev->_offsetx, sx + w - 1 + dev->_offsetx);
+		spi_master_write_command(dev, 0x2B);	// set Page(y) address
+		spi_master_write_addr(dev, sy + dev->_offsety, sy + con->ph - 1 + dev->_offsety);
+		spi_master_write_command(dev, 0x2C);	// Memory Write
+		uint32_t size = w * con->ph;
+		for (uint32_t i = 0; i < size; i += CONSOLE_WINDOW_MAX) {
+			uint32_t n = (size - i < CONSOLE_WINDOW_MAX) ? size - i : CONSOLE_WINDOW_MAX;
+			spi_master_write_colors(dev, &con->band[i], n);
+		}
+	}
+}
+
+// Show queued text
+// Call from the task drawing the screen, once per frame.
+// Returns cells drawn
+uint32_t lcdConsoleUpdate(CONSOLE_t *con) {
+	TFT_t *dev = con->dev;
+	// Take queued text
+	while (1) {
+		if (!ringReady(con->slots, sizeof(CONSOLE_SLOT_t), con->mask, con->tail)) break;
+		CONSOLE_SLOT_t *slot = &con->slots[con->tail & con->mask];
+		for (uint8_t i = 0; i < slot->length; i++) consolePut(con, slot->text[i]);
+		ringRelease(con->slots, sizeof(CONSOLE_SLOT_t), con->mask, con->tail);
+		con->tail++;
+	}
+
+	uint16_t x2 = con->x + con->cols * con->pw - 1;
+	uint16_t y2 = con->y + con->rows * con->ph - 1;
+	bool flush_all = false;
+	if (con->scrolled) {
+		if (con->hw_scroll) {
+			lcdSetScrollStart(dev, dev->_offsety + con->y + con->top * con->ph);
+		} else if (dev->_use_frame_buffer && con->scrolled < con->rows) {
+			// Rows kept on the screen move up, the new rows are dirty
+			lcdMoveRect(dev, con->x, con->y + con->scrolled * con->ph, x2, y2, con->x, con->y);
+			flush_all = true;
+		} else {
+			memset(con->dirty, 0xFF, con->words * con->rows * sizeof(uint32_t));
+			flush_all = dev->_use_frame_buffer;
+		}
+		con->scrolled = 0;
+	}
+
+	// Draw dirty runs, flushing bands of consecutive rows
+	uint32_t drawn = 0;
+	int band_y1 = -1;
+	uint16_t band_y2 = 0, band_x1 = 0, band_x2 = 0;
+	for (uint16_t r = 0; r <= con->rows; r++) {
+		bool row_drawn = false;
+		uint16_t sy = 0, rx1 = x2, rx2 = con->x;
+		if (r < con->rows) {
+			uint16_t p = (con->top + r) % con->rows;
+			uint32_t *bits = &con->dirty[p * con->words];
+			sy = con->y + (con->hw_scroll ? p : r) * con->ph;
+			uint16_t c = 0;
+			while (c < con->cols) {
+				if ((c & 31) == 0 && bits[c >> 5] == 0) {
+					c += 32;
+					continue;
+				}
+				if (!(bits[c >> 5] & (1u << (c & 31)))) {
+					c++;
+					continue;
+				}
+				uint16_t c0 = c;
+				while (c < con->cols && (bits[c >> 5] & (1u << (c & 31)))) c++;
+				consoleDrawRun(con, p, c0, c, sy);
+				drawn += c - c0;
+				row_drawn = true;
+				if (con->x + c0 * con->pw < rx1) rx1 = con->x + c0 * con->pw;
+				if (con->x + c * con->pw - 1 > rx2) rx2 = con->x + c * con->pw - 1;
+			}
+			memset(bits, 0, con->words * sizeof(uint32_t));
+		}
+		if (!dev->_use_frame_buffer || flush_all) continue;
+		if (row_drawn) {
+			if (band_y1 < 0) {
+				band_y1 = sy;
+				band_x1 = rx1;
+				band_x2 = rx2;
+			}
+			if (rx1 < band_x1) band_x1 = rx1;
+			if (rx2 > band_x2) band_x2 = rx2;
+			band_y2 = sy + con->ph - 1;
+		} else if (band_y1 >= 0) {
+			lcdDrawFinishRect(dev, band_x1, band_y1, band_x2, band_y2);
+			band_y1 = -1;
+		}
+	}
+	if (flush_all) lcdDrawFinishRect(dev, con->x, con->y, x2, y2);
+	return drawn;
+}
@@ -0,0 +1,84 @@
+#ifndef MAIN_CONSOLE_H_
+#define MAIN_CONSOLE_H_
+
+#include <stdatomic.h>
+
+#include "st7789.h"
+
+// Text console and log viewer.
+// The console is a grid of character cells, each with a character and a
+// color attribute. Any task writes text with lcdConsoleWrite, which copies
+// it into a lock-free ring of slots and never waits: text that does not
+// fit is dropped and counted. The task that owns TFT_t calls
+// lcdConsoleUpdate once per frame. It moves all queued text into the grid,
+// draws the cells marked in the dirty bitmap and sends them to the panel,
+// so a burst of lines costs one update.
+// Rows of the grid are kept as a ring and a scroll only clears the new
+// row. When the console spans the screen width and there is no frame
+// buffer, the panel scrolls in hardware and only changed rows are sent.
+// With a frame buffer the pixels are moved and the console is sent once.
+// Otherwise every row is drawn again.
+// ANSI color escapes, as written by ESP_LOG, pick colors of a 16 color
+// palette.
+
+// Characters per queue slot, longer text takes consecutive slots
+#define CONSOLE_SLOT_TEXT 27
+
+// Longest ESP_LOG line mirrored, longer lines are cut
+#define CONSOLE_LOG_LINE 128
+
+// Default attribute, palette color 7 on 0
+#define CONSOLE_ATTR_DEFAULT 0x07
+
+typedef struct {
+	_Atomic uint32_t sequence;	// First member, see ring.h
+	uint8_t length;
+	char text[CONSOLE_SLOT_TEXT];
+} CONSOLE_SLOT_t;
+
+typedef struct {
+	uint8_t ch;
+	uint8_t attr;		// Foreground color in the low nibble, background in the high nibble
+} CONSOLE_CELL_t;
+
+typedef struct {
+	TFT_t *dev;
+	FontxFile *fx;
+	uint16_t x;		// Top left on the screen
+	uint16_t y;
+	uint8_t pw;		// Cell size
+	uint8_t ph;
+	uint16_t cols;
+	uint16_t rows;
+	CONSOLE_CELL_t *cells;	// Ring of rows
+	uint32_t *dirty;	// Cells to draw, one bit per cell of the ring
+	uint16_t words;		// Words of dirty per row
+	uint16_t top;		// Ring row shown at the top
+	uint16_t cx;		// Cursor column, cols after the last column
+	uint16_t cy;		// Cursor row from the top
+	uint8_t attr;
+	uint16_t palette[16];
+	uint16_t scrolled;	// Rows scrolled since the last update
+	bool hw_scroll;		// Panel scrolls in hardware
+	uint16_t *band;		// Pixels of one row of cells without frame buffer
+	uint8_t esc;		// Escape sequence state
+	uint8_t esc_n;		// Parameters of the escape sequence
+	uint8_t esc_params[4];
+	// Queue
+	CONSOLE_SLOT_t *slots;
+	uint32_t mask;
+	_Atomic uint32_t head;	// Next slot to claim
+	uint32_t tail;		// Next slot to read
+	_Atomic uint32_t dropped;	// Characters lost to a full queue
+} CONSOLE_t;
+
+bool lcdConsoleInit(CONSOLE_t *con, TFT_t *dev, FontxFile *fx, uint16_t x, uint16_t y, uint16_t cols, uint16_t rows, uint16_t slots);
+void lcdConsoleDelete(CONSOLE_t *con);
+void lcdConsoleSetPalette(CONSOLE_t *con, uint8_t index, uint16_t color);
+void lcdConsoleClear(CONSOLE_t *con);
+bool lcdConsoleWrite(CONSOLE_t *con, const char *text, size_t length);
+int lcdConsolePrintf(CONSOLE_t *con, const char *format, ...);
+void lcdConsoleMirrorLog(CONSOLE_t *con);
+uint32_t lcdConsoleUpdate(CONSOLE_t *con);
+
+#endif /* MAIN_CONSOLE_H_ */
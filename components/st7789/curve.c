@@ -0,0 +1,260 @@
+#include <stdlib.h>
+
+#include "st7789.h"
+#include "raster.h"
+
+// Flattening tolerance, 24.8 (a quarter pixel)
+#define CURVE_TOLERANCE (FIX_ONE / 4)
+
+// Most segments of one Bezier curve, as power of two
+#define CURVE_MAX_SHIFT 8
+
+static int32_t iabs(int32_t v) {
+	return (v < 0) ? -v : v;
+}
+
+// Segments needed for a curve, as power of two
+// d:Largest second difference of the control points, 24.8
+// k:Error bound factor, 1 for quadratic and 3 for cubic
+static uint8_t curveShift(int32_t d, int32_t k) {
+	// Error of n segments is about k*d/(4*n*n)
+	uint32_t n = rasterSqrt((uint64_t)k * d / (4 * CURVE_TOLERANCE)) + 1;
+	uint8_t shift = 0;
+	while ((1u << shift) < n && shift < CURVE_MAX_SHIFT) shift++;
+	return shift;
+}
+
+// Flatten quadratic Bezier with forward differencing
+// Returns (1<<shift)+1 points in 24.8, to be freed by the caller.
+// p:3 control points, 24.8
+// count:Number of points
+static int32_t *curveQuad(const int32_t *p, uint16_t *count) {
+	int32_t ax = p[0] - 2*p[2] + p[4];
+	int32_t ay = p[1] - 2*p[3] + p[5];
+	uint8_t shift = curveShift(iabs(ax) + iabs(ay), 1);
+	int64_t n = 1 << shift;
+	int32_t *xy = malloc(sizeof(int32_t) * 2 * (n + 1));
+	if (xy == NULL) return NULL;
+
+	// B(t) = a*t^2 + b*t + p0, scaled by n^2
+	int32_t bx = 2 * (p[2] - p[0]);
+	int32_t by = 2 * (p[3] - p[1]);
+	int64_t x = (int64_t)p[0] * n * n;
+	int64_t y = (int64_t)p[1] * n * n;
+	int64_t d1x = ax + bx * n;
+	int64_t d1y = ay + by * n;
+	int64_t d2x = 2 * (int64_t)ax;
+	int64_t d2y = 2 * (int64_t)ay;
+	int64_t half = (n * n) / 2;
+
+	xy[0] = p[0];
+	xy[1] = p[1];
+	for (int i = 1; i <= n; i++) {
+		x += d1x;
+		y += d1y;
+		d1x += d2x;
+		d1y += d2y;
+		xy[i*2] = (x + half) >> (2 * shift);
+		xy[i*2+1] = (y + half) >> (2 * shift);
+	}
+	*count = n + 1;
+	return xy;
+}
+
+// Flatten cubic Bezier with forward differencing
+// Returns (1<<shift)+1 points in 24.8, to be freed by the caller.
+// p:4 control points, 24.8
+// count:Number of points
+static int32_t *curveCubic(const int32_t *p, uint16_t *count) {
+	int32_t d1 = iabs(p[0] - 2*p[2] + p[4]) + iabs(p[1] - 2*p[3] + p[5]);
+	int32_t d2 = iabs(p[2] - 2*p[4] + p[6]) + iabs(p[3] - 2*p[5] + p[7]);
+	uint8_t shift = curveShift((d1 > d2) ? d1 : d2, 3);
+	int64_t n = 1 << shift;
+	int32_t *xy = malloc(sizeof(int32_t) * 2 * (n + 1));
+	if (xy == NULL) return NULL;
+
+	// B(t) = a*t^3 + b*t^2 + c*t + p0, scaled by n^3
+	int64_t ax = -p[0] + 3*p[2] - 3*p[4] + p[6];
+	int64_t ay = -p[1] + 3*p[3] - 3*p[5] + p[7];
+	int64_t bx = 3*p[0] - 6*p[2] + 3*p[4];
+	int64_t by = 3*p[1] - 6*p[3] + 3*p[5];
+	int64_t cx = 3 * (p[2] - p[0]);
+	int64_t cy = 3 * (p[3] - p[1]);
+	int64_t x = p[0] * n * n * n;
+	int64_t y = p[1] * n * n * n;
+	int64_t d1x = ax + bx * n + cx * n * n;
+	int64_t d1y = ay + by * n + cy * n * n;
+	int64_t d2x = 6 * ax + 2 * bx * n;
+	int64_t d2y = 6 * ay + 2 * by * n;
+	int64_t d3x = 6 * ax;
+	int64_t d3y = 6 * ay;
+	int64_t half = (n * n * n) / 2;
+
+	xy[0] = p[0];
+	xy[1] = p[1];
+	for (int i = 1; i <= n; i++) {
+		x += d1x;
+		y += d1y;
+		d1x += d2x;
+		d1y += d2y;
+		d2x += d3x;
+		d2y += d3y;
+		xy[i*2] = (x + half) >> (3 * shift);
+		xy[i*2+1] = (y + half) >> (3 * shift);
+	}
+	*count = n + 1;
+	return xy;
+}
+
+static void curveStroke(TFT_t * dev, const int32_t *xy, uint16_t n, uint16_t width, CAP_t cap, bool closed, uint16_t color) {
+	RASTER_t r;
+	rasterInit(&r);
+	rasterAddStroke(&r, xy, n, width, JOIN_MITER, cap, closed);
+	rasterFill(dev, &r, rasterSolidSpan, &color);
+	rasterFree(&r);
+}
+
+// Draw quadratic Bezier curve
+// points:Start point, control point, end point
+// width:Line width
+// cap:Shape of both ends
+// color:color
+void lcdDrawQuadBezier(TFT_t * dev, const POINT_t *points, uint16_t width, CAP_t cap, uint16_t color) {
+	int32_t p[6];
+	uint16_t n;
+	for (int i = 0; i < 3; i++) {
+		p[i*2] = TO_FIX(points[i].x);
+		p[i*2+1] = TO_FIX(points[i].y);
+	}
+	int32_t *xy = curveQuad(p, &n);
+	if (xy == NULL) return;
+	curveStroke(dev, xy, n, width, cap, false, color);
+	free(xy);
+}
+
+// Draw cubic Bezier curve
+// points:Start point, 2 control points, end point
+// width:Line width
+// cap:Shape of both ends
+// color:color
+void lcdDrawCubicBezier(TFT_t * dev, const POINT_t *points, uint16_t width, CAP_t cap, uint16_t color) {
+	int32_t p[8];
+	uint16_t n;
+	for (int i = 0; i < 4; i++) {
+		p[i*2] = TO_FIX(points[i].x);
+		p[i*2+1] = TO_FIX(points[i].y);
+	}
+	int32_t *xy = curveCubic(p, &n);
+	if (xy == NULL) return;
+	curveStroke(dev, xy, n, width, cap, false, color);
+	free(xy);
+}
+
+// Binary angle of start and sweep
+// Angles are degrees, counterclockwise from 3 o'clock.
+// A sweep of 0 is a full circle.
+static void arcAngles(int16_t start, int16_t end, uint16_t *a0, uint32_t *sweep) {
+	int32_t s = start % 360;
+	if (s < 0) s += 360;
+	int32_t d = (end - start) % 360;
+	if (d <= 0) d += 360;
+	*a0 = (uint32_t)s * 0x10000 / 360;
+	*sweep = (uint32_t)d * 0x10000 / 360;
+}
+
+// Segments of a circular arc
+static uint16_t arcSegments(int32_t radius, uint32_t sweep) {
+	uint32_t n = (rasterCircleSegments(radius) * sweep + 0xFFFF) >> 16;
+	return (n < 1) ? 1 : n;
+}
+
+// Point k of the n segments of a circular arc
+static void arcPoint(int32_t xc, int32_t yc, int32_t radius, uint16_t a0, uint32_t sweep, uint32_t k, uint32_t n, int32_t *x, int32_t *y) {
+	uint16_t angle = a0 + (uint16_t)(sweep * k / n);
+	*x = xc + (int32_t)(((int64_t)radius * rasterCos(angle)) >> 15);
+	*y = yc - (int32_t)(((int64_t)radius * rasterSin(angle)) >> 15);
+}
+
+// Add points of a circular arc to a polygon
+// reverse:From end to start
+static void arcPolygonPoints(RASTER_PATH_t *path, int32_t xc, int32_t yc, int32_t radius, uint16_t a0, uint32_t sweep, bool reverse) {
+	uint16_t n = arcSegments(radius, sweep);
+	for (uint32_t i = 0; i <= n; i++) {
+		int32_t x, y;
+		arcPoint(xc, yc, radius, a0, sweep, reverse ? n - i : i, n, &x, &y);
+		rasterPolygonPoint(path, x, y);
+	}
+}
+
+// Draw arc
+// xc:Center X coordinate
+// yc:Center Y coordinate
+// r:radius
+// start:Start angle(degree, counterclockwise from 3 o'clock)
+// end:End angle, same as start for full circle
+// width:Line width
+// cap:Shape of both ends
+// color:color
+void lcdDrawArc(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t r, int16_t start, int16_t end, uint16_t width, CAP_t cap, uint16_t color) {
+	uint16_t a0;
+	uint32_t sweep;
+	arcAngles(start, end, &a0, &sweep);
+	uint16_t n = arcSegments(TO_FIX(r), sweep);
+	int32_t *xy = malloc(sizeof(int32_t) * 2 * (n + 1));
+	if (xy == NULL) return;
+	for (uint16_t i = 0; i <= n; i++) {
+		arcPoint(TO_FIX(xc), TO_FIX(yc), TO_FIX(r), a0, sweep, i, n, &xy[i*2], &xy[i*2+1]);
+	}
+	curveStroke(dev, xy, n + 1, width, cap, sweep == 0x10000, color);
+	free(xy);
+}
+
+// Draw pie of filling
+// xc:Center X coordinate
+// yc:Center Y coordinate
+// r:radius
+// start:Start angle(degree, counterclockwise from 3 o'clock)
+// end:End angle, same as start for full circle
+// color:color
+void lcdDrawFillPie(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t r, int16_t start, int16_t end, uint16_t color) {
+	uint16_t a0;
+	uint32_t sweep;
+	arcAngles(start, end, &a0, &sweep);
+
+	RASTER_t rs;
+	RASTER_PATH_t path;
+	rasterInit(&rs);
+	rasterBeginPolygon(&rs, &path);
+	rasterPolygonPoint(&path, TO_FIX(xc), TO_FIX(yc));
+	arcPolygonPoints(&path, TO_FIX(xc), TO_FIX(yc), TO_FIX(r), a0, sweep, false);
+	rasterEndPolygon(&path);
+	rasterFill(dev, &rs, rasterSolidSpan, &color);
+	rasterFree(&rs);
+}
+
+// Draw annulus sector of filling
+// Used for progress rings and gauge scales.
+// xc:Center X coordinate
+// yc:Center Y coordinate
+// r1:Inner radius
+// r2:Outer radius
+// start:Start angle(degree, counterclockwise from 3 o'clock)
+// end:End angle, same as start for full ring
+// color:color
+void lcdDrawFillAnnulus(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t r1, uint16_t r2, int16_t start, int16_t end, uint16_t color) {
+	uint16_t a0;
+	uint32_t sweep;
+	if (r1 >= r2) return;
+	arcAngles(start, end, &a0, &sweep);
+
+	// Outer arc forward, then inner arc backward
+	RASTER_t rs;
+	RASTER_PATH_t path;
+	rasterInit(&rs);
+	rasterBeginPolygon(&rs, &path);
+	arcPolygonPoints(&path, TO_FIX(xc), TO_FIX(yc), TO_FIX(r2), a0, sweep, false);
+	arcPolygonPoints(&path, TO_FIX(xc), TO_FIX(yc), TO_FIX(r1), a0, sweep, true);
+	rasterEndPolygon(&path);
+	rasterFill(dev, &rs, rasterSolidSpan, &color);
+	rasterFree(&rs);
+}
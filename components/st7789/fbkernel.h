@@ -0,0 +1,61 @@
+#ifndef MAIN_FBKERNEL_H_
+#define MAIN_FBKERNEL_H_
+
+#include <stdint.h>
+
+#include "esp_attr.h"
+#include "blend.h"
+
+// Frame buffer kernels
+// The geometry is passed as arguments, so the same code serves the screen,
+// render targets and render bands.
+FORCE_INLINE_ATTR void lcdFbPixel(uint16_t *fb, int stride, int width, int height, uint16_t x, uint16_t y, uint16_t color) {
+	if (x >= width) return;
+	if (y >= height) return;
+	fb[y*stride+x] = color;
+}
+
+FORCE_INLINE_ATTR void lcdFbFillRect(uint16_t *fb, int stride, int width, int height, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	// Corners left or above the screen are clipped as negative coordinates
+	if ((int16_t)x2 < 0 || (int16_t)y2 < 0) return;
+	if ((int16_t)x1 < 0) x1 = 0;
+	if ((int16_t)y1 < 0) y1 = 0;
+	if (x1 >= width) return;
+	if (x2 >= width) x2 = width-1;
+	if (y1 >= height) return;
+	if (y2 >= height) y2 = height-1;
+	if (x1 > x2 || y1 > y2) return;
+	uint16_t *p = &fb[y1*stride+x1];
+	for (int j = y1; j <= y2; j++) {
+		rgb565Fill(p, color, x2-x1+1);
+		p += stride;
+	}
+}
+
+FORCE_INLINE_ATTR void lcdFbHLine(uint16_t *fb, int stride, int width, int height, int x1, int x2, int y, uint16_t color) {
+	if (x1 > x2) {
+		int temp = x1; x1 = x2; x2 = temp;
+	}
+	if (y < 0 || y >= height) return;
+	if (x1 < 0) x1 = 0;
+	if (x2 >= width) x2 = width-1;
+	if (x1 > x2) return;
+	rgb565Fill(&fb[y*stride+x1], color, x2-x1+1);
+}
+
+FORCE_INLINE_ATTR void lcdFbVLine(uint16_t *fb, int stride, int width, int height, int x, int y1, int y2, uint16_t color) {
+	if (y1 > y2) {
+		int temp = y1; y1 = y2; y2 = temp;
+	}
+	if (x < 0 || x >= width) return;
+	if (y1 < 0) y1 = 0;
+	if (y2 >= height) y2 = height-1;
+	if (y1 > y2) return;
+	uint16_t *p = &fb[y1*stride+x];
+	for (int j = y1; j <= y2; j++) {
+		*p = color;
+		p += stride;
+	}
+}
+
+#endif /* MAIN_FBKERNEL_H_ */
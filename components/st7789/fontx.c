@@ -1,16 +1,48 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
-#include "esp_err.h"
+
+// Font images are mapped from flash partitions on the chip. Host builds,
+// the linux target of ESP-IDF included, map files instead.
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
 #include "esp_log.h"
+#endif
+#if defined(ESP_PLATFORM) && !defined(CONFIG_IDF_TARGET_LINUX)
+#define FONTX_FLASH 1
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#include "esp_partition.h"
+#else
+#define FONTX_FLASH 0
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+#if !defined(ESP_PLATFORM)
+#define ESP_LOGE(tag, format, ...) printf("E %s: " format "\n", tag, ##__VA_ARGS__)
+#endif
 
 #include "fontx.h"
 
 #define FontxDebug 0 // for Debug
 
+#if FONTX_FLASH
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define FONTX_MMAP_DATA ESP_PARTITION_MMAP_DATA
+#define FONTX_MUNMAP(handle) esp_partition_munmap(handle)
+typedef esp_partition_mmap_handle_t FONTX_MMAP_HANDLE_t;
+#else
+#define FONTX_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define FONTX_MUNMAP(handle) spi_flash_munmap(handle)
+typedef spi_flash_mmap_handle_t FONTX_MMAP_HANDLE_t;
+#endif
+#endif
+
 // Save font file path in FontxFile structure
 // フォントファイルパスをFontxFile構造体に保存
 void AddFontx(FontxFile *fx, const char *path)
@@ -28,11 +60,246 @@ void InitFontx(FontxFile *fxs, const char *f0, const char *f1)
 	AddFontx(&fxs[1], f1);
 }
 
+// Check that an ANK table fits in the heap with the reserve left over
+static bool FontxPreloadFits(size_t size)
+{
+#if FONTX_FLASH
+	size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+	return size + FONTX_PRELOAD_RESERVE <= largest;
+#else
+	(void)size;
+	return true;
+#endif
+}
+
+// Allocate glyph cache
+// ANK tables are read whole and the file is closed.
+// Without memory for the cache, glyphs are read from the file each time.
+static void OpenFontxCache(FontxFile *fx)
+{
+	fx->cached = 0;
+	fx->lru_clock = 0;
+	if(fx->is_ank && FontxPreloadFits(256 * fx->fsz)){
+		fx->cache = (uint8_t*)malloc(256 * fx->fsz);
+		if (fx->cache == NULL) return;
+		if(fseek(fx->file, fx->base, SEEK_SET) == 0) {
+			fx->cached = fread(fx->cache, fx->fsz, 256, fx->file);
+		}
+		if (fx->cached == 0) {
+			free(fx->cache);
+			fx->cache = NULL;
+			return;
+		}
+		fclose(fx->file);
+		fx->file = NULL;
+		return;
+	}
+	fx->cache = (uint8_t*)malloc(FONTX_CACHE_GLYPHS * fx->fsz);
+	for(int i=0;i<FONTX_CACHE_GLYPHS;i++) {
+		fx->lru_code[i] = -1;
+		fx->lru_used[i] = 0;
+	}
+}
+
+// Read fontx header
+static void ParseFontx(FontxFile *fx, const uint8_t *buf)
+{
+	if(FontxDebug) {
+		for(int i=0;i<18;i++) {
+			printf("buf[%d]=0x%x\n",i,buf[i]);
+		}
+	}
+
+	memcpy(fx->fxname, &buf[6], 8);
+	fx->w = buf[14];
+	fx->h = buf[15];
+	fx->is_ank = (buf[16] == 0);
+	fx->bc = buf[17];
+	fx->fsz = (fx->w + 7)/8 * fx->h;
+	fx->base = fx->is_ank ? 17 : 18 + 4 * fx->bc;
+	if(FontxDebug)printf("[openFont]fx->fsz=%d\n",fx->fsz);
+}
+
+// Build index of the code blocks of a double byte font
+// table:bc blocks of start and end code, little endian
+static bool ParseFontxBlocks(FontxFile *fx, const uint8_t *table)
+{
+	fx->blocks = (FONTX_BLOCK_t*)malloc(fx->bc * sizeof(FONTX_BLOCK_t));
+	if (fx->blocks == NULL) {
+		ESP_LOGE(__FUNCTION__, "Error allocating memory for blocks");
+		return false;
+	}
+	uint32_t first = 0;
+	for(int i=0;i<fx->bc;i++) {
+		FONTX_BLOCK_t block;
+		block.start = table[i*4] | (table[i*4+1] << 8);
+		block.end = table[i*4+2] | (table[i*4+3] << 8);
+		block.first = first;
+		if (block.end < block.start || first + (block.end - block.start) > 0xFFFF) {
+			printf("Fontx:bad code block %d.\n",i);
+			free(fx->blocks);
+			fx->blocks = NULL;
+			return false;
+		}
+		first += block.end - block.start + 1;
+		// Keep blocks sorted by start code
+		int j = i;
+		while (j > 0 && fx->blocks[j-1].start > block.start) {
+			fx->blocks[j] = fx->blocks[j-1];
+			j--;
+		}
+		fx->blocks[j] = block;
+	}
+	return true;
+}
+
+// Glyph number of a code
+// Returns -1 when the font has no glyph for the code
+static int32_t FontxGlyph(FontxFile *fx, uint16_t code)
+{
+	if(fx->is_ank) return (code < 256) ? code : -1;
+	int lo = 0;
+	int hi = fx->bc;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (fx->blocks[mid].start <= code) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == 0) return -1;
+	const FONTX_BLOCK_t *block = &fx->blocks[lo-1];
+	if (code > block->end) return -1;
+	return block->first + (code - block->start);
+}
+
+// Use font image in memory
+// Glyphs are read in place, nothing is copied.
+static bool MapFontx(FontxFile *fx, const uint8_t *data, size_t size)
+{
+	if (size < 18 || memcmp(data, "FONTX2", 6) != 0) {
+		printf("Fontx:image not FONTX format.\n");
+		return false;
+	}
+	ParseFontx(fx, data);
+	if (fx->fsz == 0 || size < fx->base + fx->fsz) {
+		printf("Fontx:image has no glyphs.\n");
+		return false;
+	}
+	if (!fx->is_ank && !ParseFontxBlocks(fx, &data[18])) return false;
+	size_t glyphs = (size - fx->base) / fx->fsz;
+	size_t max = fx->is_ank ? 256 : 0xFFFF;
+	fx->map = data;
+	fx->cached = (glyphs < max) ? glyphs : max;
+	fx->opened = true;
+	fx->valid = true;
+	return true;
+}
+
+// Open font linked into the application
+// fx must be cleared by InitFontx or AddFontx first.
+// data:Font image, e.g. from EMBED_FILES
+// size:Bytes of font image
+bool OpenFontxMemory(FontxFile *fx, const uint8_t *data, size_t size)
+{
+	CloseFontx(fx);
+	return MapFontx(fx, data, size);
+}
+
+// Use font compiled into the application
+// fx must be cleared by InitFontx or AddFontx first.
+// font:Descriptor generated by tools/fontx2c.py
+bool OpenFontxFont(FontxFile *fx, const FONTX_FONT_t *font)
+{
+	CloseFontx(fx);
+	memset(fx->fxname, 0, sizeof(fx->fxname));
+	strncpy(fx->fxname, font->name, sizeof(fx->fxname) - 1);
+	fx->w = font->w;
+	fx->h = font->h;
+	fx->fsz = font->fsz;
+	fx->is_ank = true;
+	fx->font = font;
+	fx->opened = true;
+	fx->valid = true;
+	return true;
+}
+
+// Map partition or host file as font image
+static bool MapFontxPartition(FontxFile *fx, const char *label)
+{
+#if FONTX_FLASH
+	const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+	if (part == NULL) {
+		printf("Fontx:%s not found.\n",label);
+		return false;
+	}
+	const void *data;
+	FONTX_MMAP_HANDLE_t handle;
+	if (esp_partition_mmap(part, 0, part->size, FONTX_MMAP_DATA, &data, &handle) != ESP_OK) {
+		ESP_LOGE(__FUNCTION__, "Error mapping %s", label);
+		return false;
+	}
+	if (!MapFontx(fx, data, part->size)) {
+		FONTX_MUNMAP(handle);
+		return false;
+	}
+	fx->map_handle = handle;
+	fx->map_size = part->size;
+#else
+	int fd = open(label, O_RDONLY);
+	if (fd < 0) {
+		printf("Fontx:%s not found.\n",label);
+		return false;
+	}
+	struct stat st;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		ESP_LOGE(__FUNCTION__, "Error mapping %s", label);
+		return false;
+	}
+	if (!MapFontx(fx, data, st.st_size)) {
+		munmap(data, st.st_size);
+		return false;
+	}
+	fx->map_size = st.st_size;
+#endif
+	return true;
+}
+
+// Open font from a flash partition
+// fx must be cleared by InitFontx or AddFontx first.
+// The partition is mapped through the flash cache. The host build maps
+// the file named label instead.
+// label:Partition label
+bool OpenFontxPartition(FontxFile *fx, const char *label)
+{
+	CloseFontx(fx);
+	if (MapFontxPartition(fx, label)) {
+		fx->path = label;
+		return true;
+	}
+	// Keep GetFontx from opening the label as a file
+	fx->path = "";
+	fx->opened = true;
+	fx->valid = false;
+	return false;
+}
+
 // Open font file
 // フォントファイルをOPEN
 bool OpenFontx(FontxFile *fx)
 {
 	FILE *f;
+	if(!fx->opened && (fx->path == NULL || fx->path[0] == 0)){
+		// No file, e.g. the second font of InitFontx(fxs, path, "")
+		fx->opened = true;
+		fx->valid = false;
+	}
 	if(!fx->opened){
 		if(FontxDebug)printf("[openFont]fx->path=[%s]\n",fx->path);
 		f = fopen(fx->path, "r");
@@ -54,33 +321,39 @@ bool OpenFontx(FontxFile *fx)
 			return fx->valid ;
 		}
 
-		if(FontxDebug) {
-			for(int i=0;i<sizeof(buf);i++) {
-				printf("buf[%d]=0x%x\n",i,buf[i]);
+		ParseFontx(fx, (uint8_t*)buf);
+
+		// Read code blocks of double byte font
+		if (!fx->is_ank) {
+			uint8_t *table = (uint8_t*)malloc(4 * fx->bc + 1);
+			bool ok = table && fread(table, 4, fx->bc, fx->file) == fx->bc && ParseFontxBlocks(fx, table);
+			free(table);
+			if (!ok) {
+				printf("Fontx:%s bad code blocks.\n",fx->path);
+				fclose(fx->file);
+				fx->valid = false;
+				fx->file = NULL;
+				return fx->valid ;
 			}
 		}
 
-		memcpy(fx->fxname, &buf[6], 8);
-		fx->w = buf[14];
-		fx->h = buf[15];
-		fx->is_ank = (buf[16] == 0);
-		fx->bc = buf[17];
-		fx->fsz = (fx->w + 7)/8 * fx->h;
-		if(FontxDebug)printf("[openFont]fx->fsz=%d\n",fx->fsz);
-
 		// Allocate Glyph memory
 		unsigned char *fonts = (unsigned char*)malloc(fx->fsz);
 		if (fonts == NULL) {
 			ESP_LOGE(__FUNCTION__, "Error allocating memory for fonts");
+			free(fx->blocks);
+			fx->blocks = NULL;
 			fclose(fx->file);
 			fx->valid = false;
 			fx->file = NULL;
 			return fx->valid ;
 		}
 
+		fx->glyph = fonts;
 		fx->fonts = fonts;
 		fx->opened = true;
 		fx->valid = true;
+		OpenFontxCache(fx);
 	}
 	return fx->valid;
 }
@@ -90,10 +363,27 @@ bool OpenFontx(FontxFile *fx)
 void CloseFontx(FontxFile *fx)
 {
 	if(fx->opened){
-		fclose(fx->file);
+		if (fx->file) fclose(fx->file);
 		fx->file = NULL;
-		free(fx->fonts);
+		free(fx->glyph);
+		fx->glyph = NULL;
 		fx->fonts = NULL;
+		if (fx->map_size) {
+#if FONTX_FLASH
+			FONTX_MUNMAP(fx->map_handle);
+#else
+			munmap((void*)fx->map, fx->map_size);
+#endif
+		}
+		fx->map = NULL;
+		fx->map_size = 0;
+		fx->font = NULL;
+		free(fx->blocks);
+		fx->blocks = NULL;
+		free(fx->cache);
+		fx->cache = NULL;
+		free(fx->turned);
+		fx->turned = NULL;
 		fx->opened = false;
 		fx->valid = false;
 	}
@@ -114,6 +404,8 @@ void DumpFontx(FontxFile *fxs)
 		printf("fxs[%d]->fsz=%d\n",i,fxs[i].fsz);
 		printf("fxs[%d]->bc=%d\n",i,fxs[i].bc);
 		printf("fxs[%d]->valid=%d\n",i,fxs[i].valid);
+		printf("fxs[%d]->cached=%d\n",i,fxs[i].cached);
+		printf("fxs[%d]->hits=%"PRIu32" misses=%"PRIu32"\n",i,fxs[i].hits,fxs[i].misses);
 	}
 }
 
@@ -227,10 +519,76 @@ uint8_t getFortHeight(FontxFile *fx) {
 
 */
 
+// Read glyph from font file
+// n:Glyph number
+static bool ReadFontx(FontxFile *fx, uint16_t n, uint8_t *glyph)
+{
+	uint32_t offset = fx->base + n * fx->fsz;
+	if(FontxDebug)printf("[GetFontx]offset=%"PRIu32"\n",offset);
+	if(fseek(fx->file, offset, SEEK_SET)) {
+		printf("Fontx:seek(%"PRIu32") failed.\n",offset);
+		return false;
+	}
+	if(fread(glyph, 1, fx->fsz, fx->file) != fx->fsz) {
+		printf("Fontx:fread failed.\n");
+		return false;
+	}
+	return true;
+}
+
+// Look up glyph in the cache, reading it from the file on a miss
+// code:ANK code, or SJIS code of a double byte font
+// Returns the glyph pattern or NULL
+static const uint8_t *CacheFontx(FontxFile *fx, uint16_t code)
+{
+	if(fx->font){
+		uint16_t i = code - fx->font->first;
+		if(code < fx->font->first || i >= fx->font->count) return NULL;
+		fx->hits++;
+		return &fx->font->bitmaps[fx->font->index[i] * fx->fsz];
+	}
+	int32_t n = FontxGlyph(fx, code);
+	if(n < 0) return NULL;
+	if(fx->map){
+		if(n >= fx->cached) return NULL;
+		fx->hits++;
+		return &fx->map[fx->base + n * fx->fsz];
+	}
+	if(fx->cached){
+		if(n >= fx->cached) return NULL;
+		fx->hits++;
+		return &fx->cache[n * fx->fsz];
+	}
+	if(fx->cache == NULL){
+		fx->misses++;
+		return ReadFontx(fx, n, fx->glyph) ? fx->glyph : NULL;
+	}
+
+	int lru = 0;
+	fx->lru_clock++;
+	for(int i=0;i<FONTX_CACHE_GLYPHS;i++) {
+		if(fx->lru_code[i] == code){
+			fx->hits++;
+			fx->lru_used[i] = fx->lru_clock;
+			return &fx->cache[i * fx->fsz];
+		}
+		if(fx->lru_used[i] < fx->lru_used[lru]) lru = i;
+	}
+	fx->misses++;
+	uint8_t *slot = &fx->cache[lru * fx->fsz];
+	fx->lru_code[lru] = -1;
+	if(!ReadFontx(fx, n, slot)) return NULL;
+	fx->lru_code[lru] = code;
+	fx->lru_used[lru] = fx->lru_clock;
+	return slot;
+}
+
+// Get glyph pattern
+// fxs->fonts points to the glyph until the next call. Glyphs come from
+// the cache or the mapped font, the file is read only on a miss.
 bool GetFontx(FontxFile *fxs, uint8_t ascii, uint8_t *pw, uint8_t *ph)
 {
 	int i;
-	uint32_t offset;
 
 	if(FontxDebug)printf("[GetFontx]ascii=0x%x\n",ascii);
 	for(i=0; i<2; i++){
@@ -240,17 +598,9 @@ bool GetFontx(FontxFile *fxs, uint8_t ascii, uint8_t *pw, uint8_t *ph)
 		// Check ANK font
 		if(fxs[i].is_ank){
 			if(FontxDebug)printf("[GetFontx]fxs.is_ank fxs.fsz=%d\n",fxs[i].fsz);
-			offset = 17 + ascii * fxs[i].fsz;
-			if(FontxDebug)printf("[GetFontx]offset=%"PRIu32"\n",offset);
-			if(fseek(fxs[i].file, offset, SEEK_SET)) {
-				printf("Fontx:seek(%"PRIu32") failed.\n",offset);
-				return false;
-			}
-			//if(fread(pGlyph, 1, fxs[i].fsz, fxs[i].file) != fxs[i].fsz) {
-			if(fread(fxs->fonts, 1, fxs[i].fsz, fxs[i].file) != fxs[i].fsz) {
-				printf("Fontx:fread failed.\n");
-				return false;
-			}
+			const uint8_t *glyph = CacheFontx(&fxs[i], ascii);
+			if(glyph == NULL) return false;
+			fxs->fonts = glyph;
 			if(pw) *pw = fxs[i].w;
 			if(ph) *ph = fxs[i].h;
 			return true;
@@ -259,6 +609,108 @@ bool GetFontx(FontxFile *fxs, uint8_t ascii, uint8_t *pw, uint8_t *ph)
 	return false;
 }
 
+// Get glyph pattern of a SJIS code
+// Single byte codes come from the ANK font, double byte codes from the
+// Kanji font. The glyph is found through the block index, the file is
+// read only on a cache miss.
+bool GetFontxCode(FontxFile *fxs, uint16_t sjis, uint8_t *pw, uint8_t *ph)
+{
+	if(sjis < 0x100) return GetFontx(fxs, sjis, pw, ph);
+	for(int i=0; i<2; i++){
+		if(!OpenFontx(&fxs[i])) continue;
+		if(fxs[i].is_ank) continue;
+		const uint8_t *glyph = CacheFontx(&fxs[i], sjis);
+		if(glyph == NULL) return false;
+		fxs->fonts = glyph;
+		if(pw) *pw = fxs[i].w;
+		if(ph) *ph = fxs[i].h;
+		return true;
+	}
+	return false;
+}
+
+// Get glyph pattern turned by a quarter turn
+// fxs->fonts points to the turned glyph until the next call. A glyph is
+// turned once and kept, later calls find it by code and turn.
+// code:ANK code, or SJIS code of a double byte font
+// turn:1 clockwise (DIRECTION90), 3 counterclockwise (DIRECTION270)
+// pw,ph:Size of the turned glyph, the font height by the font width
+// Returns false when the glyph or memory for the table is missing
+bool GetFontxTurned(FontxFile *fxs, uint16_t code, uint8_t turn, uint8_t *pw, uint8_t *ph)
+{
+	for(int i=0; i<2; i++){
+		FontxFile *fx = &fxs[i];
+		if(!OpenFontx(fx)) continue;
+		if(fx->is_ank != (code < 0x100)) continue;
+		uint16_t tsz = (fx->h + 7) / 8 * fx->w;
+		if(fx->turned == NULL){
+			fx->turned = (uint8_t*)malloc(FONTX_TURNED_GLYPHS * tsz);
+			if(fx->turned == NULL) return false;
+			memset(fx->turned_key, 0, sizeof(fx->turned_key));
+		}
+		uint32_t key = (uint32_t)code << 2 | turn;
+		uint16_t slot = (code << 1 | turn >> 1) & (FONTX_TURNED_GLYPHS - 1);
+		uint8_t *turned = &fx->turned[slot * tsz];
+		if(fx->turned_key[slot] != key){
+			if(FontxDebug)printf("[GetFontxTurned]code=0x%x turn=%d\n",code,turn);
+			const uint8_t *glyph = CacheFontx(fx, code);
+			if(glyph == NULL) return false;
+			TurnBitmap(glyph, fx->w, fx->h, turn, turned);
+			fx->turned_key[slot] = key;
+		}
+		fxs->fonts = turned;
+		if(pw) *pw = fx->h;
+		if(ph) *ph = fx->w;
+		return true;
+	}
+	return false;
+}
+
+// Transpose 8x8 bits, MSB first
+// Bit 7-c of row r becomes bit 7-r of row c.
+static void Transpose8(const uint8_t *in, uint8_t *out)
+{
+	uint32_t x = (uint32_t)in[0] << 24 | in[1] << 16 | in[2] << 8 | in[3];
+	uint32_t y = (uint32_t)in[4] << 24 | in[5] << 16 | in[6] << 8 | in[7];
+	uint32_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA; x = x ^ t ^ (t << 7);
+	t = (y ^ (y >> 7)) & 0x00AA00AA; y = y ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+	t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+	t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+	y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+	x = t;
+	for(int i=0;i<4;i++) {
+		out[i] = x >> (24 - 8 * i);
+		out[i + 4] = y >> (24 - 8 * i);
+	}
+}
+
+// Turn glyph pattern by a quarter turn, 8x8 bits at a time
+// The turned glyph is h bits wide and w rows high, rows start at a byte.
+// Padding bits of the result are clear.
+// turn:1 clockwise, 3 counterclockwise
+void TurnBitmap(const uint8_t *fonts, uint8_t w, uint8_t h, uint8_t turn, uint8_t *turned)
+{
+	uint16_t bpr = (w + 7) / 8;
+	uint16_t tbpr = (h + 7) / 8;
+	uint8_t in[8], out[8];
+	for(int kb=0; kb<tbpr; kb++){
+		for(int jb=0; jb<bpr; jb++){
+			// Clockwise, the left column of the turned glyph is the bottom row
+			for(int r=0; r<8; r++){
+				int row = (turn == 1) ? h - 1 - (kb * 8 + r) : kb * 8 + r;
+				in[r] = (row >= 0 && row < h) ? fonts[row * bpr + jb] : 0;
+			}
+			Transpose8(in, out);
+			for(int c=0; c<8 && jb * 8 + c < w; c++){
+				int j = (turn == 1) ? jb * 8 + c : w - 1 - (jb * 8 + c);
+				turned[j * tbpr + kb] = out[c];
+			}
+		}
+	}
+}
+
 
 /*
  Convert font pattern to bitmap image
@@ -515,104 +967,83 @@ uint8_t RotateByte(uint8_t ch1) {
 }
 
 
-#if 0
-// UTF code(3Byte) を SJIS Code(2 Byte) に変換
-// https://www.mgo-tec.com/blog-entry-utf8sjis01.html
-uint16_t UTF2SJIS(spiffs_file fd, uint8_t *utf8) {
-
-  uint32_t offset = 0;
-  uint32_t ret;
-  uint32_t UTF8uint = utf8[0]*256*256 + utf8[1]*256 + utf8[2];
-   
-  if(utf8[0]>=0xC2 && utf8[0]<=0xD1){ //0xB0からS_JISコード実データ。0x00-0xAFまではライセンス文ヘッダなのでそれをカット。
-	offset = ((utf8[0]*256 + utf8[1])-0xC2A2)*2 + 0xB0; //文字"￠" UTF8コード C2A2～、S_jisコード8191
-  }else if(utf8[0]==0xE2 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE28090)*2 + 0x1EEC; //文字"‐" UTF8コード E28090～、S_jisコード815D
-  }else if(utf8[0]==0xE3 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE38080)*2 + 0x9DCC; //スペース UTF8コード E38080～、S_jisコード8140
-  }else if(utf8[0]==0xE4 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE4B880)*2 + 0x11CCC; //文字"一" UTF8コード E4B880～、S_jisコード88EA
-  }else if(utf8[0]==0xE5 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE58085)*2 + 0x12BCC; //文字"倅" UTF8コード E58085～、S_jisコード98E4
-  }else if(utf8[0]==0xE6 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE6808E)*2 + 0x1AAC2; //文字"怎" UTF8コード E6808E～、S_jisコード9C83
-  }else if(utf8[0]==0xE7 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE78081)*2 + 0x229A6; //文字"瀁" UTF8コード E78081～、S_jisコードE066
-  }else if(utf8[0]==0xE8 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE88080)*2 + 0x2A8A4; //文字"耀" UTF8コード E88080～、S_jisコード9773
-  }else if(utf8[0]==0xE9 && utf8[1]>=0x80){
-	offset = (UTF8uint-0xE98080)*2 + 0x327A4; //文字"退" UTF8コード E98080～、S_jisコード91DE
-  }else if(utf8[0]>=0xEF && utf8[1]>=0xBC){
-	offset = (UTF8uint-0xEFBC81)*2 + 0x3A6A4; //文字"！" UTF8コード EFBC81～、S_jisコード8149
-	if(utf8[0]==0xEF && utf8[1]==0xBD && utf8[2]==0x9E){
-	  offset = 0x3A8DE; // "～" UTF8コード EFBD9E、S_jisコード8160
-	}
-  }
-
-if(FontxDebug)printf("[UTF2SJIS] offset=%d\n",offset);
-  char buf[2];
-  ret = SPIFFS_lseek(&fs, fd, offset, SPIFFS_SEEK_SET);
-if(FontxDebug)printf("[UTF2SJIS] lseek ret=%d\n",ret);
-  if (ret != offset) {
-	printf("UTF2SJIS:seek(%u) failed.\n",offset);
-	return 0;
-  }
-  if (SPIFFS_read(&fs, fd, buf, sizeof(buf)) != sizeof(buf)) {
-	printf("UTF2SJIS:read failed.\n");
-	return 0;
-  }
-if(FontxDebug)printf("[UTF2SJIS] sjis=0x%x%x\n",buf[0],buf[1]);
-  return buf[0]*256+buf[1];
-}
-
-
-// UTFを含む文字列をSJISに変換
-int String2SJIS(spiffs_file fd, unsigned char *str_in, size_t stlen,
-		uint16_t *sjis, size_t ssize) {
-  int i;
-  uint8_t sp;
-  uint8_t c1 = 0;
-  uint8_t c2 = 0;
-  uint8_t utf8[3];
-  uint16_t sjis2;
-  int spos = 0;
-
-  for(i=0;i<stlen;i++) {
-	sp = str_in[i];
-if(FontxDebug)printf("[String2SJIS]sp[%d]=%x\n",i,sp);
-	if ((sp & 0xf0) == 0xe0) { // 上位4ビットが1110なら、3バイト文字の1バイト目
-	  c1 = sp;
-	} else if ((sp & 0xc0) == 0x80) { // 上位2ビットが10なら、他バイト文字の2バイト目以降
-	  if (c2 == 0) {
-		c2 = sp;
-	  } else {
-		if (c1 == 0xef && c2 == 0xbd) {
-if(FontxDebug)printf("[String2SJIS]hankaku kana %x-%x-%x\n",c1,c2,sp);
-		  sjis2 = sp;
-if(FontxDebug)printf("[String2SJIS]sjis2=%x\n",sjis2);
-		  if (spos < ssize) sjis[spos++] = sjis2;
-		} else if (c1 == 0xef && c2 == 0xbe) {
-if(FontxDebug)printf("[String2SJIS]hankaku kana %x-%x-%x\n",c1,c2,sp);
-		  sjis2 = 0xc0 + (sp - 0x80);
-if(FontxDebug)printf("[String2SJIS]sjis2=%x\n",sjis2);
-		  if (spos < ssize) sjis[spos++] = sjis2;
+
+// UTF8 to SJIS table, generated by tools/utf8sjis.py
+// Code points are grouped by their high byte. Group h holds entries
+// utf8sjis_page[h]..utf8sjis_page[h+1]-1, sorted by low byte.
+extern const uint16_t utf8sjis_page[257];
+extern const uint8_t utf8sjis_low[];
+extern const uint16_t utf8sjis_sjis[];
+
+// Decode one UTF8 character
+// length:Bytes used, at least 1
+// Returns the code point, or 0xFFFD for a bad sequence
+uint32_t DecodeUTF8(const uint8_t *utf8, uint8_t *length)
+{
+	uint8_t c = utf8[0];
+	uint8_t n;
+	uint32_t code;
+	*length = 1;
+	if (c < 0x80) return c;
+	if ((c & 0xE0) == 0xC0) {
+		n = 2;
+		code = c & 0x1F;
+	} else if ((c & 0xF0) == 0xE0) {
+		n = 3;
+		code = c & 0x0F;
+	} else if ((c & 0xF8) == 0xF0) {
+		n = 4;
+		code = c & 0x07;
+	} else {
+		return 0xFFFD;
+	}
+	for(int i=1;i<n;i++) {
+		if ((utf8[i] & 0xC0) != 0x80) {
+			*length = i;
+			return 0xFFFD;
+		}
+		code = (code << 6) | (utf8[i] & 0x3F);
+	}
+	*length = n;
+	return code;
+}
+
+// Convert code point to SJIS code
+// Returns 0 when SJIS has no such character
+uint16_t UTF2SJIS(uint32_t unicode)
+{
+	if (unicode < 0x80) return unicode;
+	if (unicode > 0xFFFF) return 0;
+	uint8_t low = unicode & 0xFF;
+	int lo = utf8sjis_page[unicode >> 8];
+	int hi = utf8sjis_page[(unicode >> 8) + 1];
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (utf8sjis_low[mid] < low) {
+			lo = mid + 1;
 		} else {
-if(FontxDebug)printf("[String2SJIS]UTF8 %x-%x-%x\n",c1,c2,sp);
-		  utf8[0] = c1;
-		  utf8[1] = c2;
-		  utf8[2] = sp;
-		  sjis2 = UTF2SJIS(fd, utf8);
-if(FontxDebug)printf("[String2SJIS]sjis2=%x\n",sjis2);
-		  if (spos < ssize) sjis[spos++] = sjis2;
+			hi = mid;
 		}
-		c1 = c2 = 0;
-	  }
-	} else if ((sp & 0x80) == 0) { // 1バイト文字の場合
-if(FontxDebug)printf("[String2SJIS]ANK %x\n",sp);
-		if (spos < ssize) sjis[spos++] = sp;
 	}
-  }
-  return spos;
+	if (lo < utf8sjis_page[(unicode >> 8) + 1] && utf8sjis_low[lo] == low) return utf8sjis_sjis[lo];
+	return 0;
 }
-#endif
 
+// Convert UTF8 string to SJIS codes
+// Characters SJIS does not have are left out.
+// ssize:Size of sjis
+// Returns the number of codes
+int String2SJIS(const unsigned char *str_in, size_t stlen, uint16_t *sjis, size_t ssize)
+{
+	size_t spos = 0;
+	size_t i = 0;
+	while (i < stlen && spos < ssize) {
+		uint8_t length;
+		uint32_t code = DecodeUTF8(&str_in[i], &length);
+		i += length;
+		uint16_t sjis2 = UTF2SJIS(code);
+		if(FontxDebug)printf("[String2SJIS]U+%04"PRIx32" sjis=%x\n",code,sjis2);
+		if (sjis2) sjis[spos++] = sjis2;
+	}
+	return (int)spos;
+}
@@ -1,6 +1,40 @@
 #ifndef MAIN_FONTX_H_
 #define MAIN_FONTX_H_
 
+// Glyph cache.
+// ANK tables are read whole when the font is opened and the file is
+// closed, as long as FONTX_PRELOAD_RESERVE bytes of heap stay free after
+// them. Otherwise the font keeps the last FONTX_CACHE_GLYPHS glyphs read,
+// replacing the least recently used one. Double byte fonts always use the
+// LRU.
+// Glyphs turned for vertical text are kept apart, FONTX_TURNED_GLYPHS
+// of them indexed by code and turn. The table is allocated on first use.
+#define FONTX_PRELOAD_RESERVE 16384
+#define FONTX_CACHE_GLYPHS 32
+#define FONTX_TURNED_GLYPHS 64
+
+// Code block of a double byte (Kanji) font.
+// Codes start..end have glyphs first.. in the file. The block table is
+// read once when the font is opened and searched by code.
+typedef struct {
+	uint16_t start;
+	uint16_t end;
+	uint16_t first;
+} FONTX_BLOCK_t;
+
+// Font compiled into the application by tools/fontx2c.py.
+// Codes first..first+count-1 have a glyph. Identical glyphs share bitmaps.
+typedef struct {
+	const char *name;
+	uint8_t w;
+	uint8_t h;
+	uint16_t fsz;
+	uint16_t first;
+	uint16_t count;
+	const uint16_t *index;		// Glyph number per code
+	const uint8_t *bitmaps;		// fsz bytes per glyph
+} FONTX_FONT_t;
+
 typedef struct {
 	const char *path;
 	char  fxname[10];
@@ -11,18 +45,59 @@ typedef struct {
 	uint8_t h;
 	uint16_t fsz;
 	uint8_t bc;
+	FONTX_BLOCK_t *blocks;	// Code blocks of a double byte font
+	uint32_t base;		// Offset of the first glyph
 	FILE *file;
-	unsigned char *fonts;
+	const unsigned char *fonts;	// Last glyph of GetFontx
+	unsigned char *glyph;	// Glyph read from the file
+	const uint8_t *map;	// Font image read in place
+	size_t map_size;	// Bytes mapped by OpenFontxPartition
+	uint32_t map_handle;
+	const FONTX_FONT_t *font;	// Compiled font
+	uint8_t *cache;		// Preloaded table or LRU glyphs
+	uint16_t cached;	// Glyphs in the preloaded table or image, 0 for LRU
+	int32_t lru_code[FONTX_CACHE_GLYPHS];
+	uint32_t lru_used[FONTX_CACHE_GLYPHS];
+	uint32_t lru_clock;
+	uint8_t *turned;	// Turned glyphs, h bits wide and w rows high
+	uint32_t turned_key[FONTX_TURNED_GLYPHS];	// code << 2 | turn, 0 when empty
+	uint32_t hits;		// Glyphs found in the cache
+	uint32_t misses;	// Glyphs read from the file
 } FontxFile;
 
+// Initializer of a FontxFile that draws a compiled font without opening it
+#define FONTX_FONT_FILE(f, width, height) { \
+	.path = "", \
+	.opened = true, \
+	.valid = true, \
+	.is_ank = true, \
+	.w = (width), \
+	.h = (height), \
+	.fsz = ((width) + 7) / 8 * (height), \
+	.font = &(f), \
+}
+
+// Initializer of an unused FontxFile, GetFontx skips it
+#define FONTX_NO_FILE { \
+	.path = "", \
+	.opened = true, \
+	.valid = false, \
+}
+
 void AaddFontx(FontxFile *fx, const char *path);
 void InitFontx(FontxFile *fxs, const char *f0, const char *f1);
 bool OpenFontx(FontxFile *fx);
+bool OpenFontxMemory(FontxFile *fx, const uint8_t *data, size_t size);
+bool OpenFontxPartition(FontxFile *fx, const char *label);
+bool OpenFontxFont(FontxFile *fx, const FONTX_FONT_t *font);
 void CloseFontx(FontxFile *fx);
 void DumpFontx(FontxFile *fxs);
 uint8_t getFortWidth(FontxFile *fx);
 uint8_t getFortHeight(FontxFile *fx);
 bool GetFontx(FontxFile *fxs, uint8_t ascii , uint8_t *pw, uint8_t *ph);
+bool GetFontxCode(FontxFile *fxs, uint16_t sjis, uint8_t *pw, uint8_t *ph);
+bool GetFontxTurned(FontxFile *fxs, uint16_t code, uint8_t turn, uint8_t *pw, uint8_t *ph);
+void TurnBitmap(const uint8_t *fonts, uint8_t w, uint8_t h, uint8_t turn, uint8_t *turned);
 void Font2Bitmap(uint8_t *fonts, uint8_t *line, uint8_t w, uint8_t h, uint8_t inverse);
 void UnderlineBitmap(uint8_t *line, uint8_t w, uint8_t h);
 void ReversBitmap(uint8_t *line, uint8_t w, uint8_t h);
@@ -31,9 +106,9 @@ void ShowBitmap(uint8_t *bitmap, uint8_t pw, uint8_t ph);
 uint8_t RotateByte(uint8_t ch);
 
 // UTF8 to SJIS table
-// https://www.mgo-tec.com/blog-entry-utf8sjis01.html
-//#define Utf8Sjis "Utf8Sjis.tbl"
-//uint16_t UTF2SJIS(spiffs_file fd, uint8_t *utf8);
-//int String2SJIS(spiffs_file fd, unsigned char *str_in, size_t stlen, uint16_t *sjis, size_t ssize);
+// The table is compiled into the application, see tools/utf8sjis.py.
+uint32_t DecodeUTF8(const uint8_t *utf8, uint8_t *length);
+uint16_t UTF2SJIS(uint32_t unicode);
+int String2SJIS(const unsigned char *str_in, size_t stlen, uint16_t *sjis, size_t ssize);
 #endif /* MAIN_FONTX_H_ */
 
@@ -0,0 +1,111 @@
+// Host test of the RGB565 blend kernels of blend.c.
+// Every kernel is checked bit for bit against a per-channel version, then
+// both are timed on 240 pixel rows.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "blend.h"
+
+#define ROW 240
+#define ROUNDS 20000
+
+// Per-channel blend with the same 0-32 alpha as the kernels
+static inline uint16_t naiveBlend(uint16_t fg, uint16_t bg, uint8_t alpha) {
+	int a = (alpha + 4) >> 3;
+	int r = (((fg >> 11) & 31) * a + ((bg >> 11) & 31) * (32 - a)) >> 5;
+	int g = (((fg >> 5) & 63) * a + ((bg >> 5) & 63) * (32 - a)) >> 5;
+	int b = ((fg & 31) * a + (bg & 31) * (32 - a)) >> 5;
+	return (r << 11) | (g << 5) | b;
+}
+
+static __attribute__((noinline)) void naiveBlendFill(uint16_t *dst, uint16_t color, uint16_t size, uint8_t alpha) {
+	for (uint16_t i = 0; i < size; i++) dst[i] = naiveBlend(color, dst[i], alpha);
+}
+
+static __attribute__((noinline)) void naiveBlendRow(uint16_t *dst, const uint16_t *src, uint16_t size, uint8_t alpha) {
+	for (uint16_t i = 0; i < size; i++) dst[i] = naiveBlend(src[i], dst[i], alpha);
+}
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void fillRandom(uint16_t *p, int n) {
+	for (int i = 0; i < n; i++) p[i] = rand();
+}
+
+static int check(void) {
+	int bad = 0;
+	for (int t = 0; t < 65536; t++) {
+		uint16_t fg = rand(), bg = rand();
+		for (int a = 0; a < 256; a += 1 + (t & 7)) {
+			if (rgb565Blend(fg, bg, a) != naiveBlend(fg, bg, a)) bad++;
+		}
+	}
+
+	// Offsets 0/1 cover both alignments of the word loops
+	static uint16_t dst[ROW + 2], ref[ROW + 2], src[ROW + 2];
+	static uint8_t mask[ROW];
+	for (int t = 0; t < 20000; t++) {
+		int off = rand() & 1, soff = rand() & 1, n = rand() % ROW, a = rand() & 255;
+		uint16_t color = rand();
+		fillRandom(dst, ROW + 2);
+		fillRandom(src, ROW + 2);
+		for (int i = 0; i < ROW + 2; i++) ref[i] = dst[i];
+		rgb565BlendFill(dst + off, color, n, a);
+		naiveBlendFill(ref + off, color, n, a);
+		for (int i = 0; i < ROW + 2; i++) bad += dst[i] != ref[i];
+
+		for (int i = 0; i < ROW + 2; i++) ref[i] = dst[i];
+		rgb565BlendRow(dst + off, src + soff, n, a);
+		naiveBlendRow(ref + off, src + soff, n, a);
+		for (int i = 0; i < ROW + 2; i++) bad += dst[i] != ref[i];
+
+		int bpp = 1 << (rand() & 3);
+		int start = rand() & 7;
+		for (int i = 0; i < ROW; i++) mask[i] = rand();
+		for (int i = 0; i < ROW + 2; i++) ref[i] = dst[i];
+		rgb565BlendMask(dst + off, color, mask, bpp, start, n);
+		for (int i = 0; i < n; i++) ref[off + i] = naiveBlend(color, ref[off + i], rgb565MaskAlpha(mask, bpp, start + i));
+		for (int i = 0; i < ROW + 2; i++) bad += dst[i] != ref[i];
+
+		for (int i = 0; i < ROW + 2; i++) ref[i] = dst[i];
+		rgb565BlendRowMask(dst + off, src + soff, mask, bpp, start, n);
+		for (int i = 0; i < n; i++) ref[off + i] = naiveBlend(src[soff + i], ref[off + i], rgb565MaskAlpha(mask, bpp, start + i));
+		for (int i = 0; i < ROW + 2; i++) bad += dst[i] != ref[i];
+	}
+	return bad;
+}
+
+static void bench(void) {
+	static uint16_t dst[ROW], src[ROW];
+	fillRandom(dst, ROW);
+	fillRandom(src, ROW);
+	double t0 = now_us();
+	for (int k = 0; k < ROUNDS; k++) naiveBlendFill(dst, k, ROW, 100);
+	double t1 = now_us();
+	for (int k = 0; k < ROUNDS; k++) rgb565BlendFill(dst, k, ROW, 100);
+	double t2 = now_us();
+	for (int k = 0; k < ROUNDS; k++) naiveBlendRow(dst, src, ROW, 100);
+	double t3 = now_us();
+	for (int k = 0; k < ROUNDS; k++) rgb565BlendRow(dst, src, ROW, 100);
+	double t4 = now_us();
+	double px = (double)ROUNDS * ROW / 1e3;
+	printf("fill: naive %.2f ns/pixel, kernel %.2f ns/pixel\n", (t1 - t0) / px, (t2 - t1) / px);
+	printf("row:  naive %.2f ns/pixel, kernel %.2f ns/pixel\n", (t3 - t2) / px, (t4 - t3) / px);
+	printf("checksum %04x\n", dst[ROW / 2]);
+}
+
+int main(void) {
+	srand(1);
+	int bad = check();
+	printf("blend: %d mismatches\n", bad);
+	if (bad) return 1;
+	bench();
+	return 0;
+}
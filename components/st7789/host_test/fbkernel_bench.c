@@ -0,0 +1,112 @@
+// Host benchmark of the frame buffer kernels of fbkernel.h.
+// The same kernels are called the way lcdDrawPixel and friends call them:
+// with a 240x240 geometry as constants, and with the geometry loaded from
+// the device. Both paths must leave the same frame buffer. The two time
+// within noise of each other, which is why there is no fixed geometry build.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "fbkernel.h"
+
+#define WIDTH 240
+#define HEIGHT 240
+
+typedef struct {
+	uint16_t *fb;
+	int stride;
+	int width;
+	int height;
+} GEOMETRY_t;
+
+static uint16_t fb_fixed[WIDTH * HEIGHT];
+static uint16_t fb_runtime[WIDTH * HEIGHT];
+
+static __attribute__((noinline)) void pixelFixed(GEOMETRY_t *g, uint16_t x, uint16_t y, uint16_t color) {
+	lcdFbPixel(g->fb, WIDTH, WIDTH, HEIGHT, x, y, color);
+}
+
+static __attribute__((noinline)) void pixelRuntime(GEOMETRY_t *g, uint16_t x, uint16_t y, uint16_t color) {
+	lcdFbPixel(g->fb, g->stride, g->width, g->height, x, y, color);
+}
+
+static __attribute__((noinline)) void rectFixed(GEOMETRY_t *g, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	lcdFbFillRect(g->fb, WIDTH, WIDTH, HEIGHT, x1, y1, x2, y2, color);
+}
+
+static __attribute__((noinline)) void rectRuntime(GEOMETRY_t *g, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	lcdFbFillRect(g->fb, g->stride, g->width, g->height, x1, y1, x2, y2, color);
+}
+
+static __attribute__((noinline)) void hlineFixed(GEOMETRY_t *g, int x1, int x2, int y, uint16_t color) {
+	lcdFbHLine(g->fb, WIDTH, WIDTH, HEIGHT, x1, x2, y, color);
+}
+
+static __attribute__((noinline)) void hlineRuntime(GEOMETRY_t *g, int x1, int x2, int y, uint16_t color) {
+	lcdFbHLine(g->fb, g->stride, g->width, g->height, x1, x2, y, color);
+}
+
+static __attribute__((noinline)) void vlineFixed(GEOMETRY_t *g, int x, int y1, int y2, uint16_t color) {
+	lcdFbVLine(g->fb, WIDTH, WIDTH, HEIGHT, x, y1, y2, color);
+}
+
+static __attribute__((noinline)) void vlineRuntime(GEOMETRY_t *g, int x, int y1, int y2, uint16_t color) {
+	lcdFbVLine(g->fb, g->stride, g->width, g->height, x, y1, y2, color);
+}
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Time each primitive of one path, in ns per call
+#define RUN(path, g, ns) do { \
+	double t0 = now_us(); \
+	for (int k = 0; k < 200; k++) { \
+		for (int y = 0; y < HEIGHT + 8; y++) { \
+			for (int x = 0; x < WIDTH + 8; x++) pixel##path(g, x, y, x ^ y ^ k); \
+		} \
+	} \
+	double t1 = now_us(); \
+	for (int k = 0; k < 20000; k++) { \
+		for (int i = 0; i < 24; i++) rect##path(g, i * 5, i * 3, i * 5 + 20, i * 3 + 10, k); \
+	} \
+	double t2 = now_us(); \
+	for (int k = 0; k < 2000; k++) { \
+		for (int i = -4; i < HEIGHT + 4; i++) hline##path(g, (k & 15) - 8, WIDTH - (i & 31), i, k); \
+	} \
+	double t3 = now_us(); \
+	for (int k = 0; k < 2000; k++) { \
+		for (int i = -4; i < WIDTH + 4; i++) vline##path(g, i, 3, 200 + (k & 63), k); \
+	} \
+	double t4 = now_us(); \
+	ns[0] = (t1 - t0) * 1e3 / (200.0 * (HEIGHT + 8) * (WIDTH + 8)); \
+	ns[1] = (t2 - t1) * 1e3 / (20000.0 * 24); \
+	ns[2] = (t3 - t2) * 1e3 / (2000.0 * (HEIGHT + 8)); \
+	ns[3] = (t4 - t3) * 1e3 / (2000.0 * (WIDTH + 8)); \
+} while (0)
+
+int main(void) {
+	static const char *names[4] = { "pixel", "fill rect", "hline", "vline" };
+	GEOMETRY_t gf = { fb_fixed, WIDTH, WIDTH, HEIGHT };
+	GEOMETRY_t gr = { fb_runtime, WIDTH, WIDTH, HEIGHT };
+	double nf[4], nr[4];
+
+	// Best of 5 alternating runs
+	for (int i = 0; i < 4; i++) nf[i] = nr[i] = 1e9;
+	for (int r = 0; r < 5; r++) {
+		double t[4];
+		RUN(Fixed, &gf, t);
+		for (int i = 0; i < 4; i++) if (t[i] < nf[i]) nf[i] = t[i];
+		RUN(Runtime, &gr, t);
+		for (int i = 0; i < 4; i++) if (t[i] < nr[i]) nr[i] = t[i];
+	}
+	int same = memcmp(fb_fixed, fb_runtime, sizeof(fb_fixed)) == 0;
+	printf("fbkernel: frame buffers %s\n", same ? "match" : "differ");
+	for (int i = 0; i < 4; i++) {
+		printf("%-9s fixed %6.2f ns, runtime %6.2f ns\n", names[i], nf[i], nr[i]);
+	}
+	return same ? 0 : 1;
+}
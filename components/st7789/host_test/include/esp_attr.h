@@ -0,0 +1,7 @@
+// Host stand-in for the ESP-IDF header
+#ifndef ESP_ATTR_H_
+#define ESP_ATTR_H_
+
+#define FORCE_INLINE_ATTR static inline __attribute__((always_inline))
+
+#endif /* ESP_ATTR_H_ */
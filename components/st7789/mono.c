@@ -0,0 +1,259 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "mono.h"
+
+#define TAG "MONO"
+
+static void monoBuildLut(TFT_t * dev) {
+	for (int b = 0; b < 256; b++) {
+		uint16_t *p = &dev->_mono_lut[b * 8];
+		for (int i = 0; i < 8; i++) {
+			p[i] = (b & (0x80 >> i)) ? dev->_mono_fg : dev->_mono_bg;
+		}
+	}
+}
+
+// Use 1-bpp frame buffer
+// The RGB565 frame buffer is released. The screen is cleared to bg.
+// fg:Foreground color
+// bg:Background color
+bool lcdInitMono(TFT_t * dev, uint16_t fg, uint16_t bg) {
+	if (dev->_target != NULL) {
+		ESP_LOGW(TAG, "Reset render target before changing frame buffer.");
+		return false;
+	}
+	uint16_t stride = (dev->_width + 7) / 8;
+	if (dev->_mono_buffer == NULL) {
+		dev->_mono_buffer = heap_caps_malloc(stride * dev->_height, MALLOC_CAP_DEFAULT);
+		dev->_mono_lut = heap_caps_malloc(256 * 8 * sizeof(uint16_t), MALLOC_CAP_DEFAULT);
+		if (dev->_mono_buffer == NULL || dev->_mono_lut == NULL) {
+			ESP_LOGE(TAG, "heap_caps_malloc fail. Mono frame buffer is not available.");
+			heap_caps_free(dev->_mono_buffer);
+			heap_caps_free(dev->_mono_lut);
+			dev->_mono_buffer = NULL;
+			dev->_mono_lut = NULL;
+			return false;
+		}
+	}
+	if (dev->_frame_buffer != NULL) {
+		heap_caps_free(dev->_frame_buffer);
+		dev->_frame_buffer = NULL;
+	}
+	dev->_mono_stride = stride;
+	dev->_mono = true;
+	dev->_use_frame_buffer = true;
+	memset(dev->_mono_buffer, 0, stride * dev->_height);
+	lcdSetMonoColor(dev, fg, bg);
+	ESP_LOGI(TAG, "Mono frame buffer %d bytes", stride * dev->_height);
+	return true;
+}
+
+// Set colors of 1-bpp frame buffer
+// fg:Foreground color
+// bg:Background color
+void lcdSetMonoColor(TFT_t * dev, uint16_t fg, uint16_t bg) {
+	if (dev->_mono_buffer == NULL) return;
+	dev->_mono_fg = fg;
+	dev->_mono_bg = bg;
+	monoBuildLut(dev);
+}
+
+void monoSetPixel(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color) {
+	uint8_t *p = &dev->_mono_buffer[y * dev->_mono_stride + (x >> 3)];
+	uint8_t bit = 0x80 >> (x & 7);
+	if (color != dev->_mono_bg) {
+		*p |= bit;
+	} else {
+		*p &= ~bit;
+	}
+}
+
+uint16_t monoGetPixel(TFT_t * dev, uint16_t x, uint16_t y) {
+	uint8_t b = dev->_mono_buffer[y * dev->_mono_stride + (x >> 3)];
+	return (b & (0x80 >> (x & 7))) ? dev->_mono_fg : dev->_mono_bg;
+}
+
+// Fill bits x1..x2 of a row
+static void monoFillRow(uint8_t *row, uint16_t x1, uint16_t x2, bool on) {
+	uint16_t i1 = x1 >> 3;
+	uint16_t i2 = x2 >> 3;
+	uint8_t m1 = 0xFF >> (x1 & 7);
+	uint8_t m2 = 0xFF << (7 - (x2 & 7));
+	if (i1 == i2) {
+		m1 &= m2;
+		row[i1] = on ? row[i1] | m1 : row[i1] & ~m1;
+		return;
+	}
+	row[i1] = on ? row[i1] | m1 : row[i1] & ~m1;
+	memset(&row[i1 + 1], on ? 0xFF : 0x00, i2 - i1 - 1);
+	row[i2] = on ? row[i2] | m2 : row[i2] & ~m2;
+}
+
+// Fill rectangle, already clipped
+void monoFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	bool on = (color != dev->_mono_bg);
+	for (uint16_t y = y1; y <= y2; y++) {
+		monoFillRow(&dev->_mono_buffer[y * dev->_mono_stride], x1, x2, on);
+	}
+}
+
+// Invert rectangle, already clipped
+void monoInvertRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+	uint16_t i1 = x1 >> 3;
+	uint16_t i2 = x2 >> 3;
+	for (uint16_t y = y1; y <= y2; y++) {
+		uint8_t *row = &dev->_mono_buffer[y * dev->_mono_stride];
+		for (uint16_t i = i1; i <= i2; i++) {
+			uint8_t m = 0xFF;
+			if (i == i1) m &= 0xFF >> (x1 & 7);
+			if (i == i2) m &= 0xFF << (7 - (x2 & 7));
+			row[i] ^= m;
+		}
+	}
+}
+
+// OR glyph rows into the buffer, or clear them for the background color
+// Only glyphs fully inside the screen width are handled.
+// y:Top row of the glyph
+// Return false when the caller has to draw pixel by pixel
+bool monoDrawGlyph(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, int16_t y, uint16_t color) {
+	if ((pw + 4) / 8 != (pw + 7) / 8) return false;
+	if (x + pw > dev->_width) return false;
+	uint16_t bpr = (pw + 7) / 8;
+	bool on = (color != dev->_mono_bg);
+	uint8_t sh = x & 7;
+	uint16_t stride = dev->_mono_stride;
+	for (int h = 0; h < ph; h++) {
+		int yy = y + h;
+		if (yy < 0 || yy >= dev->_height) continue;
+		uint8_t *row = &dev->_mono_buffer[yy * stride];
+		uint16_t i = x >> 3;
+		for (uint16_t k = 0; k < bpr; k++, i++) {
+			uint8_t g = fonts[h * bpr + k];
+			int valid = pw - k * 8;
+			if (valid < 8) g &= 0xFF << (8 - valid);
+			if (g == 0) continue;
+			uint8_t g1 = g >> sh;
+			uint8_t g2 = sh ? (uint8_t)(g << (8 - sh)) : 0;
+			if (on) {
+				row[i] |= g1;
+				if (g2) row[i + 1] |= g2;
+			} else {
+				row[i] &= ~g1;
+				if (g2) row[i + 1] &= ~g2;
+			}
+		}
+	}
+	return true;
+}
+
+// Read pixels of a row, one byte per pixel
+static void monoGetBits(const uint8_t *row, int x, int n, uint8_t *bits) {
+	for (int i = 0; i < n; i++, x++) bits[i] = (row[x >> 3] >> (7 - (x & 7))) & 1;
+}
+
+// Write pixels of a row, one byte per pixel
+static void monoPutBits(uint8_t *row, int x, int n, const uint8_t *bits) {
+	for (int i = 0; i < n; i++, x++) {
+		uint8_t bit = 0x80 >> (x & 7);
+		if (bits[i]) {
+			row[x >> 3] |= bit;
+		} else {
+			row[x >> 3] &= ~bit;
+		}
+	}
+}
+
+// Copy w pixels between rows
+// Byte aligned spans are copied with memmove.
+static void monoCopyRow(uint8_t *dst, int dx, const uint8_t *src, int sx, int w, uint8_t *tmp) {
+	if ((dx & 7) == 0 && (sx & 7) == 0) {
+		int bytes = w >> 3;
+		memmove(&dst[dx >> 3], &src[sx >> 3], bytes);
+		dx += bytes * 8;
+		sx += bytes * 8;
+		w -= bytes * 8;
+		if (w == 0) return;
+	}
+	monoGetBits(src, sx, w, tmp);
+	monoPutBits(dst, dx, w, tmp);
+}
+
+// Move w*h pixels, already clipped
+void monoMoveRect(TFT_t * dev, int sx, int sy, int dx, int dy, int w, int h) {
+	int stride = dev->_mono_stride;
+	uint8_t tmp[w];
+	int j0 = 0, j1 = h, step = 1;
+	if (dy > sy) {
+		// Moving down, copy from the bottom row
+		j0 = h - 1;
+		j1 = -1;
+		step = -1;
+	}
+	for (int j = j0; j != j1; j += step) {
+		monoCopyRow(&dev->_mono_buffer[(dy + j) * stride], dx, &dev->_mono_buffer[(sy + j) * stride], sx, w, tmp);
+	}
+}
+
+// Scroll w*h pixels with wrap around, already clipped
+void monoScrollRect(TFT_t * dev, int x, int y, int w, int h, SCROLL_TYPE_t scroll, uint16_t n) {
+	int stride = dev->_mono_stride;
+	uint8_t *base = &dev->_mono_buffer[y * stride];
+	if (scroll == SCROLL_RIGHT || scroll == SCROLL_LEFT) {
+		n %= w;
+		if (n == 0) return;
+		int k = (scroll == SCROLL_RIGHT) ? w - n : n;
+		uint8_t bits[w];
+		for (int j = 0; j < h; j++) {
+			uint8_t *row = base + j * stride;
+			monoGetBits(row, x + k, w - k, bits);
+			monoGetBits(row, x, k, &bits[w - k]);
+			monoPutBits(row, x, w, bits);
+		}
+	} else if (scroll == SCROLL_UP || scroll == SCROLL_DOWN) {
+		n %= h;
+		if (n == 0) return;
+		int k = (scroll == SCROLL_UP) ? n : h - n;
+		int a = h, b = k;
+		while (b) {
+			int t = a % b; a = b; b = t;
+		}
+		uint8_t wk[w];
+		uint8_t tmp[w];
+		for (int start = 0; start < a; start++) {
+			monoGetBits(base + start * stride, x, w, wk);
+			int j = start;
+			while (1) {
+				int next = j + k;
+				if (next >= h) next -= h;
+				if (next == start) break;
+				monoCopyRow(base + j * stride, x, base + next * stride, x, w, tmp);
+				j = next;
+			}
+			monoPutBits(base + j * stride, x, w, wk);
+		}
+	}
+}
+
+// Expand n pixels of a row to RGB565, 8 pixels per table lookup
+void monoExpandRow(TFT_t * dev, uint16_t *line, uint16_t x, uint16_t y, uint16_t n) {
+	const uint8_t *row = &dev->_mono_buffer[y * dev->_mono_stride];
+	while (n && (x & 7)) {
+		*line++ = (row[x >> 3] & (0x80 >> (x & 7))) ? dev->_mono_fg : dev->_mono_bg;
+		x++;
+		n--;
+	}
+	const uint8_t *p = &row[x >> 3];
+	for (; n >= 8; n -= 8, x += 8) {
+		memcpy(line, &dev->_mono_lut[*p++ * 8], 8 * sizeof(uint16_t));
+		line += 8;
+	}
+	for (uint16_t i = 0; i < n; i++) {
+		line[i] = (*p & (0x80 >> i)) ? dev->_mono_fg : dev->_mono_bg;
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef MAIN_MONO_H_
+#define MAIN_MONO_H_
+
+#include "st7789.h"
+
+// 1-bpp frame buffer.
+// One bit per pixel, MSB first, each row starts at a byte boundary. A set
+// bit shows the foreground color. Drawing with the background color clears
+// bits, any other color sets them. The buffer is expanded to RGB565 when it
+// is sent to the panel.
+
+// Blended pixels are drawn when they are at least half opaque
+#define MONO_ALPHA_THRESHOLD 128
+
+void monoSetPixel(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color);
+uint16_t monoGetPixel(TFT_t * dev, uint16_t x, uint16_t y);
+void monoFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+void monoInvertRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+bool monoDrawGlyph(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, int16_t y, uint16_t color);
+void monoMoveRect(TFT_t * dev, int sx, int sy, int dx, int dy, int w, int h);
+void monoScrollRect(TFT_t * dev, int x, int y, int w, int h, SCROLL_TYPE_t scroll, uint16_t n);
+void monoExpandRow(TFT_t * dev, uint16_t *line, uint16_t x, uint16_t y, uint16_t n);
+
+#endif /* MAIN_MONO_H_ */
@@ -0,0 +1,464 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "raster.h"
+#include "mono.h"
+#include "paint.h"
+
+#define TAG "PAINT"
+
+// Gradient position of the end color, 16.16
+#define PAINT_ONE 0x10000
+
+// Pixels generated per spi_master_write_colors
+#define PAINT_CHUNK 512
+
+// sqrt(0..1) in 256 steps, 0.16
+static const uint16_t sqrt_table[257] = {
+	0, 4096, 5793, 7094, 8192, 9159, 10033, 10837,
+	11585, 12288, 12953, 13585, 14189, 14768, 15326, 15864,
+	16384, 16888, 17378, 17854, 18318, 18770, 19212, 19644,
+	20066, 20480, 20886, 21283, 21674, 22058, 22435, 22806,
+	23170, 23530, 23884, 24232, 24576, 24915, 25249, 25580,
+	25905, 26227, 26545, 26859, 27170, 27477, 27780, 28081,
+	28378, 28672, 28963, 29251, 29537, 29819, 30099, 30377,
+	30652, 30924, 31194, 31462, 31727, 31991, 32252, 32511,
+	32768, 33023, 33276, 33527, 33776, 34024, 34270, 34514,
+	34756, 34996, 35235, 35472, 35708, 35942, 36175, 36406,
+	36636, 36864, 37091, 37316, 37540, 37763, 37985, 38205,
+	38424, 38642, 38858, 39073, 39287, 39500, 39712, 39923,
+	40132, 40341, 40548, 40755, 40960, 41164, 41368, 41570,
+	41771, 41972, 42171, 42369, 42567, 42763, 42959, 43154,
+	43348, 43541, 43733, 43925, 44115, 44305, 44494, 44682,
+	44869, 45056, 45242, 45427, 45611, 45795, 45977, 46160,
+	46341, 46522, 46702, 46881, 47059, 47237, 47415, 47591,
+	47767, 47942, 48117, 48291, 48465, 48637, 48809, 48981,
+	49152, 49322, 49492, 49661, 49830, 49998, 50166, 50332,
+	50499, 50665, 50830, 50995, 51159, 51323, 51486, 51649,
+	51811, 51972, 52134, 52294, 52454, 52614, 52773, 52932,
+	53090, 53248, 53405, 53562, 53719, 53874, 54030, 54185,
+	54340, 54494, 54647, 54801, 54954, 55106, 55258, 55410,
+	55561, 55712, 55862, 56012, 56162, 56311, 56459, 56608,
+	56756, 56903, 57051, 57198, 57344, 57490, 57636, 57781,
+	57926, 58071, 58215, 58359, 58503, 58646, 58789, 58931,
+	59073, 59215, 59357, 59498, 59639, 59779, 59919, 60059,
+	60199, 60338, 60477, 60615, 60753, 60891, 61029, 61166,
+	61303, 61440, 61576, 61712, 61848, 61984, 62119, 62254,
+	62388, 62523, 62657, 62790, 62924, 63057, 63190, 63323,
+	63455, 63587, 63719, 63850, 63982, 64113, 64243, 64374,
+	64504, 64634, 64763, 64893, 65022, 65151, 65279, 65408,
+	65535
+};
+
+// 4x4 Bayer matrix
+static const uint8_t bayer[4][4] = {
+	{ 0,  8,  2, 10},
+	{12,  4, 14,  6},
+	{ 3, 11,  1,  9},
+	{15,  7, 13,  5},
+};
+
+// Solid color
+void lcdPaintSolid(PAINT_t *paint, uint16_t color) {
+	memset(paint, 0, sizeof(PAINT_t));
+	paint->type = PAINT_SOLID;
+	paint->color = color;
+}
+
+// Linear gradient
+// Colors are constant beyond both end points.
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// color1:Start color
+// x2:End X coordinate
+// y2:End Y coordinate
+// color2:End color
+void lcdPaintLinear(PAINT_t *paint, int16_t x1, int16_t y1, uint16_t color1, int16_t x2, int16_t y2, uint16_t color2) {
+	int32_t dx = x2 - x1;
+	int32_t dy = y2 - y1;
+	int64_t len2 = (int64_t)dx * dx + (int64_t)dy * dy;
+	if (len2 == 0) {
+		lcdPaintSolid(paint, color2);
+		return;
+	}
+	memset(paint, 0, sizeof(PAINT_t));
+	paint->type = PAINT_LINEAR;
+	paint->color0 = color1;
+	paint->color1 = color2;
+	paint->x = x1;
+	paint->y = y1;
+	paint->dx = dx;
+	paint->dy = dy;
+	paint->tx = (int64_t)dx * PAINT_ONE / len2;
+	paint->ty = (int64_t)dy * PAINT_ONE / len2;
+}
+
+// Horizontal gradient
+// x1:Start X coordinate
+// color1:Start color
+// x2:End X coordinate
+// color2:End color
+void lcdPaintHorizontal(PAINT_t *paint, int16_t x1, uint16_t color1, int16_t x2, uint16_t color2) {
+	lcdPaintLinear(paint, x1, 0, color1, x2, 0, color2);
+}
+
+// Vertical gradient
+// Rows have one color, so undithered spans cost the same as solid ones.
+// y1:Start Y coordinate
+// color1:Start color
+// y2:End Y coordinate
+// color2:End color
+void lcdPaintVertical(PAINT_t *paint, int16_t y1, uint16_t color1, int16_t y2, uint16_t color2) {
+	lcdPaintLinear(paint, 0, y1, color1, 0, y2, color2);
+}
+
+// Radial gradient
+// xc:Center X coordinate
+// yc:Center Y coordinate
+// r:Radius, color2 is used outside of it
+// color1:Center color
+// color2:Edge color
+void lcdPaintRadial(PAINT_t *paint, int16_t xc, int16_t yc, uint16_t r, uint16_t color1, uint16_t color2) {
+	if (r == 0) {
+		lcdPaintSolid(paint, color2);
+		return;
+	}
+	if (r > 0x7FFF) r = 0x7FFF;
+	memset(paint, 0, sizeof(PAINT_t));
+	paint->type = PAINT_RADIAL;
+	paint->color0 = color1;
+	paint->color1 = color2;
+	paint->x = xc;
+	paint->y = yc;
+	paint->radius = r;
+	paint->inv = (1u << 30) / ((uint32_t)r * r);
+}
+
+// Tiled 8x8 pattern
+// pattern:8 bytes, one per row, MSB is the left pixel
+// x:X coordinate of the tile origin
+// y:Y coordinate of the tile origin
+// fg:Color of set bits
+// bg:Color of clear bits
+void lcdPaintPattern(PAINT_t *paint, const uint8_t *pattern, int16_t x, int16_t y, uint16_t fg, uint16_t bg) {
+	memset(paint, 0, sizeof(PAINT_t));
+	paint->type = PAINT_PATTERN;
+	paint->pattern = pattern;
+	paint->x = x;
+	paint->y = y;
+	paint->color = fg;
+	paint->color0 = bg;
+}
+
+// Tiled bitmap
+// bitmap:w*h RGB565 pixels
+// x:X coordinate of the tile origin
+// y:Y coordinate of the tile origin
+void lcdPaintBitmap(PAINT_t *paint, const uint16_t *bitmap, uint16_t w, uint16_t h, int16_t x, int16_t y) {
+	if (bitmap == NULL || w == 0 || h == 0) {
+		ESP_LOGW(TAG, "Empty bitmap.");
+		lcdPaintSolid(paint, BLACK);
+		return;
+	}
+	memset(paint, 0, sizeof(PAINT_t));
+	paint->type = PAINT_BITMAP;
+	paint->bitmap = bitmap;
+	paint->w = w;
+	paint->h = h;
+	paint->x = x;
+	paint->y = y;
+}
+
+// Enable ordered dithering of gradients
+void lcdPaintDither(PAINT_t *paint, bool dither) {
+	paint->dither = dither;
+}
+
+// Split RGB565 into channels
+static void paintChannels(uint16_t color, int32_t *c) {
+	c[0] = color >> 11;
+	c[1] = (color >> 5) & 0x3F;
+	c[2] = color & 0x1F;
+}
+
+// Dither thresholds of row y, 16-bit fractions
+static void paintThresholds(const PAINT_t *p, int16_t y, int32_t *d) {
+	for (int i = 0; i < 4; i++) {
+		d[i] = p->dither ? (bayer[y & 3][i] * 2 + 1) << 11 : 0x8000;
+	}
+}
+
+// Channels are 16.16 in RGB565 units
+static inline uint16_t paintPack(int32_t r, int32_t g, int32_t b, int32_t d) {
+	return ((r + d) >> 16) << 11 | ((g + d) >> 16) << 5 | ((b + d) >> 16);
+}
+
+// Colors of a linear gradient span
+// The span is split into the parts before, inside and after the ramp, so
+// the ramp is stepped without clamping.
+// t:Gradient position of the first pixel, 16.16
+// tx:Gradient position change per pixel
+static void paintLinearRow(const PAINT_t *p, uint16_t *line, int16_t x, int16_t y, uint16_t n, int64_t t, int32_t tx) {
+	int64_t i0, i1;
+	uint16_t before, after;
+	if (tx >= 0) {
+		before = p->color0;
+		after = p->color1;
+		if (tx == 0) {
+			i0 = 0;
+			i1 = (t >= 0 && t <= PAINT_ONE) ? n : 0;
+			if (t < 0) after = p->color0;
+		} else {
+			i0 = (t >= 0) ? 0 : (-t + tx - 1) / tx;
+			i1 = (t > PAINT_ONE) ? 0 : (PAINT_ONE - t) / tx + 1;
+		}
+	} else {
+		before = p->color1;
+		after = p->color0;
+		i0 = (t <= PAINT_ONE) ? 0 : (t - PAINT_ONE - tx - 1) / -tx;
+		i1 = (t < 0) ? 0 : t / -tx + 1;
+	}
+	if (i0 > n) i0 = n;
+	if (i1 > n) i1 = n;
+	if (i1 < i0) i1 = i0;
+
+	rgb565Fill(line, before, i0);
+	int32_t c0[3], c1[3];
+	paintChannels(p->color0, c0);
+	paintChannels(p->color1, c1);
+	// Only inside the ramp is the position in range
+	int32_t tr = (i0 < i1) ? t + i0 * tx : 0;
+	int32_t r = (c0[0] << 16) + (c1[0] - c0[0]) * tr;
+	int32_t g = (c0[1] << 16) + (c1[1] - c0[1]) * tr;
+	int32_t b = (c0[2] << 16) + (c1[2] - c0[2]) * tr;
+	int32_t dr = (c1[0] - c0[0]) * tx;
+	int32_t dg = (c1[1] - c0[1]) * tx;
+	int32_t db = (c1[2] - c0[2]) * tx;
+	int32_t d[4];
+	paintThresholds(p, y, d);
+	for (int32_t i = i0; i < i1; i++) {
+		line[i] = paintPack(r, g, b, d[(x + i) & 3]);
+		r += dr;
+		g += dg;
+		b += db;
+	}
+	rgb565Fill(&line[i1], after, n - i1);
+}
+
+// sqrt of s / 2^30, 0.16
+// s is scaled by a power of 4 into the upper half of the table first, where
+// the linear interpolation is accurate.
+static inline int32_t paintSqrt(uint32_t s) {
+	if (s == 0) return 0;
+	int sh = (__builtin_clz(s) - 2) >> 1;
+	s <<= 2 * sh;
+	uint32_t k = s >> 22;
+	uint32_t f = (s >> 14) & 0xFF;
+	return (sqrt_table[k] + (((sqrt_table[k+1] - sqrt_table[k]) * f) >> 8)) >> sh;
+}
+
+// Colors of a radial gradient span
+// The squared distance is stepped per pixel and mapped to the gradient
+// position through the square root table.
+static void paintRadialRow(const PAINT_t *p, uint16_t *line, int16_t x, int16_t y, uint16_t n) {
+	int32_t c0[3], c1[3];
+	paintChannels(p->color0, c0);
+	paintChannels(p->color1, c1);
+	int32_t d[4];
+	paintThresholds(p, y, d);
+	int32_t ex = x - p->x;
+	int32_t ey = y - p->y;
+	uint32_t r2 = (uint32_t)p->radius * p->radius;
+	int64_t d2 = (int64_t)ex * ex + (int64_t)ey * ey;
+	for (uint16_t i = 0; i < n; i++) {
+		if (d2 >= r2) {
+			line[i] = p->color1;
+		} else {
+			int32_t t = paintSqrt((uint32_t)d2 * p->inv);
+			line[i] = paintPack((c0[0] << 16) + (c1[0] - c0[0]) * t,
+				(c0[1] << 16) + (c1[1] - c0[1]) * t,
+				(c0[2] << 16) + (c1[2] - c0[2]) * t, d[(x + i) & 3]);
+		}
+		d2 += 2 * ex + 1;
+		ex++;
+	}
+}
+
+// Colors of a pattern span
+static void paintPatternRow(const PAINT_t *p, uint16_t *line, int16_t x, int16_t y, uint16_t n) {
+	uint8_t bits = p->pattern[(y - p->y) & 7];
+	uint8_t k = (x - p->x) & 7;
+	for (uint16_t i = 0; i < n; i++) {
+		line[i] = (bits & (0x80 >> k)) ? p->color : p->color0;
+		k = (k + 1) & 7;
+	}
+}
+
+// Colors of a bitmap span, copied in runs up to the tile edge
+static void paintBitmapRow(const PAINT_t *p, uint16_t *line, int16_t x, int16_t y, uint16_t n) {
+	int32_t row = (y - p->y) % p->h;
+	if (row < 0) row += p->h;
+	int32_t col = (x - p->x) % p->w;
+	if (col < 0) col += p->w;
+	const uint16_t *src = &p->bitmap[row * p->w];
+	while (n) {
+		uint16_t run = p->w - col;
+		if (run > n) run = n;
+		memcpy(line, &src[col], run * sizeof(uint16_t));
+		line += run;
+		n -= run;
+		col = 0;
+	}
+}
+
+// Colors of n pixels from x on row y
+static void paintRow(const PAINT_t *p, uint16_t *line, int16_t x, int16_t y, uint16_t n) {
+	switch (p->type) {
+	case PAINT_LINEAR: {
+		int64_t t = ((int64_t)(x - p->x) * p->dx + (int64_t)(y - p->y) * p->dy) * PAINT_ONE
+			/ ((int64_t)p->dx * p->dx + (int64_t)p->dy * p->dy);
+		paintLinearRow(p, line, x, y, n, t, p->tx);
+		break;
+	}
+	case PAINT_RADIAL:
+		paintRadialRow(p, line, x, y, n);
+		break;
+	case PAINT_PATTERN:
+		paintPatternRow(p, line, x, y, n);
+		break;
+	case PAINT_BITMAP:
+		paintBitmapRow(p, line, x, y, n);
+		break;
+	default:
+		rgb565Fill(line, p->color, n);
+		break;
+	}
+}
+
+// Rows with a single color are sent as solid spans
+static bool paintRowSolid(const PAINT_t *p, int16_t x, int16_t y, uint16_t *color) {
+	if (p->type == PAINT_SOLID) {
+		*color = p->color;
+		return true;
+	}
+	if (p->type == PAINT_LINEAR && p->tx == 0 && !p->dither) {
+		paintRow(p, color, x, y, 1);
+		return true;
+	}
+	return false;
+}
+
+// Span callback of the paint
+// Can be passed to rasterFill.
+// ctx:Pointer to PAINT_t
+void lcdPaintSpan(TFT_t * dev, int16_t x1, int16_t x2, int16_t y, void *ctx) {
+	const PAINT_t *p = (const PAINT_t *)ctx;
+	if (y < 0 || y >= dev->_height) return;
+	if (x1 < 0) x1 = 0;
+	if (x2 >= dev->_width) x2 = dev->_width - 1;
+	if (x1 > x2) return;
+
+	uint16_t color;
+	if (paintRowSolid(p, x1, y, &color)) {
+		lcdDrawHLine(dev, x1, x2, y, color);
+		return;
+	}
+	if (dev->_use_frame_buffer && !dev->_mono) {
+		paintRow(p, &dev->_frame_buffer[y*dev->_stride+x1], x1, y, x2 - x1 + 1);
+		return;
+	}
+	uint16_t line[PAINT_CHUNK];
+	for (int16_t x = x1; x <= x2; x += PAINT_CHUNK) {
+		uint16_t n = (x2 - x + 1 < PAINT_CHUNK) ? x2 - x + 1 : PAINT_CHUNK;
+		paintRow(p, line, x, y, n);
+		lcdDrawMultiPixels(dev, x, y, n, line);
+	}
+}
+
+// Draw rectangle of filling with paint
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+// paint:Paint of the pixels
+void lcdDrawFillRectPaint(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, const PAINT_t *paint) {
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 >= dev->_width) x2 = dev->_width - 1;
+	if (y2 >= dev->_height) y2 = dev->_height - 1;
+	if (x1 > x2 || y1 > y2) return;
+
+	if (paint->type == PAINT_SOLID) {
+		lcdDrawFillRect(dev, x1, y1, x2, y2, paint->color);
+		return;
+	}
+	if (dev->_use_frame_buffer) {
+		for (int16_t y = y1; y <= y2; y++) lcdPaintSpan(dev, x1, x2, y, (void *)paint);
+		return;
+	}
+
+	// Send the rows through one window
+	spi_master_write_command(dev, 0x2A);	// set column(x) address
+	spi_master_write_addr(dev, dev->_offsetx+x1, dev->_offsetx+x2);
+	spi_master_write_command(dev, 0x2B);	// set Page(y) address
+	spi_master_write_addr(dev, dev->_offsety+y1, dev->_offsety+y2);
+	spi_master_write_command(dev, 0x2C);	// Memory Write
+	uint16_t line[PAINT_CHUNK];
+	for (int16_t y = y1; y <= y2; y++) {
+		uint16_t color;
+		bool solid = paintRowSolid(paint, x1, y, &color);
+		for (int16_t x = x1; x <= x2; x += PAINT_CHUNK) {
+			uint16_t n = (x2 - x + 1 < PAINT_CHUNK) ? x2 - x + 1 : PAINT_CHUNK;
+			if (solid) {
+				spi_master_write_color(dev, color, n);
+			} else {
+				paintRow(paint, line, x, y, n);
+				spi_master_write_colors(dev, line, n);
+			}
+		}
+	}
+}
+
+// Draw polygon of filling with paint
+// points:Vertices
+// n:Number of vertices
+// paint:Paint of the pixels
+void lcdDrawFillPolygonPaint(TFT_t * dev, const POINT_t *points, uint16_t n, const PAINT_t *paint) {
+	int32_t *xy = rasterFixPoints(points, n);
+	if (xy == NULL) return;
+	RASTER_t r;
+	rasterInit(&r);
+	rasterAddPolygon(&r, xy, n);
+	free(xy);
+	rasterFill(dev, &r, lcdPaintSpan, (void *)paint);
+	rasterFree(&r);
+}
+
+// Draw circle of filling with paint
+// Covers the same pixels as lcdDrawFillCircle, one span per row.
+// x0:Central X coordinate
+// y0:Central Y coordinate
+// r:radius
+// paint:Paint of the pixels
+void lcdDrawFillCirclePaint(TFT_t * dev, int16_t x0, int16_t y0, uint16_t r, const PAINT_t *paint) {
+	int x = 0;
+	int y = -r;
+	int err = 2-2*r;
+	int old_err;
+	int half = 0;
+	bool ChangeX = true;
+	do {
+		if (ChangeX) half = x;
+		ChangeX = (old_err=err) <= x;
+		if (ChangeX) err += ++x*2+1;
+		if (old_err > y || err > x) {
+			// Row -y gets no wider columns
+			lcdPaintSpan(dev, x0-half, x0+half, y0+y, (void *)paint);
+			if (y) lcdPaintSpan(dev, x0-half, x0+half, y0-y, (void *)paint);
+			err += ++y*2+1;
+		}
+	} while (y <= 0);
+}
@@ -0,0 +1,53 @@
+#ifndef MAIN_PAINT_H_
+#define MAIN_PAINT_H_
+
+#include "st7789.h"
+
+// Paint objects for the fill primitives.
+// A paint generates the colors of one row span at a time. Gradients step
+// their color channels in 16.16 fixed point along the row, in RGB565 units,
+// so the only per row work is one division. Ordered dithering adds a 4x4
+// Bayer threshold before the channels are truncated to RGB565.
+
+typedef enum {
+	PAINT_SOLID,
+	PAINT_LINEAR,
+	PAINT_RADIAL,
+	PAINT_PATTERN,
+	PAINT_BITMAP,
+} PAINT_TYPE_t;
+
+typedef struct {
+	uint8_t type;
+	bool dither;
+	uint16_t color;		// Solid color, pattern foreground
+	uint16_t color0;	// Gradient start color, pattern background
+	uint16_t color1;	// Gradient end color
+	int16_t x;		// Gradient start, radial center or tile origin
+	int16_t y;
+	int32_t dx;		// Linear gradient vector
+	int32_t dy;
+	uint16_t radius;
+	int32_t tx;		// Gradient position change per pixel, 16.16
+	int32_t ty;
+	uint32_t inv;		// (1 << 30) / radius^2
+	const uint8_t *pattern;	// 8x8 pattern, one byte per row, MSB left
+	const uint16_t *bitmap;	// Tile of w*h pixels
+	uint16_t w;
+	uint16_t h;
+} PAINT_t;
+
+void lcdPaintSolid(PAINT_t *paint, uint16_t color);
+void lcdPaintLinear(PAINT_t *paint, int16_t x1, int16_t y1, uint16_t color1, int16_t x2, int16_t y2, uint16_t color2);
+void lcdPaintHorizontal(PAINT_t *paint, int16_t x1, uint16_t color1, int16_t x2, uint16_t color2);
+void lcdPaintVertical(PAINT_t *paint, int16_t y1, uint16_t color1, int16_t y2, uint16_t color2);
+void lcdPaintRadial(PAINT_t *paint, int16_t xc, int16_t yc, uint16_t r, uint16_t color1, uint16_t color2);
+void lcdPaintPattern(PAINT_t *paint, const uint8_t *pattern, int16_t x, int16_t y, uint16_t fg, uint16_t bg);
+void lcdPaintBitmap(PAINT_t *paint, const uint16_t *bitmap, uint16_t w, uint16_t h, int16_t x, int16_t y);
+void lcdPaintDither(PAINT_t *paint, bool dither);
+void lcdPaintSpan(TFT_t * dev, int16_t x1, int16_t x2, int16_t y, void *ctx);
+void lcdDrawFillRectPaint(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, const PAINT_t *paint);
+void lcdDrawFillPolygonPaint(TFT_t * dev, const POINT_t *points, uint16_t n, const PAINT_t *paint);
+void lcdDrawFillCirclePaint(TFT_t * dev, int16_t x0, int16_t y0, uint16_t r, const PAINT_t *paint);
+
+#endif /* MAIN_PAINT_H_ */
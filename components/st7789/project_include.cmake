@@ -0,0 +1,37 @@
+# Font compiler, see tools/fontx2c.py
+set(FONTX_COMPILER ${CMAKE_CURRENT_LIST_DIR}/tools/fontx2c.py)
+
+# Compile a FONTX or BDF font into a component
+# fontx_add_font(${COMPONENT_LIB} fonts/ILGH16XB.FNT ILGH16XB)
+# Include "ILGH16XB.h" and draw with ILGH16XB in place of a FontxFile.
+function(fontx_add_font target font name)
+    idf_build_get_property(python PYTHON)
+    get_filename_component(font ${font} ABSOLUTE BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
+    set(out_dir ${CMAKE_CURRENT_BINARY_DIR}/fonts)
+    add_custom_command(OUTPUT ${out_dir}/${name}.c ${out_dir}/${name}.h
+                       COMMAND ${python} ${FONTX_COMPILER} --name ${name} --out-dir ${out_dir} ${font}
+                       DEPENDS ${font} ${FONTX_COMPILER}
+                       VERBATIM)
+    target_sources(${target} PRIVATE ${out_dir}/${name}.c)
+    target_include_directories(${target} PRIVATE ${out_dir})
+endfunction()
+
+# Font compiler of anti-aliased fonts, see tools/aafont2c.py
+set(AAFONT_COMPILER ${CMAKE_CURRENT_LIST_DIR}/tools/aafont2c.py)
+
+# Compile a FONTX or BDF font drawn scale times larger into an
+# anti-aliased font of bpp bits per pixel
+# aafont_add_font(${COMPONENT_LIB} fonts/ILGH32XB.FNT ILGH8AA 4 4)
+# Include "ILGH8AA.h" and draw with lcdDrawAAString(dev, &ILGH8AA, ...).
+function(aafont_add_font target font name bpp scale)
+    idf_build_get_property(python PYTHON)
+    get_filename_component(font ${font} ABSOLUTE BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
+    set(out_dir ${CMAKE_CURRENT_BINARY_DIR}/fonts)
+    add_custom_command(OUTPUT ${out_dir}/${name}.c ${out_dir}/${name}.h
+                       COMMAND ${python} ${AAFONT_COMPILER} --name ${name} --out-dir ${out_dir}
+                               --bpp ${bpp} --scale ${scale} ${font}
+                       DEPENDS ${font} ${AAFONT_COMPILER} ${FONTX_COMPILER}
+                       VERBATIM)
+    target_sources(${target} PRIVATE ${out_dir}/${name}.c)
+    target_include_directories(${target} PRIVATE ${out_dir})
+endfunction()
@@ -0,0 +1,550 @@
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "raster.h"
+
+#define TAG "RASTER"
+
+// Miter joins longer than 4 times the half width fall back to bevel
+#define MITER_LIMIT 4
+
+// sin(0..90 degree) in 128 steps, Q15
+static const int16_t sin_table[129] = {
+	0, 402, 804, 1206, 1608, 2009, 2410, 2811,
+	3212, 3612, 4011, 4410, 4808, 5205, 5602, 5998,
+	6393, 6786, 7179, 7571, 7962, 8351, 8739, 9126,
+	9512, 9896, 10278, 10659, 11039, 11417, 11793, 12167,
+	12539, 12910, 13279, 13645, 14010, 14372, 14732, 15090,
+	15446, 15800, 16151, 16499, 16846, 17189, 17530, 17869,
+	18204, 18537, 18868, 19195, 19519, 19841, 20159, 20475,
+	20787, 21096, 21403, 21705, 22005, 22301, 22594, 22884,
+	23170, 23452, 23731, 24007, 24279, 24547, 24811, 25072,
+	25329, 25582, 25832, 26077, 26319, 26556, 26790, 27019,
+	27245, 27466, 27683, 27896, 28105, 28310, 28510, 28706,
+	28898, 29085, 29268, 29447, 29621, 29791, 29956, 30117,
+	30273, 30424, 30571, 30714, 30852, 30985, 31113, 31237,
+	31356, 31470, 31580, 31685, 31785, 31880, 31971, 32057,
+	32137, 32213, 32285, 32351, 32412, 32469, 32521, 32567,
+	32609, 32646, 32678, 32705, 32728, 32745, 32757, 32765,
+	32767
+};
+
+// sin of quarter wave
+// a:0-0x4000
+static int32_t quarter_sin(uint16_t a) {
+	uint16_t i = a >> 7;
+	if (i >= 128) return sin_table[128];
+	int32_t frac = a & 0x7F;
+	return sin_table[i] + (((sin_table[i+1] - sin_table[i]) * frac) >> 7);
+}
+
+// Sine
+// angle:Binary angle, 0x10000 is one turn
+// Return Q15 value
+int32_t rasterSin(uint16_t angle) {
+	uint16_t a = angle & 0x3FFF;
+	switch (angle >> 14) {
+	case 0: return quarter_sin(a);
+	case 1: return quarter_sin(0x4000 - a);
+	case 2: return -quarter_sin(a);
+	default: return -quarter_sin(0x4000 - a);
+	}
+}
+
+// Cosine
+// angle:Binary angle, 0x10000 is one turn
+// Return Q15 value
+int32_t rasterCos(uint16_t angle) {
+	return rasterSin(angle + 0x4000);
+}
+
+// Integer square root
+uint32_t rasterSqrt(uint64_t v) {
+	uint64_t res = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+	while (bit > v) bit >>= 2;
+	while (bit) {
+		if (v >= res + bit) {
+			v -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)res;
+}
+
+// Number of polygon segments for a circle
+// Keeps the chord error below about a quarter pixel.
+// radius:Radius, 24.8
+uint16_t rasterCircleSegments(int32_t radius) {
+	uint32_t n = 4 * (rasterSqrt(2 * (uint64_t)(radius >> FIX_SHIFT)) + 1);
+	if (n < 8) n = 8;
+	if (n > 128) n = 128;
+	return n & ~3;
+}
+
+void rasterInit(RASTER_t *r) {
+	r->edges = r->local;
+	r->n = 0;
+	r->size = RASTER_LOCAL_EDGES;
+	r->heap = false;
+}
+
+void rasterFree(RASTER_t *r) {
+	if (r->heap) free(r->edges);
+	rasterInit(r);
+}
+
+static bool rasterReserve(RASTER_t *r, uint16_t n) {
+	if (r->n + n <= r->size) return true;
+	uint32_t size = r->size * 2;
+	while (size < r->n + n) size *= 2;
+	if (size > UINT16_MAX) return false;
+	EDGE_t *edges = malloc(sizeof(EDGE_t) * size);
+	if (edges == NULL) {
+		ESP_LOGE(TAG, "malloc fail. Polygon is too complex.");
+		return false;
+	}
+	memcpy(edges, r->edges, sizeof(EDGE_t) * r->n);
+	if (r->heap) free(r->edges);
+	r->edges = edges;
+	r->size = size;
+	r->heap = true;
+	return true;
+}
+
+static void rasterAddEdge(RASTER_t *r, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int8_t dir) {
+	if (y0 == y1) return;
+	if (y0 > y1) {
+		int32_t t;
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+		dir = -dir;
+	}
+	// Rows whose center lies in [y0, y1)
+	int32_t first = (y0 + FIX_ONE - 1) >> FIX_SHIFT;
+	int32_t last = (y1 - 1) >> FIX_SHIFT;
+	if (first > last) return;
+	if (first < INT16_MIN) first = INT16_MIN;
+	if (last > INT16_MAX) last = INT16_MAX;
+	EDGE_t *e = &r->edges[r->n++];
+	e->xa = x0;
+	e->ya = y0;
+	e->xb = x1;
+	e->yb = y1;
+	e->y1 = first;
+	e->y2 = last;
+	e->dir = dir;
+}
+
+// Start a closed polygon
+// Edges are added as points come and turned around at the end if needed,
+// so every subpath ends up oriented the same way.
+void rasterBeginPolygon(RASTER_t *r, RASTER_PATH_t *path) {
+	path->r = r;
+	path->first = r->n;
+	path->n = 0;
+	path->area = 0;
+	path->failed = false;
+}
+
+// Add next point of polygon
+// x,y:Point in 24.8
+void rasterPolygonPoint(RASTER_PATH_t *path, int32_t x, int32_t y) {
+	if (path->n == 0) {
+		path->x0 = x;
+		path->y0 = y;
+	} else {
+		path->area += (int64_t)path->x * y - (int64_t)x * path->y;
+		if (!path->failed && rasterReserve(path->r, 1)) {
+			rasterAddEdge(path->r, path->x, path->y, x, y, 1);
+		} else {
+			path->failed = true;
+		}
+	}
+	path->x = x;
+	path->y = y;
+	path->n++;
+}
+
+// Close polygon
+// Returns false and drops its edges when it has no area.
+bool rasterEndPolygon(RASTER_PATH_t *path) {
+	RASTER_t *r = path->r;
+	if (path->n >= 3) {
+		rasterPolygonPoint(path, path->x0, path->y0);
+	}
+	if (path->n < 4 || path->area == 0 || path->failed) {
+		r->n = path->first;
+		return false;
+	}
+	if (path->area < 0) {
+		for (uint16_t i = path->first; i < r->n; i++) r->edges[i].dir = -r->edges[i].dir;
+	}
+	return true;
+}
+
+// Add closed polygon
+// xy:x0,y0,x1,y1,... in 24.8
+// n:Number of points
+bool rasterAddPolygon(RASTER_t *r, const int32_t *xy, uint16_t n) {
+	RASTER_PATH_t path;
+	rasterBeginPolygon(r, &path);
+	for (uint16_t i = 0; i < n; i++) {
+		rasterPolygonPoint(&path, xy[i*2], xy[i*2+1]);
+	}
+	return rasterEndPolygon(&path);
+}
+
+// Add circle as polygon
+// xc:Center X, 24.8
+// yc:Center Y, 24.8
+// radius:Radius, 24.8
+void rasterAddCircle(RASTER_t *r, int32_t xc, int32_t yc, int32_t radius) {
+	RASTER_PATH_t path;
+	uint16_t n = rasterCircleSegments(radius);
+	rasterBeginPolygon(r, &path);
+	for (uint16_t i = 0; i < n; i++) {
+		uint16_t angle = (uint32_t)i * 0x10000 / n;
+		rasterPolygonPoint(&path, xc + (int32_t)(((int64_t)radius * rasterCos(angle)) >> 15),
+			yc + (int32_t)(((int64_t)radius * rasterSin(angle)) >> 15));
+	}
+	rasterEndPolygon(&path);
+}
+
+static int compare_edge(const void *a, const void *b) {
+	return ((const EDGE_t *)a)->y1 - ((const EDGE_t *)b)->y1;
+}
+
+// Floor division
+static int64_t floor_div(int64_t a, int64_t b, int64_t *rem) {
+	int64_t q = a / b;
+	if ((a % b) && ((a < 0) != (b < 0))) q--;
+	*rem = a - q * b;
+	return q;
+}
+
+// Set X of edge at row y
+static void edge_start(EDGE_t *e, int16_t y) {
+	int64_t rem;
+	e->den = e->yb - e->ya;
+	e->x = e->xa + floor_div((int64_t)(TO_FIX(y) - e->ya) * (e->xb - e->xa), e->den, &rem);
+	e->rem = rem;
+	e->xstep = floor_div((int64_t)(e->xb - e->xa) * FIX_ONE, e->den, &rem);
+	e->remstep = rem;
+}
+
+// Pixel whose center is the first one at or right of the edge
+static inline int32_t edge_pixel(EDGE_t *e) {
+	return (e->x + (e->rem ? FIX_ONE : FIX_ONE - 1)) >> FIX_SHIFT;
+}
+
+// Fill all polygons through the span function
+// Each span is clipped to the render target.
+void rasterFill(TFT_t *dev, RASTER_t *r, SPAN_FUNC span, void *ctx) {
+	if (r->n == 0) return;
+	qsort(r->edges, r->n, sizeof(EDGE_t), compare_edge);
+
+	uint16_t act_local[RASTER_LOCAL_EDGES];
+	uint16_t *act = act_local;
+	if (r->n > RASTER_LOCAL_EDGES) {
+		act = malloc(sizeof(uint16_t) * r->n);
+		if (act == NULL) {
+			ESP_LOGE(TAG, "malloc fail. Polygon is too complex.");
+			return;
+		}
+	}
+
+	int16_t ymin = 0;
+	int16_t ymax = dev->_height - 1;
+	uint16_t next = 0;
+	uint16_t nact = 0;
+	int16_t y = r->edges[0].y1;
+	if (y < ymin) y = ymin;
+	for (; y <= ymax; y++) {
+		// Drop finished edges
+		uint16_t k = 0;
+		for (uint16_t i = 0; i < nact; i++) {
+			if (r->edges[act[i]].y2 >= y) act[k++] = act[i];
+		}
+		nact = k;
+		// Add new edges
+		while (next < r->n && r->edges[next].y1 <= y) {
+			EDGE_t *e = &r->edges[next];
+			if (e->y2 >= y) {
+				edge_start(e, y);
+				act[nact++] = next;
+			}
+			next++;
+		}
+		if (nact == 0) {
+			if (next >= r->n) break;
+			y = r->edges[next].y1 - 1;
+			continue;
+		}
+
+		// Sort by x. The order changes little from row to row.
+		for (uint16_t i = 1; i < nact; i++) {
+			uint16_t a = act[i];
+			int32_t x = r->edges[a].x;
+			int16_t j = i - 1;
+			while (j >= 0 && r->edges[act[j]].x > x) {
+				act[j+1] = act[j];
+				j--;
+			}
+			act[j+1] = a;
+		}
+
+		// Nonzero winding
+		int winding = 0;
+		int32_t x1 = 0;
+		for (uint16_t i = 0; i < nact; i++) {
+			EDGE_t *e = &r->edges[act[i]];
+			int before = winding;
+			winding += e->dir;
+			if (before == 0 && winding != 0) {
+				x1 = edge_pixel(e);
+			} else if (before != 0 && winding == 0) {
+				// Pixels whose center lies in [left edge, right edge)
+				int32_t x2 = edge_pixel(e) - 1;
+				if (x1 < 0) x1 = 0;
+				if (x2 >= dev->_width) x2 = dev->_width - 1;
+				if (x1 <= x2) span(dev, x1, x2, y, ctx);
+			}
+			e->x += e->xstep;
+			e->rem += e->remstep;
+			if (e->rem >= e->den) {
+				e->rem -= e->den;
+				e->x++;
+			}
+		}
+	}
+
+	if (act != act_local) free(act);
+}
+
+// Solid color span
+// ctx:Pointer to color
+void rasterSolidSpan(TFT_t * dev, int16_t x1, int16_t x2, int16_t y, void *ctx) {
+	lcdDrawHLine(dev, x1, x2, y, *(uint16_t *)ctx);
+}
+
+// Convert points to 24.8
+int32_t *rasterFixPoints(const POINT_t *points, uint16_t n) {
+	int32_t *xy = malloc(sizeof(int32_t) * 2 * n);
+	if (xy == NULL) return NULL;
+	for (uint16_t i = 0; i < n; i++) {
+		xy[i*2] = TO_FIX(points[i].x);
+		xy[i*2+1] = TO_FIX(points[i].y);
+	}
+	return xy;
+}
+
+// Draw polygon of filling
+// points:Vertices
+// n:Number of vertices
+// color:color
+void lcdDrawFillPolygon(TFT_t * dev, const POINT_t *points, uint16_t n, uint16_t color) {
+	int32_t *xy = rasterFixPoints(points, n);
+	if (xy == NULL) return;
+	RASTER_t r;
+	rasterInit(&r);
+	rasterAddPolygon(&r, xy, n);
+	free(xy);
+	rasterFill(dev, &r, rasterSolidSpan, &color);
+	rasterFree(&r);
+}
+
+// Offset vector of length hw perpendicular to (dx, dy)
+static void strokeNormal(int32_t dx, int32_t dy, int32_t hw, int32_t *nx, int32_t *ny) {
+	int32_t len = rasterSqrt((int64_t)dx * dx + (int64_t)dy * dy);
+	*nx = (int32_t)(-(int64_t)dy * hw / len);
+	*ny = (int32_t)((int64_t)dx * hw / len);
+}
+
+static void strokeQuad(RASTER_t *r, int32_t ax, int32_t ay, int32_t bx, int32_t by, int32_t nx, int32_t ny) {
+	int32_t xy[8] = {
+		ax + nx, ay + ny,
+		bx + nx, by + ny,
+		bx - nx, by - ny,
+		ax - nx, ay - ny,
+	};
+	rasterAddPolygon(r, xy, 4);
+}
+
+// Join two segments at (px, py)
+// n1,n2:Offset vectors of incoming and outgoing segment
+// dx,dy:Direction of outgoing segment
+static void strokeJoin(RASTER_t *r, int32_t px, int32_t py, int32_t n1x, int32_t n1y, int32_t n2x, int32_t n2y, int32_t dx, int32_t dy, int32_t hw, JOIN_t join) {
+	if (n1x == n2x && n1y == n2y) return;
+	if (join == JOIN_ROUND) {
+		rasterAddCircle(r, px, py, hw);
+		return;
+	}
+
+	// The path turns away from the outer side
+	int64_t turn = (int64_t)n1x * dx + (int64_t)n1y * dy;
+	if (turn > 0) {
+		n1x = -n1x; n1y = -n1y;
+		n2x = -n2x; n2y = -n2y;
+	}
+
+	int64_t hw2 = (int64_t)hw * hw;
+	int64_t denom = hw2 + (int64_t)n1x * n2x + (int64_t)n1y * n2y;
+	if (join == JOIN_MITER && denom * MITER_LIMIT * MITER_LIMIT >= hw2 * 2) {
+		// Miter point is (n1+n2) * hw^2 / (hw^2 + n1.n2)
+		int32_t mx = (int32_t)((int64_t)(n1x + n2x) * hw2 / denom);
+		int32_t my = (int32_t)((int64_t)(n1y + n2y) * hw2 / denom);
+		int32_t xy[8] = {
+			px, py,
+			px + n1x, py + n1y,
+			px + mx, py + my,
+			px + n2x, py + n2y,
+		};
+		rasterAddPolygon(r, xy, 4);
+	} else {
+		int32_t xy[6] = {
+			px, py,
+			px + n1x, py + n1y,
+			px + n2x, py + n2y,
+		};
+		rasterAddPolygon(r, xy, 3);
+	}
+}
+
+// Stroke polyline into rasterizer
+// points:x0,y0,x1,y1,... in 24.8
+// n:Number of points
+void rasterAddStroke(RASTER_t *r, const int32_t *points, uint16_t n, uint16_t width, JOIN_t join, CAP_t cap, bool closed) {
+	int32_t hw = TO_FIX(width) / 2;
+
+	// Drop repeated points
+	uint16_t m = 0;
+	int32_t *xy = malloc(sizeof(int32_t) * 2 * n);
+	if (xy == NULL) return;
+	for (uint16_t i = 0; i < n; i++) {
+		int32_t x = points[i*2];
+		int32_t y = points[i*2+1];
+		if (m && xy[m*2-2] == x && xy[m*2-1] == y) continue;
+		xy[m*2] = x;
+		xy[m*2+1] = y;
+		m++;
+	}
+	if (closed && m > 1 && xy[0] == xy[m*2-2] && xy[1] == xy[m*2-1]) m--;
+
+	if (m == 0) {
+		free(xy);
+		return;
+	}
+	if (m == 1) {
+		// Dot
+		if (cap == CAP_ROUND) {
+			rasterAddCircle(r, xy[0], xy[1], hw);
+		} else if (cap == CAP_SQUARE) {
+			int32_t box[8] = {
+				xy[0] - hw, xy[1] - hw,
+				xy[0] + hw, xy[1] - hw,
+				xy[0] + hw, xy[1] + hw,
+				xy[0] - hw, xy[1] + hw,
+			};
+			rasterAddPolygon(r, box, 4);
+		}
+		free(xy);
+		return;
+	}
+	if (m < 3) closed = false;
+
+	uint16_t segments = closed ? m : m - 1;
+	int32_t first_nx = 0, first_ny = 0;
+	int32_t prev_nx = 0, prev_ny = 0;
+	for (uint16_t i = 0; i < segments; i++) {
+		uint16_t j = (i + 1 == m) ? 0 : i + 1;
+		int32_t ax = xy[i*2], ay = xy[i*2+1];
+		int32_t bx = xy[j*2], by = xy[j*2+1];
+		int32_t dx = bx - ax, dy = by - ay;
+		int32_t nx, ny;
+		strokeNormal(dx, dy, hw, &nx, &ny);
+
+		if (i > 0) strokeJoin(r, ax, ay, prev_nx, prev_ny, nx, ny, dx, dy, hw, join);
+		else {
+			first_nx = nx;
+			first_ny = ny;
+		}
+
+		if (!closed && cap == CAP_SQUARE) {
+			// Extend the open ends by half the width
+			int32_t ex = ny, ey = -nx;
+			if (i == 0) { ax -= ex; ay -= ey; }
+			if (i == segments - 1) { bx += ex; by += ey; }
+		}
+		strokeQuad(r, ax, ay, bx, by, nx, ny);
+		prev_nx = nx;
+		prev_ny = ny;
+	}
+
+	if (closed) {
+		int32_t dx = xy[2] - xy[0], dy = xy[3] - xy[1];
+		strokeJoin(r, xy[0], xy[1], prev_nx, prev_ny, first_nx, first_ny, dx, dy, hw, join);
+	} else if (cap == CAP_ROUND) {
+		rasterAddCircle(r, xy[0], xy[1], hw);
+		rasterAddCircle(r, xy[m*2-2], xy[m*2-1], hw);
+	}
+	free(xy);
+}
+
+// Draw thick polyline
+// All segments, joins and caps are rasterized in one pass.
+// points:Vertices
+// n:Number of vertices
+// width:Line width
+// join:Shape of joins
+// cap:Shape of both ends
+// color:color
+void lcdDrawPolyline(TFT_t * dev, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, CAP_t cap, uint16_t color) {
+	if (n == 0 || width == 0) return;
+	int32_t *xy = rasterFixPoints(points, n);
+	if (xy == NULL) return;
+	RASTER_t r;
+	rasterInit(&r);
+	rasterAddStroke(&r, xy, n, width, join, cap, false);
+	free(xy);
+	rasterFill(dev, &r, rasterSolidSpan, &color);
+	rasterFree(&r);
+}
+
+// Draw thick polygon outline
+// points:Vertices
+// n:Number of vertices
+// width:Line width
+// join:Shape of joins
+// color:color
+void lcdDrawPolygon(TFT_t * dev, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, uint16_t color) {
+	if (n == 0 || width == 0) return;
+	int32_t *xy = rasterFixPoints(points, n);
+	if (xy == NULL) return;
+	RASTER_t r;
+	rasterInit(&r);
+	rasterAddStroke(&r, xy, n, width, join, CAP_BUTT, true);
+	free(xy);
+	rasterFill(dev, &r, rasterSolidSpan, &color);
+	rasterFree(&r);
+}
+
+// Draw thick line
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+// width:Line width
+// cap:Shape of both ends
+// color:color
+void lcdDrawThickLine(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t width, CAP_t cap, uint16_t color) {
+	POINT_t points[2] = {{x1, y1}, {x2, y2}};
+	lcdDrawPolyline(dev, points, 2, width, JOIN_MITER, cap, color);
+}
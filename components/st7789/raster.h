@@ -0,0 +1,72 @@
+#ifndef MAIN_RASTER_H_
+#define MAIN_RASTER_H_
+
+#include "st7789.h"
+
+// Scanline polygon rasterizer shared by the fill, stroke and curve
+// primitives. Coordinates are 24.8 fixed point, integer pixel coordinates
+// are pixel centers. Polygons are filled with the nonzero winding rule and
+// every subpath is oriented the same way, so overlapping subpaths merge
+// and each pixel is written once.
+
+#define FIX_SHIFT 8
+#define FIX_ONE (1 << FIX_SHIFT)
+#define TO_FIX(v) ((int32_t)(v) * FIX_ONE)
+
+#define RASTER_LOCAL_EDGES 48
+
+// X of an edge is stepped exactly: x + rem/den at the current row
+typedef struct {
+	int32_t x;		// X at current row, 24.8
+	int32_t rem;		// Remainder of X, 0 <= rem < den
+	int32_t den;
+	int32_t xstep;		// X change per row
+	int32_t remstep;
+	int32_t xa;		// Top point, 24.8
+	int32_t ya;
+	int32_t xb;		// Bottom point, 24.8
+	int32_t yb;
+	int16_t y1;		// First row
+	int16_t y2;		// Last row
+	int8_t dir;
+} EDGE_t;
+
+typedef struct {
+	EDGE_t *edges;
+	uint16_t n;
+	uint16_t size;
+	bool heap;
+	EDGE_t local[RASTER_LOCAL_EDGES];
+} RASTER_t;
+
+// Closed polygon added point by point, without a point array
+typedef struct {
+	RASTER_t *r;
+	uint16_t first;		// First edge of the polygon
+	uint16_t n;
+	int32_t x0;		// First point, 24.8
+	int32_t y0;
+	int32_t x;		// Last point, 24.8
+	int32_t y;
+	int64_t area;
+	bool failed;
+} RASTER_PATH_t;
+
+void rasterInit(RASTER_t *r);
+void rasterFree(RASTER_t *r);
+bool rasterAddPolygon(RASTER_t *r, const int32_t *xy, uint16_t n);
+void rasterBeginPolygon(RASTER_t *r, RASTER_PATH_t *path);
+void rasterPolygonPoint(RASTER_PATH_t *path, int32_t x, int32_t y);
+bool rasterEndPolygon(RASTER_PATH_t *path);
+void rasterAddCircle(RASTER_t *r, int32_t xc, int32_t yc, int32_t radius);
+void rasterAddStroke(RASTER_t *r, const int32_t *xy, uint16_t n, uint16_t width, JOIN_t join, CAP_t cap, bool closed);
+void rasterFill(TFT_t *dev, RASTER_t *r, SPAN_FUNC span, void *ctx);
+void rasterSolidSpan(TFT_t * dev, int16_t x1, int16_t x2, int16_t y, void *ctx);
+int32_t *rasterFixPoints(const POINT_t *points, uint16_t n);
+
+int32_t rasterSin(uint16_t angle);
+int32_t rasterCos(uint16_t angle);
+uint32_t rasterSqrt(uint64_t v);
+uint16_t rasterCircleSegments(int32_t radius);
+
+#endif /* MAIN_RASTER_H_ */
@@ -0,0 +1,401 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "render.h"
+
+#define TAG "RENDER"
+
+#define RENDER_STACK_SIZE 8192
+
+// Rows a stroke can reach beyond its points, miter joins included
+#define STROKE_MARGIN(width) ((int16_t)((width) * 2 + 2))
+
+static void renderRegion(RENDER_t *render, int16_t y1, int16_t y2);
+
+static void renderWorker(void *arg) {
+	RENDER_WORKER_t *worker = (RENDER_WORKER_t *)arg;
+	RENDER_t *render = worker->render;
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		if (render->quit) break;
+		renderRegion(render, worker->y1, worker->y2);
+		xTaskNotifyGive(render->caller);
+	}
+	xTaskNotifyGive(render->caller);
+	vTaskDelete(NULL);
+}
+
+// Initialize display list and start one worker per core
+// max_cmds:Number of commands in the list
+// arena_size:Bytes for points and glyph patterns
+bool lcdRenderInit(RENDER_t *render, TFT_t *dev, uint16_t max_cmds, size_t arena_size) {
+	memset(render, 0, sizeof(RENDER_t));
+	render->dev = dev;
+	render->cmds = malloc(max_cmds * sizeof(RENDER_CMD_t));
+	render->arena = malloc(arena_size);
+	if (render->cmds == NULL || render->arena == NULL) {
+		ESP_LOGE(TAG, "Error allocating display list.");
+		free(render->cmds);
+		free(render->arena);
+		return false;
+	}
+	render->max_cmds = max_cmds;
+	render->arena_size = arena_size;
+	render->caller = xTaskGetCurrentTaskHandle();
+
+	uint8_t cores = (portNUM_PROCESSORS > RENDER_MAX_WORKERS) ? RENDER_MAX_WORKERS : portNUM_PROCESSORS;
+	if (cores < 2) return true;
+	for (uint8_t i = 0; i < cores; i++) {
+		RENDER_WORKER_t *worker = &render->workers[i];
+		worker->render = render;
+		if (xTaskCreatePinnedToCore(renderWorker, "RENDER", RENDER_STACK_SIZE, worker, uxTaskPriorityGet(NULL), &worker->task, i) != pdPASS) {
+			ESP_LOGW(TAG, "Worker on core %d is not available.", i);
+			break;
+		}
+		render->nworkers++;
+	}
+	// One worker is no faster than drawing in place
+	if (render->nworkers == 1) {
+		render->quit = true;
+		xTaskNotifyGive(render->workers[0].task);
+		ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+		render->nworkers = 0;
+		render->quit = false;
+	}
+	ESP_LOGI(TAG, "%d render workers", render->nworkers);
+	return true;
+}
+
+// Stop workers and free display list
+void lcdRenderDelete(RENDER_t *render) {
+	render->caller = xTaskGetCurrentTaskHandle();
+	render->quit = true;
+	for (uint8_t i = 0; i < render->nworkers; i++) xTaskNotifyGive(render->workers[i].task);
+	for (uint8_t i = 0; i < render->nworkers; i++) ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	render->nworkers = 0;
+	free(render->cmds);
+	free(render->arena);
+	render->cmds = NULL;
+	render->arena = NULL;
+}
+
+// Start a new frame
+void lcdRenderBegin(RENDER_t *render) {
+	render->ncmds = 0;
+	render->used = 0;
+	render->max_points = 0;
+}
+
+// Execute the display list and wait for the workers
+void lcdRenderEnd(RENDER_t *render) {
+	TFT_t *dev = render->dev;
+	if (render->ncmds == 0) return;
+
+	if (!dev->_use_frame_buffer || render->nworkers == 0) {
+		renderRegion(render, 0, dev->_height);
+	} else {
+		render->caller = xTaskGetCurrentTaskHandle();
+		for (uint8_t i = 0; i < render->nworkers; i++) {
+			RENDER_WORKER_t *worker = &render->workers[i];
+			worker->y1 = (int32_t)dev->_height * i / render->nworkers;
+			worker->y2 = (int32_t)dev->_height * (i + 1) / render->nworkers;
+			xTaskNotifyGive(worker->task);
+		}
+		for (uint8_t i = 0; i < render->nworkers; i++) ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	}
+	lcdRenderBegin(render);
+}
+
+// Replay one command with rows shifted up by dy
+static void renderCommand(TFT_t *dev, const RENDER_CMD_t *cmd, int16_t dy, POINT_t *points) {
+	// Coordinates wrap as uint16_t, so rows above the region are negative
+	uint16_t y1 = cmd->y1 - dy;
+	uint16_t y2 = cmd->y2 - dy;
+	switch (cmd->op) {
+	case RENDER_PIXEL:
+		lcdDrawPixel(dev, cmd->x1, y1, cmd->color);
+		break;
+	case RENDER_LINE:
+		lcdDrawLine(dev, cmd->x1, y1, cmd->x2, y2, cmd->color);
+		break;
+	case RENDER_RECT:
+		lcdDrawRect(dev, cmd->x1, y1, cmd->x2, y2, cmd->color);
+		break;
+	case RENDER_FILL_RECT:
+		lcdDrawFillRect(dev, cmd->x1, y1, cmd->x2, y2, cmd->color);
+		break;
+	case RENDER_CIRCLE:
+		lcdDrawCircle(dev, cmd->x1, y1, cmd->width, cmd->color);
+		break;
+	case RENDER_FILL_CIRCLE:
+		lcdDrawFillCircle(dev, cmd->x1, y1, cmd->width, cmd->color);
+		break;
+	case RENDER_FILL_POLYGON:
+	case RENDER_POLYLINE:
+	case RENDER_POLYGON: {
+		const POINT_t *src = (const POINT_t *)cmd->data;
+		for (uint16_t i = 0; i < cmd->n; i++) {
+			points[i].x = src[i].x;
+			points[i].y = src[i].y - dy;
+		}
+		if (cmd->op == RENDER_FILL_POLYGON) {
+			lcdDrawFillPolygon(dev, points, cmd->n, cmd->color);
+		} else if (cmd->op == RENDER_POLYLINE) {
+			lcdDrawPolyline(dev, points, cmd->n, cmd->width, cmd->join, cmd->cap, cmd->color);
+		} else {
+			lcdDrawPolygon(dev, points, cmd->n, cmd->width, cmd->join, cmd->color);
+		}
+		break;
+	}
+	case RENDER_STRING: {
+		const uint8_t *fonts = (const uint8_t *)cmd->data;
+		uint8_t pw = cmd->width >> 8;
+		uint8_t ph = cmd->width & 0xFF;
+		uint16_t fsz = (pw + 7) / 8 * ph;
+		int x = cmd->x1;
+		int y = cmd->y1;
+		dev->_font_direction = cmd->direction;
+		dev->_font_fill = cmd->fill;
+		dev->_font_fill_color = cmd->fill_color;
+		dev->_font_underline = cmd->underline;
+		dev->_font_underline_color = cmd->underline_color;
+		// Advance in screen rows, as lcdDrawString stops at 0
+		for (uint16_t i = 0; i < cmd->n; i++) {
+			lcdDrawGlyph(dev, &fonts[i * fsz], pw, ph, x, y - dy, cmd->color);
+			if (cmd->direction == DIRECTION0 || cmd->direction == DIRECTION180) {
+				x += (cmd->direction == DIRECTION0) ? pw : -pw;
+				if (x < 0) x = 0;
+			} else {
+				y += (cmd->direction == DIRECTION90) ? pw : -pw;
+				if (y < 0) y = 0;
+			}
+		}
+		break;
+	}
+	}
+}
+
+// Replay the commands touching rows y1..y2-1
+static void renderRegion(RENDER_t *render, int16_t y1, int16_t y2) {
+	TFT_t region = *render->dev;
+	if (region._mono) {
+		region._mono_buffer += y1 * region._mono_stride;
+	} else if (region._use_frame_buffer) {
+		region._frame_buffer += y1 * region._stride;
+	}
+	region._height = y2 - y1;
+
+	POINT_t local[16];
+	POINT_t *points = local;
+	if (render->max_points > 16) {
+		points = malloc(render->max_points * sizeof(POINT_t));
+		if (points == NULL) {
+			ESP_LOGE(TAG, "Error allocating points.");
+			return;
+		}
+	}
+	for (uint16_t i = 0; i < render->ncmds; i++) {
+		const RENDER_CMD_t *cmd = &render->cmds[i];
+		if (cmd->bottom < y1 || cmd->top >= y2) continue;
+		renderCommand(&region, cmd, y1, points);
+	}
+	if (points != local) free(points);
+}
+
+// Next free command, running the list when it is full
+static RENDER_CMD_t *renderAdd(RENDER_t *render, RENDER_OP_t op, int16_t top, int16_t bottom, uint16_t color) {
+	if (render->ncmds == render->max_cmds) lcdRenderEnd(render);
+	RENDER_CMD_t *cmd = &render->cmds[render->ncmds++];
+	memset(cmd, 0, sizeof(RENDER_CMD_t));
+	cmd->op = op;
+	cmd->top = top;
+	cmd->bottom = bottom;
+	cmd->color = color;
+	return cmd;
+}
+
+// Bytes from the arena, running the list when it is full
+static void *renderAlloc(RENDER_t *render, size_t size) {
+	size = (size + 3) & ~3;
+	if (size > render->arena_size) return NULL;
+	if (render->used + size > render->arena_size) lcdRenderEnd(render);
+	void *p = &render->arena[render->used];
+	render->used += size;
+	return p;
+}
+
+// Record points of a polygon command
+static RENDER_CMD_t *renderAddPoints(RENDER_t *render, RENDER_OP_t op, const POINT_t *points, uint16_t n, int16_t margin, uint16_t color) {
+	int16_t top = points[0].y;
+	int16_t bottom = points[0].y;
+	for (uint16_t i = 1; i < n; i++) {
+		if (points[i].y < top) top = points[i].y;
+		if (points[i].y > bottom) bottom = points[i].y;
+	}
+	// Reserve the command first, running the list keeps no arena data
+	if (render->ncmds == render->max_cmds) lcdRenderEnd(render);
+	POINT_t *data = renderAlloc(render, n * sizeof(POINT_t));
+	if (data == NULL) return NULL;
+	memcpy(data, points, n * sizeof(POINT_t));
+	if (n > render->max_points) render->max_points = n;
+	RENDER_CMD_t *cmd = renderAdd(render, op, top - margin, bottom + margin, color);
+	cmd->data = data;
+	cmd->n = n;
+	return cmd;
+}
+
+// Record screen fill
+void lcdRenderFillScreen(RENDER_t *render, uint16_t color) {
+	TFT_t *dev = render->dev;
+	lcdRenderDrawFillRect(render, 0, 0, dev->_width-1, dev->_height-1, color);
+}
+
+// Record pixel
+void lcdRenderDrawPixel(RENDER_t *render, int16_t x, int16_t y, uint16_t color) {
+	RENDER_CMD_t *cmd = renderAdd(render, RENDER_PIXEL, y, y, color);
+	cmd->x1 = x;
+	cmd->y1 = y;
+}
+
+static void renderAddRect(RENDER_t *render, RENDER_OP_t op, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	RENDER_CMD_t *cmd = renderAdd(render, op, (y1 < y2) ? y1 : y2, (y1 < y2) ? y2 : y1, color);
+	cmd->x1 = x1;
+	cmd->y1 = y1;
+	cmd->x2 = x2;
+	cmd->y2 = y2;
+}
+
+// Record line
+void lcdRenderDrawLine(RENDER_t *render, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	renderAddRect(render, RENDER_LINE, x1, y1, x2, y2, color);
+}
+
+// Record rectangle
+void lcdRenderDrawRect(RENDER_t *render, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	renderAddRect(render, RENDER_RECT, x1, y1, x2, y2, color);
+}
+
+// Record rectangle of filling
+void lcdRenderDrawFillRect(RENDER_t *render, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+	renderAddRect(render, RENDER_FILL_RECT, x1, y1, x2, y2, color);
+}
+
+// Record circle
+void lcdRenderDrawCircle(RENDER_t *render, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	RENDER_CMD_t *cmd = renderAdd(render, RENDER_CIRCLE, y0 - r, y0 + r, color);
+	cmd->x1 = x0;
+	cmd->y1 = y0;
+	cmd->width = r;
+}
+
+// Record circle of filling
+void lcdRenderDrawFillCircle(RENDER_t *render, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	RENDER_CMD_t *cmd = renderAdd(render, RENDER_FILL_CIRCLE, y0 - r, y0 + r, color);
+	cmd->x1 = x0;
+	cmd->y1 = y0;
+	cmd->width = r;
+}
+
+// Record polygon of filling
+void lcdRenderDrawFillPolygon(RENDER_t *render, const POINT_t *points, uint16_t n, uint16_t color) {
+	if (n == 0) return;
+	if (renderAddPoints(render, RENDER_FILL_POLYGON, points, n, 1, color) == NULL) {
+		lcdRenderEnd(render);
+		lcdDrawFillPolygon(render->dev, points, n, color);
+	}
+}
+
+// Record polyline
+void lcdRenderDrawPolyline(RENDER_t *render, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, CAP_t cap, uint16_t color) {
+	if (n == 0) return;
+	RENDER_CMD_t *cmd = renderAddPoints(render, RENDER_POLYLINE, points, n, STROKE_MARGIN(width), color);
+	if (cmd == NULL) {
+		lcdRenderEnd(render);
+		lcdDrawPolyline(render->dev, points, n, width, join, cap, color);
+		return;
+	}
+	cmd->width = width;
+	cmd->join = join;
+	cmd->cap = cap;
+}
+
+// Record polygon outline
+void lcdRenderDrawPolygon(RENDER_t *render, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, uint16_t color) {
+	if (n == 0) return;
+	RENDER_CMD_t *cmd = renderAddPoints(render, RENDER_POLYGON, points, n, STROKE_MARGIN(width), color);
+	if (cmd == NULL) {
+		lcdRenderEnd(render);
+		lcdDrawPolygon(render->dev, points, n, width, join, color);
+		return;
+	}
+	cmd->width = width;
+	cmd->join = join;
+}
+
+// Record string
+// Glyphs are read from the font now, so workers never share the font file.
+// Returns the same position as lcdDrawString.
+int lcdRenderDrawString(RENDER_t *render, FontxFile *fx, int16_t x, int16_t y, const uint8_t *ascii, uint16_t color) {
+	TFT_t *dev = render->dev;
+	uint8_t pw, ph;
+	uint16_t n = strlen((const char *)ascii);
+	if (n == 0 || !GetFontx(fx, ascii[0], &pw, &ph)) return 0;
+	uint16_t fsz = (pw + 7) / 8 * ph;
+	// Scaled glyphs are drawn now, workers would share the scale buffer
+	if (dev->_font_scale > 1) {
+		lcdRenderEnd(render);
+		return lcdDrawString(dev, fx, x, y, (uint8_t *)ascii, color);
+	}
+
+	if (render->ncmds == render->max_cmds) lcdRenderEnd(render);
+	uint8_t *fonts = renderAlloc(render, (size_t)fsz * n);
+	if (fonts == NULL) {
+		lcdRenderEnd(render);
+		return lcdDrawString(dev, fx, x, y, (uint8_t *)ascii, color);
+	}
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i++) {
+		if (!GetFontx(fx, ascii[i], &pw, &ph)) break;
+		memcpy(&fonts[count * fsz], fx->fonts, fsz);
+		count++;
+	}
+
+	// Rows of the text, with room for the fill box and underline
+	int16_t top, bottom;
+	int16_t length = count * pw;
+	uint16_t direction = dev->_font_direction;
+	if (direction == DIRECTION0 || direction == DIRECTION180) {
+		top = y - ph;
+		bottom = y + ph + 1;
+	} else if (direction == DIRECTION90) {
+		top = y;
+		bottom = y + length;
+	} else {
+		top = y - length;
+		bottom = y;
+	}
+	RENDER_CMD_t *cmd = renderAdd(render, RENDER_STRING, top, bottom, color);
+	cmd->x1 = x;
+	cmd->y1 = y;
+	cmd->width = pw << 8 | ph;
+	cmd->n = count;
+	cmd->data = fonts;
+	cmd->direction = direction;
+	cmd->fill = dev->_font_fill;
+	cmd->fill_color = dev->_font_fill_color;
+	cmd->underline = dev->_font_underline;
+	cmd->underline_color = dev->_font_underline_color;
+
+	int next;
+	if (direction == DIRECTION0) next = x + length;
+	else if (direction == DIRECTION180) next = x - length;
+	else if (direction == DIRECTION90) next = y + length;
+	else next = y - length;
+	if (next < 0) next = 0;
+	return next;
+}
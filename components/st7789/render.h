@@ -0,0 +1,94 @@
+#ifndef MAIN_RENDER_H_
+#define MAIN_RENDER_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "st7789.h"
+
+// Parallel frame buffer rendering.
+// Draw calls are recorded into a display list. lcdRenderEnd splits the
+// frame buffer into one horizontal region per CPU core and replays the
+// list on a worker task pinned to that core. Each worker only runs the
+// commands that touch its region and clips them to it, so the workers
+// never write the same pixel. lcdRenderEnd returns after all workers are
+// done, then the frame can be sent with lcdDrawFinish.
+
+#define RENDER_MAX_WORKERS 2
+
+typedef enum {
+	RENDER_PIXEL,
+	RENDER_LINE,
+	RENDER_RECT,
+	RENDER_FILL_RECT,
+	RENDER_CIRCLE,
+	RENDER_FILL_CIRCLE,
+	RENDER_FILL_POLYGON,
+	RENDER_POLYLINE,
+	RENDER_POLYGON,
+	RENDER_STRING,
+} RENDER_OP_t;
+
+// One recorded draw call
+typedef struct {
+	uint8_t op;
+	uint8_t join;
+	uint8_t cap;
+	uint8_t direction;	// Font state of RENDER_STRING
+	uint8_t fill;
+	uint8_t underline;
+	uint16_t color;
+	int16_t x1;
+	int16_t y1;
+	int16_t x2;
+	int16_t y2;
+	uint16_t width;		// Line width, radius or glyph width and height
+	uint16_t n;		// Number of points or glyphs
+	uint16_t fill_color;
+	uint16_t underline_color;
+	int16_t top;		// Rows touched by the command
+	int16_t bottom;
+	const void *data;	// Points or glyph patterns in the arena
+} RENDER_CMD_t;
+
+typedef struct RENDER_s RENDER_t;
+
+typedef struct {
+	RENDER_t *render;
+	TaskHandle_t task;
+	int16_t y1;		// Region rows of the current frame
+	int16_t y2;
+} RENDER_WORKER_t;
+
+struct RENDER_s {
+	TFT_t *dev;
+	RENDER_CMD_t *cmds;
+	uint16_t ncmds;
+	uint16_t max_cmds;
+	uint8_t *arena;
+	size_t used;
+	size_t arena_size;
+	uint16_t max_points;
+	uint8_t nworkers;
+	bool quit;
+	TaskHandle_t caller;
+	RENDER_WORKER_t workers[RENDER_MAX_WORKERS];
+};
+
+bool lcdRenderInit(RENDER_t *render, TFT_t *dev, uint16_t max_cmds, size_t arena_size);
+void lcdRenderDelete(RENDER_t *render);
+void lcdRenderBegin(RENDER_t *render);
+void lcdRenderEnd(RENDER_t *render);
+void lcdRenderFillScreen(RENDER_t *render, uint16_t color);
+void lcdRenderDrawPixel(RENDER_t *render, int16_t x, int16_t y, uint16_t color);
+void lcdRenderDrawLine(RENDER_t *render, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+void lcdRenderDrawRect(RENDER_t *render, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+void lcdRenderDrawFillRect(RENDER_t *render, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+void lcdRenderDrawCircle(RENDER_t *render, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+void lcdRenderDrawFillCircle(RENDER_t *render, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+void lcdRenderDrawFillPolygon(RENDER_t *render, const POINT_t *points, uint16_t n, uint16_t color);
+void lcdRenderDrawPolyline(RENDER_t *render, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, CAP_t cap, uint16_t color);
+void lcdRenderDrawPolygon(RENDER_t *render, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, uint16_t color);
+int lcdRenderDrawString(RENDER_t *render, FontxFile *fx, int16_t x, int16_t y, const uint8_t *ascii, uint16_t color);
+
+#endif /* MAIN_RENDER_H_ */
@@ -0,0 +1,66 @@
+#ifndef MAIN_RING_H_
+#define MAIN_RING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Bounded multi-producer single-consumer ring of slots
+// Slot i starts free with sequence i. Producers claim slots with a
+// compare-and-swap on head and publish each one by setting its sequence
+// to pos+1. The consumer takes the slot at tail once its sequence is
+// tail+1 and frees it by setting the sequence one lap ahead.
+// Slot types differ per user, each must start with
+// _Atomic uint32_t sequence. size is the size of one slot.
+
+static inline _Atomic uint32_t *ringSequence(void *slots, size_t size, uint32_t mask, uint32_t pos) {
+	return (_Atomic uint32_t *)((uint8_t *)slots + (pos & mask) * size);
+}
+
+// Mark all slots free
+// count:Slots, a power of 2
+static inline void ringInit(_Atomic uint32_t *head, void *slots, size_t size, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) atomic_init(ringSequence(slots, size, count - 1, i), i);
+	atomic_init(head, 0);
+}
+
+// Claim n consecutive slots, never waits
+// The consumer frees slots in order, so the last slot being free means
+// all of them are.
+static inline bool ringClaim(_Atomic uint32_t *head, void *slots, size_t size, uint32_t mask, uint32_t n, uint32_t *pos) {
+	uint32_t h = atomic_load_explicit(head, memory_order_relaxed);
+	while (1) {
+		uint32_t last = h + n - 1;
+		uint32_t seq = atomic_load_explicit(ringSequence(slots, size, mask, last), memory_order_acquire);
+		int32_t diff = (int32_t)(seq - last);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(head, &h, h + n,
+					memory_order_relaxed, memory_order_relaxed)) {
+				*pos = h;
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			h = atomic_load_explicit(head, memory_order_relaxed);
+		}
+	}
+}
+
+// Hand a filled slot to the consumer
+static inline void ringPublish(void *slots, size_t size, uint32_t mask, uint32_t pos) {
+	atomic_store_explicit(ringSequence(slots, size, mask, pos), pos + 1, memory_order_release);
+}
+
+// Slot at tail was published
+static inline bool ringReady(void *slots, size_t size, uint32_t mask, uint32_t tail) {
+	return atomic_load_explicit(ringSequence(slots, size, mask, tail), memory_order_acquire) == tail + 1;
+}
+
+// Free the slot at tail for the next lap
+static inline void ringRelease(void *slots, size_t size, uint32_t mask, uint32_t tail) {
+	atomic_store_explicit(ringSequence(slots, size, mask, tail), tail + mask + 1, memory_order_release);
+}
+
+#endif /* MAIN_RING_H_ */
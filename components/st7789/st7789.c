@@ -1,4 +1,5 @@
 #include <string.h>
+#include <stdlib.h>
 #include <inttypes.h>
 #include <math.h>
 
@@ -8,8 +9,11 @@
 #include <driver/spi_master.h>
 #include <driver/gpio.h>
 #include "esp_log.h"
+#include "esp_attr.h"
 
 #include "st7789.h"
+#include "mono.h"
+#include "fbkernel.h"
 
 #define TAG "ST7789"
 #define	_DEBUG_ 0
@@ -210,11 +214,22 @@ void lcdInit(TFT_t * dev, int width, int height, int offsetx, int offsety)
 {
 	dev->_width = width;
 	dev->_height = height;
+	dev->_stride = width;
 	dev->_offsetx = offsetx;
 	dev->_offsety = offsety;
 	dev->_font_direction = DIRECTION0;
 	dev->_font_fill = false;
 	dev->_font_underline = false;
+	dev->_font_scale = 1;
+	dev->_font_smooth = false;
+	dev->_font_scaled = NULL;
+	dev->_font_scaled_size = 0;
+	dev->_cursor.sprite = NULL;
+	dev->_cursor.visible = false;
+	dev->_target = NULL;
+	dev->_mono = false;
+	dev->_mono_buffer = NULL;
+	dev->_mono_lut = NULL;
 
 	spi_master_write_command(dev, 0x01);	//Software Reset
 	delayMS(150);
@@ -276,11 +291,15 @@ void lcdInit(TFT_t * dev, int width, int height, int offsetx, int offsety)
 // y:Y coordinate
 // color:color
 void lcdDrawPixel(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color){
+	if (dev->_use_frame_buffer && !dev->_mono) {
+		lcdFbPixel(dev->_frame_buffer, dev->_stride, dev->_width, dev->_height, x, y, color);
+		return;
+	}
 	if (x >= dev->_width) return;
 	if (y >= dev->_height) return;
 
-	if (dev->_use_frame_buffer) {
-		dev->_frame_buffer[y*dev->_width+x] = color;
+	if (dev->_mono) {
+		monoSetPixel(dev, x, y, color);
 	} else {
 		uint16_t _x = x + dev->_offsetx;
 		uint16_t _y = y + dev->_offsety;
@@ -305,7 +324,9 @@ void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint
 	if (x+size > dev->_width) return;
 	if (y >= dev->_height) return;
 
-	if (dev->_use_frame_buffer) {
+	if (dev->_mono) {
+		for (uint16_t i = 0; i < size; i++) monoSetPixel(dev, x+i, y, colors[i]);
+	} else if (dev->_use_frame_buffer) {
 		uint16_t _x1 = x;
 		uint16_t _x2 = _x1 + (size-1);
 		uint16_t _y1 = y;
@@ -313,7 +334,7 @@ void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint
 		int16_t index = 0;
 		for (int16_t j = _y1; j <= _y2; j++){
 			for(int16_t i = _x1; i <= _x2; i++){
-				 dev->_frame_buffer[j*dev->_width+i] = colors[index++];
+				 dev->_frame_buffer[j*dev->_stride+i] = colors[index++];
 			}
 		}
 	} else {
@@ -338,19 +359,24 @@ void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint
 // y2:End Y coordinate
 // color:color
 void lcdDrawFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	if (dev->_use_frame_buffer && !dev->_mono) {
+		lcdFbFillRect(dev->_frame_buffer, dev->_stride, dev->_width, dev->_height, x1, y1, x2, y2, color);
+		return;
+	}
+	// Corners left or above the screen are clipped as negative coordinates
+	if ((int16_t)x2 < 0 || (int16_t)y2 < 0) return;
+	if ((int16_t)x1 < 0) x1 = 0;
+	if ((int16_t)y1 < 0) y1 = 0;
 	if (x1 >= dev->_width) return;
 	if (x2 >= dev->_width) x2=dev->_width-1;
 	if (y1 >= dev->_height) return;
 	if (y2 >= dev->_height) y2=dev->_height-1;
+	if (x1 > x2 || y1 > y2) return;
 
 	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
 
-	if (dev->_use_frame_buffer) {
-		for (int16_t j = y1; j <= y2; j++){
-			for(int16_t i = x1; i <= x2; i++){
-				dev->_frame_buffer[j*dev->_width+i] = color;
-			}
-		}
+	if (dev->_mono) {
+		monoFillRect(dev, x1, y1, x2, y2, color);
 	} else {
 		uint16_t _x1 = x1 + dev->_offsetx;
 		uint16_t _x2 = x2 + dev->_offsetx;
@@ -369,6 +395,149 @@ void lcdDrawFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_
 	}
 }
 
+// Draw pixel with alpha blending
+// x:X coordinate
+// y:Y coordinate
+// color:color
+// alpha:Opacity(0-255)
+void lcdDrawPixelAlpha(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color, uint8_t alpha) {
+	if (x >= dev->_width) return;
+	if (y >= dev->_height) return;
+
+	if (dev->_mono) {
+		if (alpha >= MONO_ALPHA_THRESHOLD) monoSetPixel(dev, x, y, color);
+	} else if (dev->_use_frame_buffer) {
+		uint16_t *p = &dev->_frame_buffer[y*dev->_stride+x];
+		*p = rgb565Blend(color, *p, alpha);
+	} else {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+	}
+}
+
+// Draw rectangle of filling with alpha blending
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+// color:color
+// alpha:Opacity(0-255)
+void lcdDrawFillRectAlpha(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, uint8_t alpha) {
+	if (x1 >= dev->_width) return;
+	if (x2 >= dev->_width) x2=dev->_width-1;
+	if (y1 >= dev->_height) return;
+	if (y2 >= dev->_height) y2=dev->_height-1;
+	if (x1 > x2 || y1 > y2) return;
+
+	if (dev->_mono) {
+		if (alpha >= MONO_ALPHA_THRESHOLD) monoFillRect(dev, x1, y1, x2, y2, color);
+	} else if (dev->_use_frame_buffer) {
+		for (int16_t j = y1; j <= y2; j++){
+			rgb565BlendFill(&dev->_frame_buffer[j*dev->_stride+x1], color, x2-x1+1, alpha);
+		}
+	} else if (alpha == BLEND_OPAQUE) {
+		lcdDrawFillRect(dev, x1, y1, x2, y2, color);
+	} else {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+	}
+}
+
+// Clip w*h image at x,y to the screen
+// Return false when nothing is visible
+static bool lcdClipImage(TFT_t * dev, uint16_t x, uint16_t y, uint16_t *w, uint16_t *h) {
+	if (x >= dev->_width) return false;
+	if (y >= dev->_height) return false;
+	if (x + *w > dev->_width) *w = dev->_width - x;
+	if (y + *h > dev->_height) *h = dev->_height - y;
+	return (*w > 0 && *h > 0);
+}
+
+// Draw bitmap with alpha blending
+// x:Start X coordinate
+// y:Start Y coordinate
+// w:Width of bitmap
+// h:Height of bitmap
+// colors:w*h colors
+// alpha:Opacity(0-255)
+void lcdDrawBitmapAlpha(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *colors, uint8_t alpha) {
+	uint16_t _w = w;
+	uint16_t _h = h;
+	if (!lcdClipImage(dev, x, y, &_w, &_h)) return;
+
+	if (dev->_mono) {
+		if (alpha < MONO_ALPHA_THRESHOLD) return;
+		for (int16_t j = 0; j < _h; j++){
+			for (int16_t i = 0; i < _w; i++) monoSetPixel(dev, x+i, y+j, colors[j*w+i]);
+		}
+	} else if (dev->_use_frame_buffer) {
+		for (int16_t j = 0; j < _h; j++){
+			rgb565BlendRow(&dev->_frame_buffer[(y+j)*dev->_stride+x], &colors[j*w], _w, alpha);
+		}
+	} else {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+	}
+}
+
+// Draw solid color through alpha mask
+// Used for anti-aliased edges, shadows and glyphs.
+// x:Start X coordinate
+// y:Start Y coordinate
+// w:Width of mask
+// h:Height of mask
+// mask:Alpha mask, MSB first, each row starts at a byte boundary
+// bpp:Bits per pixel of mask(1/2/4/8)
+// color:color
+void lcdDrawAlphaMask(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *mask, uint8_t bpp, uint16_t color) {
+	uint16_t _w = w;
+	uint16_t _h = h;
+	if (!lcdClipImage(dev, x, y, &_w, &_h)) return;
+
+	if (dev->_mono) {
+		uint16_t stride = (w * bpp + 7) / 8;
+		for (int16_t j = 0; j < _h; j++){
+			for (int16_t i = 0; i < _w; i++) {
+				if (rgb565MaskAlpha(&mask[j*stride], bpp, i) >= MONO_ALPHA_THRESHOLD) monoSetPixel(dev, x+i, y+j, color);
+			}
+		}
+	} else if (dev->_use_frame_buffer) {
+		uint16_t stride = (w * bpp + 7) / 8;
+		for (int16_t j = 0; j < _h; j++){
+			rgb565BlendMask(&dev->_frame_buffer[(y+j)*dev->_stride+x], color, &mask[j*stride], bpp, 0, _w);
+		}
+	} else {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+	}
+}
+
+// Draw bitmap through alpha mask
+// x:Start X coordinate
+// y:Start Y coordinate
+// w:Width of bitmap
+// h:Height of bitmap
+// colors:w*h colors
+// mask:Alpha mask, MSB first, each row starts at a byte boundary
+// bpp:Bits per pixel of mask(1/2/4/8)
+void lcdDrawBitmapMask(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *colors, const uint8_t *mask, uint8_t bpp) {
+	uint16_t _w = w;
+	uint16_t _h = h;
+	if (!lcdClipImage(dev, x, y, &_w, &_h)) return;
+
+	if (dev->_mono) {
+		uint16_t stride = (w * bpp + 7) / 8;
+		for (int16_t j = 0; j < _h; j++){
+			for (int16_t i = 0; i < _w; i++) {
+				if (rgb565MaskAlpha(&mask[j*stride], bpp, i) >= MONO_ALPHA_THRESHOLD) monoSetPixel(dev, x+i, y+j, colors[j*w+i]);
+			}
+		}
+	} else if (dev->_use_frame_buffer) {
+		uint16_t stride = (w * bpp + 7) / 8;
+		for (int16_t j = 0; j < _h; j++){
+			rgb565BlendRowMask(&dev->_frame_buffer[(y+j)*dev->_stride+x], &colors[j*w], &mask[j*stride], bpp, 0, _w);
+		}
+	} else {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+	}
+}
+
 // Draw square of filling
 // x0:Center X coordinate
 // y0:Center Y coordinate
@@ -398,6 +567,169 @@ void lcdFillScreen(TFT_t * dev, uint16_t color) {
 	lcdDrawFillRect(dev, 0, 0, dev->_width-1, dev->_height-1, color);
 }
 
+// Draw horizontal line
+// x1:Start X coordinate
+// x2:End X coordinate
+// y:Y coordinate
+// color:color
+void lcdDrawHLine(TFT_t * dev, uint16_t x1, uint16_t x2, uint16_t y, uint16_t color) {
+	if (dev->_use_frame_buffer && !dev->_mono) {
+		lcdFbHLine(dev->_frame_buffer, dev->_stride, dev->_width, dev->_height, (int16_t)x1, (int16_t)x2, (int16_t)y, color);
+		return;
+	}
+	int _x1 = (int16_t)x1;
+	int _x2 = (int16_t)x2;
+	int _y = (int16_t)y;
+	if (_x1 > _x2) {
+		int temp = _x1; _x1 = _x2; _x2 = temp;
+	}
+	if (_y < 0 || _y >= dev->_height) return;
+	if (_x1 < 0) _x1 = 0;
+	if (_x2 >= dev->_width) _x2 = dev->_width-1;
+	if (_x1 > _x2) return;
+
+	if (dev->_mono) {
+		monoFillRect(dev, _x1, _y, _x2, _y, color);
+	} else {
+		lcdDrawFillRect(dev, _x1, _y, _x2, _y, color);
+	}
+}
+
+// Draw vertical line
+// x:X coordinate
+// y1:Start Y coordinate
+// y2:End Y coordinate
+// color:color
+void lcdDrawVLine(TFT_t * dev, uint16_t x, uint16_t y1, uint16_t y2, uint16_t color) {
+	if (dev->_use_frame_buffer && !dev->_mono) {
+		lcdFbVLine(dev->_frame_buffer, dev->_stride, dev->_width, dev->_height, (int16_t)x, (int16_t)y1, (int16_t)y2, color);
+		return;
+	}
+	int _x = (int16_t)x;
+	int _y1 = (int16_t)y1;
+	int _y2 = (int16_t)y2;
+	if (_y1 > _y2) {
+		int temp = _y1; _y1 = _y2; _y2 = temp;
+	}
+	if (_x < 0 || _x >= dev->_width) return;
+	if (_y1 < 0) _y1 = 0;
+	if (_y2 >= dev->_height) _y2 = dev->_height-1;
+	if (_y1 > _y2) return;
+
+	if (dev->_mono) {
+		monoFillRect(dev, _x, _y1, _x, _y2, color);
+	} else {
+		lcdDrawFillRect(dev, _x, _y1, _x, _y2, color);
+	}
+}
+
+// Range of Bresenham steps whose minor offset lies in [a, b]
+// After k steps along the major axis, the minor offset is
+// m(k) = floor((2*dmin*k + dmaj) / (2*dmaj)).
+static void lcdLineSteps(int dmaj, int dmin, int a, int b, int *k0, int *k1) {
+	if (dmin == 0) {
+		if (a > 0 || b < 0) *k1 = -1;
+		return;
+	}
+	if (a > 0) {
+		int k = (2*dmaj*a - dmaj + 2*dmin - 1) / (2*dmin);
+		if (k > *k0) *k0 = k;
+	}
+	if (b < 0) {
+		*k1 = -1;
+	} else {
+		int k = (2*dmaj*(b+1) - dmaj - 1) / (2*dmin);
+		if (k < *k1) *k1 = k;
+	}
+}
+
+// Range of steps whose coordinate p+s*k lies in [0, size-1]
+static void lcdAxisSteps(int p, int s, int size, int *k0, int *k1) {
+	int a = (s > 0) ? -p : p - (size-1);
+	int b = (s > 0) ? (size-1) - p : p;
+	if (a > *k0) *k0 = a;
+	if (b < *k1) *k1 = b;
+}
+
+// Write one pixel of a line
+// p:Pixel index, or bit index in a mono frame buffer
+FORCE_INLINE_ATTR void lcdLinePixel(TFT_t * dev, bool mono, int p, uint16_t color) {
+	if (mono) {
+		uint8_t bit = 0x80 >> (p & 7);
+		if (color != dev->_mono_bg) {
+			dev->_mono_buffer[p >> 3] |= bit;
+		} else {
+			dev->_mono_buffer[p >> 3] &= ~bit;
+		}
+	} else {
+		dev->_frame_buffer[p] = color;
+	}
+}
+
+// Draw line in frame buffer
+// The line is clipped once, then drawn by walking a frame buffer index.
+// stride:Row length in pixels, or in bits for a mono frame buffer
+FORCE_INLINE_ATTR void lcdFbLine(TFT_t * dev, bool mono, int stride, int width, int height, int x1, int y1, int x2, int y2, uint16_t color) {
+	int dx = (x2 > x1) ? x2 - x1 : x1 - x2;
+	int dy = (y2 > y1) ? y2 - y1 : y1 - y2;
+	int sx = (x2 > x1) ? 1 : -1;
+	int sy = (y2 > y1) ? 1 : -1;
+
+	// Major axis steps and minor axis offsets
+	int dmaj, dmin, k0, k1;
+	int step_maj, step_min;
+	if (dx >= dy) {
+		dmaj = dx; dmin = dy;
+		k0 = 0; k1 = dx;
+		lcdAxisSteps(x1, sx, width, &k0, &k1);
+		if (sy > 0) {
+			lcdLineSteps(dx, dy, -y1, height-1-y1, &k0, &k1);
+		} else {
+			lcdLineSteps(dx, dy, y1-(height-1), y1, &k0, &k1);
+		}
+		step_maj = sx;
+		step_min = sy * stride;
+	} else {
+		dmaj = dy; dmin = dx;
+		k0 = 0; k1 = dy;
+		lcdAxisSteps(y1, sy, height, &k0, &k1);
+		if (sx > 0) {
+			lcdLineSteps(dy, dx, -x1, width-1-x1, &k0, &k1);
+		} else {
+			lcdLineSteps(dy, dx, x1-(width-1), x1, &k0, &k1);
+		}
+		step_maj = sy * stride;
+		step_min = sx;
+	}
+	if (k0 > k1) return;
+
+	// Bresenham state after k0 steps
+	int m = (2*dmin*k0 + dmaj) / (2*dmaj);
+	int E = -dmaj + 2*dmin*k0 - 2*dmaj*m;
+	int x = (dx >= dy) ? x1 + sx*k0 : x1 + sx*m;
+	int y = (dx >= dy) ? y1 + sy*m : y1 + sy*k0;
+	int p = y*stride+x;
+
+	if (dmaj == dmin) {
+		// 45 degree
+		int step = step_maj + step_min;
+		for (int k = k0; k <= k1; k++) {
+			lcdLinePixel(dev, mono, p, color);
+			p += step;
+		}
+		return;
+	}
+	for (int k = k0; k <= k1; k++) {
+		lcdLinePixel(dev, mono, p, color);
+		p += step_maj;
+		E += 2 * dmin;
+		if (E >= 0) {
+			p += step_min;
+			E -= 2 * dmaj;
+		}
+	}
+}
+
 // Draw line
 // x1:Start X coordinate
 // y1:Start Y coordinate
@@ -405,6 +737,20 @@ void lcdFillScreen(TFT_t * dev, uint16_t color) {
 // y2:End	Y coordinate
 // color:color 
 void lcdDrawLine(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+	if (y1 == y2) {
+		lcdDrawHLine(dev, x1, x2, y1, color);
+		return;
+	}
+	if (x1 == x2) {
+		lcdDrawVLine(dev, x1, y1, y2, color);
+		return;
+	}
+	if (dev->_use_frame_buffer) {
+		int stride = dev->_mono ? dev->_mono_stride * 8 : dev->_stride;
+		lcdFbLine(dev, dev->_mono, stride, dev->_width, dev->_height, (int16_t)x1, (int16_t)y1, (int16_t)x2, (int16_t)y2, color);
+		return;
+	}
+
 	int i;
 	int dx,dy;
 	int sx,sy;
@@ -453,10 +799,10 @@ void lcdDrawLine(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2
 // y2:End	Y coordinate
 // color:color
 void lcdDrawRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
-	lcdDrawLine(dev, x1, y1, x2, y1, color);
-	lcdDrawLine(dev, x2, y1, x2, y2, color);
-	lcdDrawLine(dev, x2, y2, x1, y2, color);
-	lcdDrawLine(dev, x1, y2, x1, y1, color);
+	lcdDrawHLine(dev, x1, x2, y1, color);
+	lcdDrawVLine(dev, x2, y1, y2, color);
+	lcdDrawHLine(dev, x2, x1, y2, color);
+	lcdDrawVLine(dev, x1, y2, y1, color);
 }
 
 // Draw rectangle with angle
@@ -739,22 +1085,546 @@ void lcdDrawFillArrow(TFT_t * dev, uint16_t x0,uint16_t y0,uint16_t x1,uint16_t
 }
 
 
+// Pixel masks of a glyph byte, MSB left
+#define GLYPH_BIT(b, i) ((((b) >> (7 - (i))) & 1) ? 0xFFFF : 0x0000)
+#define GLYPH_MASK1(b) { GLYPH_BIT(b, 0), GLYPH_BIT(b, 1), GLYPH_BIT(b, 2), GLYPH_BIT(b, 3), \
+	GLYPH_BIT(b, 4), GLYPH_BIT(b, 5), GLYPH_BIT(b, 6), GLYPH_BIT(b, 7) }
+#define GLYPH_MASK4(b) GLYPH_MASK1(b), GLYPH_MASK1((b) + 1), GLYPH_MASK1((b) + 2), GLYPH_MASK1((b) + 3)
+#define GLYPH_MASK16(b) GLYPH_MASK4(b), GLYPH_MASK4((b) + 4), GLYPH_MASK4((b) + 8), GLYPH_MASK4((b) + 12)
+#define GLYPH_MASK64(b) GLYPH_MASK16(b), GLYPH_MASK16((b) + 16), GLYPH_MASK16((b) + 32), GLYPH_MASK16((b) + 48)
+
+static const uint16_t glyph_mask[256][8] = {
+	GLYPH_MASK64(0), GLYPH_MASK64(64), GLYPH_MASK64(128), GLYPH_MASK64(192)
+};
+
+// Pixels of a glyph window composed at a time in direct mode
+#define GLYPH_WINDOW_MAX 512
+
+// Expand glyph row to pixels, 8 pixels per font byte
+// Clear bits take bg, or keep the pixel in line when transparent.
+static void lcdGlyphExpand(uint16_t *line, const uint8_t *row, uint8_t pw, uint16_t color, uint16_t bg, bool transparent) {
+	int k = 0;
+	if (transparent) {
+		for (; k + 8 <= pw; k += 8) {
+			const uint16_t *m = glyph_mask[row[k >> 3]];
+			uint16_t *p = &line[k];
+			for (int i = 0; i < 8; i++) p[i] = (color & m[i]) | (p[i] & ~m[i]);
+		}
+		if (k == pw) return;
+		const uint16_t *m = glyph_mask[row[k >> 3]];
+		for (int i = 0; k + i < pw; i++) line[k + i] = (color & m[i]) | (line[k + i] & ~m[i]);
+	} else {
+		for (; k + 8 <= pw; k += 8) {
+			const uint16_t *m = glyph_mask[row[k >> 3]];
+			uint16_t *p = &line[k];
+			for (int i = 0; i < 8; i++) p[i] = (color & m[i]) | (bg & ~m[i]);
+		}
+		if (k == pw) return;
+		const uint16_t *m = glyph_mask[row[k >> 3]];
+		for (int i = 0; k + i < pw; i++) line[k + i] = (color & m[i]) | (bg & ~m[i]);
+	}
+}
+
+// Screen position of bit 0 of glyph row h and the step between bits
+// Same placement as the bit loop of lcdDrawGlyph.
+static void lcdGlyphOrigin(TFT_t * dev, uint16_t x, uint16_t y, uint8_t ph, int h, int *gx, int *gy, int *dx, int *dy) {
+	switch (dev->_font_direction) {
+	case DIRECTION180:
+		*gx = (int16_t)x;
+		*gy = (int16_t)(y + ph + 1 - h);
+		*dx = -1;
+		*dy = 0;
+		break;
+	case DIRECTION90:
+		*gx = (int16_t)(x + ph - h);
+		*gy = (int16_t)y;
+		*dx = 0;
+		*dy = 1;
+		break;
+	case DIRECTION270:
+		*gx = (int16_t)(x - (ph - 1) + h);
+		*gy = (int16_t)y;
+		*dx = 0;
+		*dy = -1;
+		break;
+	default:
+		*gx = (int16_t)x;
+		*gy = (int16_t)(y - (ph - 1) + h);
+		*dx = 1;
+		*dy = 0;
+		break;
+	}
+}
+
+// Bits i0..i1-1 of a glyph row that fall on the screen
+static bool lcdGlyphClip(TFT_t * dev, int gx, int gy, int dx, int dy, uint8_t pw, int *i0, int *i1) {
+	int lo = 0, hi = pw;
+	int p = dx ? gx : gy;
+	int d = dx ? dx : dy;
+	int size = dx ? dev->_width : dev->_height;
+	if ((dx ? gy : gx) < 0 || (dx ? gy : gx) >= (dx ? dev->_height : dev->_width)) return false;
+	if (d > 0) {
+		if (p < 0) lo = -p;
+		if (p + hi > size) hi = size - p;
+	} else {
+		if (p >= size) lo = p - size + 1;
+		if (p - hi + 1 < 0) hi = p + 1;
+	}
+	*i0 = lo;
+	*i1 = hi;
+	return lo < hi;
+}
+
+// Draw set bits, or all bits of an underline row, as runs
+// ex,ey:Offset of the last of identical rows drawn together, 0 for one row
+static void lcdGlyphRuns(TFT_t * dev, const uint8_t *row, int gx, int gy, int dx, int dy, int i0, int i1, uint16_t color, bool solid, int ex, int ey) {
+	int start = -1;
+	for (int i = i0; i <= i1; i++) {
+		bool on = (i < i1) && (solid || (row[i >> 3] & (0x80 >> (i & 7))));
+		if (on && start < 0) start = i;
+		if (!on && start >= 0) {
+			int ax = gx + start * dx, ay = gy + start * dy;
+			int bx = gx + (i - 1) * dx + ex, by = gy + (i - 1) * dy + ey;
+			lcdDrawFillRect(dev, ax < bx ? ax : bx, ay < by ? ay : by, ax < bx ? bx : ax, ay < by ? by : ay, color);
+			start = -1;
+		}
+	}
+}
+
+// Draw glyph a row at a time with fill, underline and foreground merged
+// In the frame buffer each row is expanded through glyph_mask and written
+// once. In direct mode a filled cell goes out as one window, transparent
+// rows as runs of set bits.
+// x0,y0,x1,y1:Fill box of lcdDrawGlyph
+// Return false when the caller has to draw bit by bit
+static bool lcdGlyphRows(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, uint16_t y,
+		int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	if (pw == 0 || ph == 0) return false;
+	uint16_t bpr = (pw + 7) / 8;
+	bool fill = dev->_font_fill;
+	bool underline = dev->_font_underline;
+	uint16_t direction = dev->_font_direction;
+
+	// Glyph rows outside the fill box, and fill box pixels outside the glyph
+	int h_fill = 0;
+	if (direction == DIRECTION90) {
+		h_fill = 1;
+		if (fill) lcdDrawFillRect(dev, x0, y0, x0, y1, dev->_font_fill_color);
+	} else if (direction == DIRECTION180) {
+		h_fill = 2;
+		if (fill) lcdDrawFillRect(dev, x0, y0, x1, (y0 + 1 < y1) ? y0 + 1 : y1, dev->_font_fill_color);
+	}
+
+	if (dev->_use_frame_buffer) {
+		uint16_t line[pw];
+		for (int h = 0; h < ph; h++) {
+			int gx, gy, dx, dy, i0, i1;
+			lcdGlyphOrigin(dev, x, y, ph, h, &gx, &gy, &dx, &dy);
+			if (!lcdGlyphClip(dev, gx, gy, dx, dy, pw, &i0, &i1)) continue;
+			int step = dx + dy * dev->_stride;
+			uint16_t *p = &dev->_frame_buffer[gy * dev->_stride + gx];
+			bool transparent = !fill || h < h_fill;
+			if (underline && h >= ph - 2) {
+				for (int i = i0; i < i1; i++) p[i * step] = dev->_font_underline_color;
+				continue;
+			}
+			if (step == 1 && i0 == 0 && i1 == pw) {
+				// Whole row on the screen, expand in place
+				lcdGlyphExpand(p, &fonts[h * bpr], pw, color, dev->_font_fill_color, transparent);
+				continue;
+			}
+			if (transparent) {
+				for (int i = i0; i < i1; i++) line[i] = p[i * step];
+			}
+			lcdGlyphExpand(line, &fonts[h * bpr], pw, color, dev->_font_fill_color, transparent);
+			if (step == 1) {
+				memcpy(&p[i0], &line[i0], (i1 - i0) * sizeof(uint16_t));
+			} else {
+				for (int i = i0; i < i1; i++) p[i * step] = line[i];
+			}
+		}
+		return true;
+	}
+
+	// Direct mode
+	int wx1 = x0, wy1 = y0, wx2 = x1, wy2 = y1;
+	if (direction == DIRECTION90) wx1++;
+	if (direction == DIRECTION180) wy1 += 2;
+	if (wx1 < 0) wx1 = 0;
+	if (wy1 < 0) wy1 = 0;
+	if (wx2 >= dev->_width) wx2 = dev->_width - 1;
+	if (wy2 >= dev->_height) wy2 = dev->_height - 1;
+	int ww = wx2 - wx1 + 1;
+	int wh = wy2 - wy1 + 1;
+	bool window = fill && ww > 0 && wh > 0;
+	uint16_t line[pw];
+	int h_runs = window ? h_fill : ph;
+	for (int h = 0; h < h_runs; h++) {
+		int gx, gy, dx, dy, i0, i1;
+		lcdGlyphOrigin(dev, x, y, ph, h, &gx, &gy, &dx, &dy);
+		if (!lcdGlyphClip(dev, gx, gy, dx, dy, pw, &i0, &i1)) continue;
+		bool solid = underline && h >= ph - 2;
+		// Identical rows next to it go into the same rectangles
+		int m = 1, ex = 0, ey = 0;
+		while (h + m < h_runs) {
+			int nx, ny, ndx, ndy, n0, n1;
+			bool next_solid = underline && h + m >= ph - 2;
+			if (next_solid != solid) break;
+			if (!solid && memcmp(&fonts[(h + m) * bpr], &fonts[h * bpr], bpr) != 0) break;
+			lcdGlyphOrigin(dev, x, y, ph, h + m, &nx, &ny, &ndx, &ndy);
+			if (!lcdGlyphClip(dev, nx, ny, ndx, ndy, pw, &n0, &n1) || n0 != i0 || n1 != i1) break;
+			ex = nx - gx;
+			ey = ny - gy;
+			m++;
+		}
+		lcdGlyphRuns(dev, &fonts[h * bpr], gx, gy, dx, dy, i0, i1, solid ? dev->_font_underline_color : color, solid, ex, ey);
+		h += m - 1;
+	}
+	if (!window) return true;
+
+	// Filled cell as one window, composed GLYPH_WINDOW_MAX pixels at a time
+	uint16_t cell[GLYPH_WINDOW_MAX];
+	int rows = GLYPH_WINDOW_MAX / ww;
+	spi_master_write_command(dev, 0x2A);	// set column(x) address
+	spi_master_write_addr(dev, wx1 + dev->_offsetx, wx2 + dev->_offsetx);
+	spi_master_write_command(dev, 0x2B);	// set Page(y) address
+	spi_master_write_addr(dev, wy1 + dev->_offsety, wy2 + dev->_offsety);
+	spi_master_write_command(dev, 0x2C);	// Memory Write
+	for (int cy = wy1; cy <= wy2; cy += rows) {
+		int n = (wy2 - cy + 1 < rows) ? wy2 - cy + 1 : rows;
+		for (int h = h_fill; h < ph; h++) {
+			int gx, gy, dx, dy, i0, i1;
+			lcdGlyphOrigin(dev, x, y, ph, h, &gx, &gy, &dx, &dy);
+			if (dy == 0 && (gy < cy || gy >= cy + n)) continue;
+			if (!lcdGlyphClip(dev, gx, gy, dx, dy, pw, &i0, &i1)) continue;
+			if (underline && h >= ph - 2) {
+				for (int i = i0; i < i1; i++) line[i] = dev->_font_underline_color;
+			} else {
+				lcdGlyphExpand(line, &fonts[h * bpr], pw, color, dev->_font_fill_color, false);
+			}
+			for (int i = i0; i < i1; i++) {
+				int py = gy + i * dy;
+				if (py < cy || py >= cy + n) continue;
+				cell[(py - cy) * ww + (gx + i * dx - wx1)] = line[i];
+			}
+		}
+		spi_master_write_colors(dev, cell, n * ww);
+	}
+	return true;
+}
+
+// Draw glyph turned by TurnBitmap for DIRECTION90 and DIRECTION270
+// Rows of the turned glyph are screen rows, so they are expanded and
+// sent like DIRECTION0 instead of a pixel per step down a column.
+// Same pixels as the bit loop of lcdDrawGlyph.
+// turned:ph bits wide and pw rows high
+// pw,ph:Size of the glyph before the turn
+static void lcdGlyphTurned(TFT_t * dev, const uint8_t *turned, uint8_t pw, uint8_t ph, uint16_t x, uint16_t y, uint16_t color) {
+	if (pw == 0 || ph == 0) return;
+	uint16_t bpr = (ph + 7) / 8;
+	bool fill = dev->_font_fill;
+	int left, top, opaque, u0, u1;
+	if (dev->_font_direction == DIRECTION90) {
+		// One column right of the fill box, the last column is outside it
+		left = (int16_t)(x + 1);
+		top = (int16_t)y;
+		opaque = ph - 1;
+		u0 = 0;
+	} else {
+		left = (int16_t)(x - (ph - 1));
+		top = (int16_t)(y - (pw - 1));
+		opaque = ph;
+		u0 = ph - 2;
+	}
+	// Underline rows of the glyph are columns of the turned glyph
+	u1 = dev->_font_underline ? u0 + 2 : u0;
+	if (u0 < 0) u0 = 0;
+	if (u1 > ph) u1 = ph;
+	int c0 = (left < 0) ? -left : 0;
+	int c1 = (left + ph > dev->_width) ? dev->_width - left : ph;
+	int j0 = (top < 0) ? -top : 0;
+	int j1 = (top + pw > dev->_height) ? dev->_height - top : pw;
+
+	if (dev->_mono) {
+		if (fill) lcdDrawFillRect(dev, (dev->_font_direction == DIRECTION90) ? x : left, top, left + opaque - 1, top + pw - 1, dev->_font_fill_color);
+		if (left < 0 || !monoDrawGlyph(dev, turned, ph, pw, left, top, color)) {
+			for (int j = j0; j < j1; j++) {
+				for (int k = c0; k < c1; k++) {
+					if (turned[j * bpr + (k >> 3)] & (0x80 >> (k & 7))) lcdDrawPixel(dev, left + k, top + j, color);
+				}
+			}
+		}
+		if (u0 < u1) lcdDrawFillRect(dev, left + u0, top, left + u1 - 1, top + pw - 1, dev->_font_underline_color);
+		return;
+	}
+	if (fill && dev->_font_direction == DIRECTION90) lcdDrawFillRect(dev, x, y, x, y + pw - 1, dev->_font_fill_color);
+	if (c0 >= c1 || j0 >= j1) return;
+
+	uint16_t line[ph];
+	if (dev->_use_frame_buffer) {
+		for (int j = j0; j < j1; j++) {
+			const uint8_t *row = &turned[j * bpr];
+			uint16_t *p = &dev->_frame_buffer[(top + j) * dev->_stride + left];
+			if (fill && opaque == ph && u0 == u1 && c0 == 0 && c1 == ph) {
+				lcdGlyphExpand(p, row, ph, color, dev->_font_fill_color, false);
+				continue;
+			}
+			if (fill) {
+				lcdGlyphExpand(line, row, opaque, color, dev->_font_fill_color, false);
+				for (int k = (opaque > c0) ? opaque : c0; k < c1; k++) {
+					line[k] = (row[k >> 3] & (0x80 >> (k & 7))) ? color : p[k];
+				}
+			} else {
+				for (int k = c0; k < c1; k++) line[k] = p[k];
+				lcdGlyphExpand(line, row, ph, color, dev->_font_fill_color, true);
+			}
+			for (int k = u0; k < u1; k++) line[k] = dev->_font_underline_color;
+			memcpy(&p[c0], &line[c0], (c1 - c0) * sizeof(uint16_t));
+		}
+		return;
+	}
+
+	// Direct mode
+	if (!fill) {
+		for (int j = j0; j < j1; j++) {
+			int m = 1;
+			while (j + m < j1 && memcmp(&turned[(j + m) * bpr], &turned[j * bpr], bpr) == 0) m++;
+			lcdGlyphRuns(dev, &turned[j * bpr], left, top + j, 1, 0, c0, c1, color, false, 0, m - 1);
+			j += m - 1;
+		}
+		if (u0 < u1) lcdDrawFillRect(dev, left + u0, top, left + u1 - 1, top + pw - 1, dev->_font_underline_color);
+		return;
+	}
+	// Filled columns as one window, rows streamed in chunks
+	int w1 = (c1 < opaque) ? c1 : opaque;
+	if (c0 < w1) {
+		int ww = w1 - c0;
+		int rows = GLYPH_WINDOW_MAX / ww;
+		uint16_t cell[GLYPH_WINDOW_MAX];
+		spi_master_write_command(dev, 0x2A);	// set column(x) address
+		spi_master_write_addr(dev, left + c0 + dev->_offsetx, left + w1 - 1 + dev->_offsetx);
+		spi_master_write_command(dev, 0x2B);	// set Page(y) address
+		spi_master_write_addr(dev, top + j0 + dev->_offsety, top + j1 - 1 + dev->_offsety);
+		spi_master_write_command(dev, 0x2C);	// Memory Write
+		for (int j = j0; j < j1; j += rows) {
+			int n = (j1 - j < rows) ? j1 - j : rows;
+			for (int k = 0; k < n; k++) {
+				lcdGlyphExpand(line, &turned[(j + k) * bpr], ph, color, dev->_font_fill_color, false);
+				for (int i = u0; i < u1; i++) line[i] = dev->_font_underline_color;
+				memcpy(&cell[k * ww], &line[c0], ww * sizeof(uint16_t));
+			}
+			spi_master_write_colors(dev, cell, n * ww);
+		}
+	}
+	// Columns outside the fill box, as runs down the column
+	for (int k = (opaque > c0) ? opaque : c0; k < c1; k++) {
+		bool solid = (k >= u0 && k < u1);
+		uint16_t fg = solid ? dev->_font_underline_color : color;
+		int start = -1;
+		for (int j = j0; j <= j1; j++) {
+			bool on = (j < j1) && (solid || (turned[j * bpr + (k >> 3)] & (0x80 >> (k & 7))));
+			if (on && start < 0) start = j;
+			if (!on && start >= 0) {
+				lcdDrawFillRect(dev, left + k, top + start, left + k, top + j - 1, fg);
+				start = -1;
+			}
+		}
+	}
+}
+
+// Next position after a glyph drawn by lcdDrawGlyph
+static int lcdGlyphNext(TFT_t * dev, uint8_t pw, uint16_t x, uint16_t y) {
+	int16_t next = 0;
+	if (dev->_font_direction == DIRECTION0) next = x + pw;
+	if (dev->_font_direction == DIRECTION180) next = x - pw;
+	if (dev->_font_direction == DIRECTION90) next = y + pw;
+	if (dev->_font_direction == DIRECTION270) next = y - pw;
+	if (next < 0) next = 0;
+	return next;
+}
+
+static int lcdGlyphDraw(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, uint16_t y, uint16_t color, bool exact);
+
+// Bit i of a glyph row, clear outside the glyph
+static bool lcdGlyphBit(const uint8_t *fonts, uint16_t bpr, uint8_t pw, uint8_t ph, int i, int h) {
+	if (i < 0 || i >= pw || h < 0 || h >= ph) return false;
+	return fonts[h * bpr + (i >> 3)] & (0x80 >> (i & 7));
+}
+
+// Set or clear n bits of a glyph row from bit i
+static void lcdGlyphSetBits(uint8_t *row, int i, int n, bool on) {
+	for (; n > 0; i++, n--) {
+		if (on) {
+			row[i >> 3] |= 0x80 >> (i & 7);
+		} else {
+			row[i >> 3] &= ~(0x80 >> (i & 7));
+		}
+	}
+}
+
+// Scale glyph pattern by an integer factor
+// A source row is widened once and copied to the rows of its blocks.
+// With smooth, a block corner between two agreeing neighbours that the
+// other two neighbours do not share takes their color, as in EPX
+// (Scale2x). The corner is the pixels nearer to it than the block center.
+// scaled:(pw*scale+7)/8 bytes per row, ph*scale rows
+static void lcdGlyphScale(const uint8_t *fonts, uint8_t pw, uint8_t ph, uint8_t scale, bool smooth, uint8_t *scaled) {
+	uint16_t bpr = (pw + 7) / 8;
+	uint16_t sbpr = (pw * scale + 7) / 8;
+	for (int h = 0; h < ph; h++) {
+		uint8_t *out = &scaled[h * scale * sbpr];
+		// Each source byte widens to scale bytes
+		for (int k = 0; k < bpr; k++) {
+			uint8_t b = fonts[h * bpr + k];
+			if (pw - k * 8 < 8) b &= 0xFF << (8 - (pw - k * 8));
+			uint32_t wide = 0;
+			for (int i = 0; i < 8; i++) {
+				wide = (wide << scale) | ((b & (0x80 >> i)) ? (1u << scale) - 1 : 0);
+			}
+			for (int q = 0; q < scale && k * scale + q < sbpr; q++) {
+				out[k * scale + q] = wide >> (8 * (scale - 1 - q));
+			}
+		}
+		for (int v = 1; v < scale; v++) memcpy(&out[v * sbpr], out, sbpr);
+		if (!smooth) continue;
+		for (int i = 0; i < pw; i++) {
+			bool p = lcdGlyphBit(fonts, bpr, pw, ph, i, h);
+			bool u = lcdGlyphBit(fonts, bpr, pw, ph, i, h - 1);
+			bool d = lcdGlyphBit(fonts, bpr, pw, ph, i, h + 1);
+			bool l = lcdGlyphBit(fonts, bpr, pw, ph, i - 1, h);
+			bool r = lcdGlyphBit(fonts, bpr, pw, ph, i + 1, h);
+			// Top left, top right, bottom left, bottom right
+			bool corner[4] = {
+				u == l && u != d && u != r && u != p,
+				u == r && u != l && u != d && u != p,
+				d == l && d != r && d != u && d != p,
+				d == r && d != l && d != u && d != p,
+			};
+			for (int c = 0; c < 4; c++) {
+				if (!corner[c]) continue;
+				for (int b = 0; 2 * b + 2 <= scale; b++) {
+					int n = scale / 2 - b;	// Pixels with 2 * (a + b) + 2 <= scale
+					int sy = h * scale + ((c < 2) ? b : scale - 1 - b);
+					int sx = i * scale + ((c & 1) ? scale - n : 0);
+					lcdGlyphSetBits(&scaled[sy * sbpr], sx, n, !p);
+				}
+			}
+		}
+	}
+}
+
+// Scale of a pw*ph glyph
+// lcdSetFontScale, lowered until the glyph fits in 255*255
+uint8_t lcdGetFontScale(TFT_t * dev, uint8_t pw, uint8_t ph) {
+	uint8_t scale = dev->_font_scale;
+	while (scale > 1 && (pw * scale > 255 || ph * scale > 255)) scale--;
+	return scale;
+}
+
+// Scale glyph pattern into the buffer of TFT_t
+// pw:Glyph width, scaled width on return
+// ph:Glyph height, scaled height on return
+static const uint8_t *lcdScaledPattern(TFT_t * dev, const uint8_t *fonts, uint8_t *pw, uint8_t *ph) {
+	uint8_t scale = lcdGetFontScale(dev, *pw, *ph);
+	uint8_t sw = *pw * scale;
+	uint8_t sh = *ph * scale;
+	uint16_t size = (sw + 7) / 8 * sh;
+	if (size > dev->_font_scaled_size) {
+		uint8_t *scaled = realloc(dev->_font_scaled, size);
+		if (scaled == NULL) {
+			ESP_LOGE(TAG, "Error allocating scaled glyph.");
+			return NULL;
+		}
+		dev->_font_scaled = scaled;
+		dev->_font_scaled_size = size;
+	}
+	lcdGlyphScale(fonts, *pw, *ph, scale, dev->_font_smooth, dev->_font_scaled);
+	*pw = sw;
+	*ph = sh;
+	return dev->_font_scaled;
+}
+
+// Read glyph as lcdDrawChar draws it, scaled by lcdSetFontScale
+// The pattern is valid until the next character is drawn.
+// pw:Glyph width
+// ph:Glyph height
+// Returns the pattern, (pw + 7) / 8 bytes per row, or NULL
+const uint8_t *lcdGetScaledGlyph(TFT_t * dev, FontxFile *fxs, uint16_t code, uint8_t *pw, uint8_t *ph) {
+	if (!GetFontxCode(fxs, code, pw, ph)) return NULL;
+	if (dev->_font_scale <= 1) return fxs->fonts;
+	return lcdScaledPattern(dev, fxs->fonts, pw, ph);
+}
+
+// Draw character scaled by lcdSetFontScale
+// Returns the next position, or -1 when the character is drawn unscaled
+static int lcdDrawScaledCode(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint16_t code, uint16_t color) {
+	if (dev->_font_scale <= 1) return -1;
+	uint8_t pw, ph;
+	bool turned = dev->_font_direction == DIRECTION90 || dev->_font_direction == DIRECTION270;
+	// Vertical text scales the turned glyph
+	if (!turned || !GetFontxTurned(fxs, code, dev->_font_direction, &pw, &ph)) {
+		turned = false;
+		if (!GetFontxCode(fxs, code, &pw, &ph)) return 0;
+	}
+	const uint8_t *scaled = lcdScaledPattern(dev, fxs->fonts, &pw, &ph);
+	if (scaled == NULL) return -1;
+	if (turned) {
+		lcdGlyphTurned(dev, scaled, ph, pw, x, y, color);
+		return lcdGlyphNext(dev, ph, x, y);
+	}
+	return lcdGlyphDraw(dev, scaled, pw, ph, x, y, color, true);
+}
+
+// Draw character from the turned glyph cache of the font
+// Returns the next position, or -1 when the glyph has to be drawn unturned
+static int lcdDrawTurnedCode(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint16_t code, uint16_t color) {
+	uint8_t tw, th;
+	if (dev->_font_direction != DIRECTION90 && dev->_font_direction != DIRECTION270) return -1;
+	if (!GetFontxTurned(fxs, code, dev->_font_direction, &tw, &th)) return -1;
+	if ((th + 4) / 8 != (th + 7) / 8) return -1;
+	lcdGlyphTurned(dev, fxs->fonts, th, tw, x, y, color);
+	return lcdGlyphNext(dev, th, x, y);
+}
+
 // Draw ASCII character
 // x:X coordinate
 // y:Y coordinate
 // ascii: ascii code
 // color:color
 int lcdDrawChar(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint8_t ascii, uint16_t color) {
-	uint16_t xx,yy,bit,ofs;
 	unsigned char pw, ph;
-	int h,w;
-	uint16_t mask;
 	bool rc;
 
 	if(_DEBUG_)printf("_font_direction=%d\n",dev->_font_direction);
+	int next = lcdDrawScaledCode(dev, fxs, x, y, ascii, color);
+	if (next < 0) next = lcdDrawTurnedCode(dev, fxs, x, y, ascii, color);
+	if (next >= 0) return next;
 	rc = GetFontx(fxs, ascii, &pw, &ph);
 	if(_DEBUG_)printf("GetFontx rc=%d pw=%d ph=%d\n",rc,pw,ph);
 	if (!rc) return 0;
+	return lcdDrawGlyph(dev, fxs->fonts, pw, ph, x, y, color);
+}
+
+// Draw glyph bitmap
+// Same as lcdDrawChar with a glyph already read from the font.
+// fonts:FONTX glyph pattern
+// pw:Glyph width
+// ph:Glyph height
+// x:X coordinate
+// y:Y coordinate
+// color:color
+int lcdDrawGlyph(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, uint16_t y, uint16_t color) {
+	return lcdGlyphDraw(dev, fonts, pw, ph, x, y, color, false);
+}
+
+// Draw glyph bitmap
+// The bit loop reads (pw+4)/8 bytes of each row, as it always has, and
+// widths it gets wrong skip the row paths to keep their look. exact reads
+// whole rows and takes the row paths for any width.
+static int lcdGlyphDraw(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, uint16_t y, uint16_t color, bool exact) {
+	uint16_t xx,yy,bit,ofs;
+	int h,w;
+	uint16_t mask;
 
 	int16_t xd1 = 0;
 	int16_t yd1 = 0;
@@ -831,8 +1701,33 @@ int lcdDrawChar(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint8_t asc
 		y1	= y;
 	}
 
+	// Turned rows through the mask table like DIRECTION0
+	bool rows = exact || (pw + 4) / 8 == (pw + 7) / 8;
+	if ((dev->_font_direction == DIRECTION90 || dev->_font_direction == DIRECTION270) && rows && !exact) {
+		uint8_t turned[(ph + 7) / 8 * pw];
+		TurnBitmap(fonts, pw, ph, dev->_font_direction, turned);
+		lcdGlyphTurned(dev, turned, pw, ph, x, y, color);
+		if (next < 0) next = 0;
+		return next;
+	}
+
+	// Whole rows through the mask table in RGB565
+	if (!dev->_mono && rows &&
+		lcdGlyphRows(dev, fonts, pw, ph, x, y, x0, y0, x1, y1, color)) {
+		if (next < 0) next = 0;
+		return next;
+	}
+
 	if (dev->_font_fill) lcdDrawFillRect(dev, x0, y0, x1, y1, dev->_font_fill_color);
 
+	// Glyph rows are 1 bpp already and go straight into a mono frame buffer
+	if (dev->_mono && dev->_font_direction == DIRECTION0 &&
+		monoDrawGlyph(dev, fonts, pw, ph, x, (int16_t)y - (ph - 1), color)) {
+		if (dev->_font_underline) lcdDrawFillRect(dev, x, y - 1, x + pw - 1, y, dev->_font_underline_color);
+		if (next < 0) next = 0;
+		return next;
+	}
+
 	int bits;
 	if(_DEBUG_)printf("xss=%d yss=%d\n",xss,yss);
 	ofs = 0;
@@ -843,13 +1738,13 @@ int lcdDrawChar(TFT_t * dev, FontxFile *fxs, uint16_t x, uint16_t y, uint8_t asc
 		if(ysd) yy = yss;
 		//for(w=0;w<(pw/8);w++) {
 		bits = pw;
-		for(w=0;w<((pw+4)/8);w++) {
+		for(w=0;w<(exact ? (pw+7)/8 : (pw+4)/8);w++) {
 			mask = 0x80;
 			for(bit=0;bit<8;bit++) {
 				bits--;
 				if (bits < 0) continue;
-				//if(_DEBUG_)printf("xx=%d yy=%d mask=%02x fonts[%d]=%02x\n",xx,yy,mask,ofs,fxs->fonts[ofs]);
-				if (fxs->fonts[ofs] & mask) {
+				//if(_DEBUG_)printf("xx=%d yy=%d mask=%02x fonts[%d]=%02x\n",xx,yy,mask,ofs,fonts[ofs]);
+				if (fonts[ofs] & mask) {
 					lcdDrawPixel(dev, xx, yy, color);
 				} else {
 					//if (dev->_font_fill) lcdDrawPixel(dev, xx, yy, dev->_font_fill_color);
@@ -916,42 +1811,55 @@ int lcdDrawCode(TFT_t * dev, FontxFile *fx, uint16_t x,uint16_t y,uint8_t code,u
 	return 0;
 }
 
-#if 0
+// Draw SJIS character
+// Single byte codes are drawn with the ANK font, double byte codes with
+// the Kanji font of fx.
+// x:X coordinate
+// y:Y coordinate
+// sjis:SJIS code
+// color:color
+int lcdDrawSJISChar(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, uint16_t sjis, uint16_t color) {
+	unsigned char pw, ph;
+	int next = lcdDrawScaledCode(dev, fx, x, y, sjis, color);
+	if (next < 0) next = lcdDrawTurnedCode(dev, fx, x, y, sjis, color);
+	if (next >= 0) return next;
+	if (!GetFontxCode(fx, sjis, &pw, &ph)) return 0;
+	return lcdDrawGlyph(dev, fx->fonts, pw, ph, x, y, color);
+}
+
 // Draw UTF8 character
 // x:X coordinate
 // y:Y coordinate
 // utf8:UTF8 code
 // color:color
 int lcdDrawUTF8Char(TFT_t * dev, FontxFile *fx, uint16_t x,uint16_t y,uint8_t *utf8,uint16_t color) {
-	uint16_t sjis[1];
-
-	sjis[0] = UTF2SJIS(utf8);
-	if(_DEBUG_)printf("sjis=%04x\n",sjis[0]);
-	return lcdDrawSJISChar(dev, fx, x, y, sjis[0], color);
+	uint8_t length;
+	uint16_t sjis = UTF2SJIS(DecodeUTF8(utf8, &length));
+	if(_DEBUG_)printf("sjis=%04x\n",sjis);
+	return lcdDrawSJISChar(dev, fx, x, y, sjis, color);
 }
 
 // Draw UTF8 string
+// Characters SJIS does not have are skipped.
 // x:X coordinate
 // y:Y coordinate
 // utfs:UTF8 string
 // color:color
 int lcdDrawUTF8String(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, unsigned char *utfs, uint16_t color) {
-
-	int i;
-	int spos;
-	uint16_t sjis[64];
-	spos = String2SJIS(utfs, strlen((char *)utfs), sjis, 64);
-	if(_DEBUG_)printf("spos=%d\n",spos);
-	for(i=0;i<spos;i++) {
-		if(_DEBUG_)printf("sjis[%d]=%x y=%d\n",i,sjis[i],y);
+	while (*utfs) {
+		uint8_t length;
+		uint16_t sjis = UTF2SJIS(DecodeUTF8(utfs, &length));
+		utfs += length;
+		if (sjis == 0) continue;
+		if(_DEBUG_)printf("sjis=%x x=%d y=%d\n",sjis,x,y);
 		if (dev->_font_direction == 0)
-			x = lcdDrawSJISChar(dev, fx, x, y, sjis[i], color);
+			x = lcdDrawSJISChar(dev, fx, x, y, sjis, color);
 		if (dev->_font_direction == 1)
-			y = lcdDrawSJISChar(dev, fx, x, y, sjis[i], color);
+			y = lcdDrawSJISChar(dev, fx, x, y, sjis, color);
 		if (dev->_font_direction == 2)
-			x = lcdDrawSJISChar(dev, fx, x, y, sjis[i], color);
+			x = lcdDrawSJISChar(dev, fx, x, y, sjis, color);
 		if (dev->_font_direction == 3)
-			y = lcdDrawSJISChar(dev, fx, x, y, sjis[i], color);
+			y = lcdDrawSJISChar(dev, fx, x, y, sjis, color);
 	}
 	if (dev->_font_direction == 0) return x;
 	if (dev->_font_direction == 2) return x;
@@ -959,7 +1867,6 @@ int lcdDrawUTF8String(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, unsign
 	if (dev->_font_direction == 3) return y;
 	return 0;
 }
-#endif
 
 // Set font direction
 // dir:Direction
@@ -991,6 +1898,23 @@ void lcdUnsetFontUnderLine(TFT_t * dev) {
 	dev->_font_underline = false;
 }
 
+// Set font scale
+// Characters of lcdDrawChar, lcdDrawString and lcdDrawSJISChar are drawn
+// scale times larger. Fill, underline and direction apply as before.
+// scale:1 to 4, 1 draws the font size
+// smooth:Cut the steps of diagonal edges
+void lcdSetFontScale(TFT_t * dev, uint8_t scale, bool smooth) {
+	if (scale < 1) scale = 1;
+	if (scale > 4) scale = 4;
+	dev->_font_scale = scale;
+	dev->_font_smooth = smooth;
+	if (scale == 1) {
+		free(dev->_font_scaled);
+		dev->_font_scaled = NULL;
+		dev->_font_scaled_size = 0;
+	}
+}
+
 // Backlight OFF
 void lcdBacklightOff(TFT_t * dev) {
 	if(dev->_bl >= 0) {
@@ -1015,59 +1939,163 @@ void lcdInversionOn(TFT_t * dev) {
 	spi_master_write_command(dev, 0x21); // Display Inversion On
 }
 
-void lcdWrapArround(TFT_t * dev, SCROLL_TYPE_t scroll, int start, int end) {
-	if (dev->_use_frame_buffer == false) return;
-	
-	int _width = dev->_width;
-	int _height = dev->_height;
-	int32_t index1;
-	int32_t index2;
-
-	if (scroll == SCROLL_RIGHT) {
-		uint16_t wk[_width];
-		for (int i=start;i<end;i++) {
-			index1 = i * _width;
-			memcpy((char *)wk, (char*)&dev->_frame_buffer[index1], _width*2);
-			index2 = index1 + _width - 1;
-			dev->_frame_buffer[index1] = dev->_frame_buffer[index2];
-			memcpy((char *)&dev->_frame_buffer[index1+1], (char *)&wk[0], (_width-1)*2);
-		}
-	} else if (scroll == SCROLL_LEFT) {
-		uint16_t wk[_width];
-		for (int i=start;i<end;i++) {
-			index1 = i * _width;
-			memcpy((char *)wk, (char*)&dev->_frame_buffer[index1], _width*2);
-			index2 = index1 + _width - 1;
-			dev->_frame_buffer[index2] = dev->_frame_buffer[index1];
-			memcpy((char *)&dev->_frame_buffer[index1], (char *)&wk[1], (_width-1)*2);
+// Clip rectangle to the screen
+static bool lcdClipRect(TFT_t * dev, int *x1, int *y1, int *x2, int *y2) {
+	if (*x1 < 0) *x1 = 0;
+	if (*y1 < 0) *y1 = 0;
+	if (*x2 >= dev->_width) *x2 = dev->_width-1;
+	if (*y2 >= dev->_height) *y2 = dev->_height-1;
+	return (*x1 <= *x2 && *y1 <= *y2);
+}
+
+// Move rectangular area
+// Source and destination may overlap. The source area keeps its pixels
+// where it is not covered by the destination.
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+// x:Destination X coordinate
+// y:Destination Y coordinate
+void lcdMoveRect(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x, int16_t y) {
+	if (dev->_use_frame_buffer == false) {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+		return;
+	}
+
+	// Clip the source, then the destination
+	int sx1 = x1, sy1 = y1, sx2 = x2, sy2 = y2;
+	if (!lcdClipRect(dev, &sx1, &sy1, &sx2, &sy2)) return;
+	int dx = x - x1;
+	int dy = y - y1;
+	int dx1 = sx1 + dx, dy1 = sy1 + dy, dx2 = sx2 + dx, dy2 = sy2 + dy;
+	if (!lcdClipRect(dev, &dx1, &dy1, &dx2, &dy2)) return;
+	sx1 = dx1 - dx;
+	sy1 = dy1 - dy;
+	if (dx == 0 && dy == 0) return;
+	if (dev->_mono) {
+		monoMoveRect(dev, sx1, sy1, dx1, dy1, dx2 - dx1 + 1, dy2 - dy1 + 1);
+		return;
+	}
+
+	size_t size = (dx2 - dx1 + 1) * sizeof(uint16_t);
+	int rows = dy2 - dy1 + 1;
+	int stride = dev->_stride;
+	uint16_t *src = &dev->_frame_buffer[sy1*stride+sx1];
+	uint16_t *dst = &dev->_frame_buffer[dy1*stride+dx1];
+	if (dy > 0) {
+		// Moving down, copy from the bottom row
+		src += (rows-1) * stride;
+		dst += (rows-1) * stride;
+		stride = -stride;
+	}
+	for (int j = 0; j < rows; j++) {
+		memmove(dst, src, size);
+		src += stride;
+		dst += stride;
+	}
+}
+
+// Scroll rectangular area with wrap around
+// Pixels leaving one side of the area come back on the other side.
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+// scroll:Direction
+// n:Number of pixels
+void lcdScrollRect(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, SCROLL_TYPE_t scroll, uint16_t n) {
+	if (dev->_use_frame_buffer == false) {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+		return;
+	}
+
+	int _x1 = x1, _y1 = y1, _x2 = x2, _y2 = y2;
+	if (!lcdClipRect(dev, &_x1, &_y1, &_x2, &_y2)) return;
+	int w = _x2 - _x1 + 1;
+	int h = _y2 - _y1 + 1;
+	if (dev->_mono) {
+		monoScrollRect(dev, _x1, _y1, w, h, scroll, n);
+		return;
+	}
+	int stride = dev->_stride;
+	uint16_t *base = &dev->_frame_buffer[_y1*stride+_x1];
+
+	if (scroll == SCROLL_RIGHT || scroll == SCROLL_LEFT) {
+		n %= w;
+		if (n == 0) return;
+		// Rotate left by k is the same as rotate right by w-k
+		int k = (scroll == SCROLL_RIGHT) ? w - n : n;
+		uint16_t wk[k];
+		for (int j = 0; j < h; j++) {
+			uint16_t *row = base + j * stride;
+			memcpy(wk, row, k * sizeof(uint16_t));
+			memmove(row, row + k, (w - k) * sizeof(uint16_t));
+			memcpy(row + w - k, wk, k * sizeof(uint16_t));
 		}
-	} else if (scroll == SCROLL_UP) {
-		uint16_t wk;
-		for (int i=start;i<=end;i++) {
-			wk = dev->_frame_buffer[i];
-			for (int j=0;j<_height-1;j++) {
-				index1 = j * _width + i;
-				index2 = (j+1) * _width + i;
-				dev->_frame_buffer[index1] = dev->_frame_buffer[index2];
-			}
-			index2 = (_height-1) * _width + i;
-			dev->_frame_buffer[index2] = wk;
+	} else if (scroll == SCROLL_UP || scroll == SCROLL_DOWN) {
+		n %= h;
+		if (n == 0) return;
+		// Move whole rows along each rotation cycle, so every row is
+		// copied once through a single row buffer
+		int k = (scroll == SCROLL_UP) ? n : h - n;
+		int a = h, b = k;
+		while (b) {
+			int t = a % b; a = b; b = t;
 		}
-	} else if (scroll == SCROLL_DOWN) {
-		uint16_t wk;
-		for (int i=start;i<=end;i++) {
-			index2 = (_height-1) * _width + i;
-			wk = dev->_frame_buffer[index2];
-			for (int j=_height-2;j>=0;j--) {
-				index1 = j * _width + i;
-				index2 = (j+1) * _width + i;
-				dev->_frame_buffer[index2] = dev->_frame_buffer[index1];
+		size_t size = w * sizeof(uint16_t);
+		uint16_t wk[w];
+		for (int start = 0; start < a; start++) {
+			memcpy(wk, base + start * stride, size);
+			int j = start;
+			while (1) {
+				int next = j + k;
+				if (next >= h) next -= h;
+				if (next == start) break;
+				memcpy(base + j * stride, base + next * stride, size);
+				j = next;
 			}
-			dev->_frame_buffer[i] = wk;
+			memcpy(base + j * stride, wk, size);
 		}
 	}
 }
 
+// Scroll whole rows or columns by one pixel with wrap around
+// scroll:Direction
+// start:First row(SCROLL_RIGHT/LEFT) or column(SCROLL_UP/DOWN)
+// end:Last row + 1(SCROLL_RIGHT/LEFT) or last column(SCROLL_UP/DOWN)
+void lcdWrapArround(TFT_t * dev, SCROLL_TYPE_t scroll, int start, int end) {
+	if (dev->_use_frame_buffer == false) return;
+
+	if (scroll == SCROLL_RIGHT || scroll == SCROLL_LEFT) {
+		if (start >= end) return;
+		lcdScrollRect(dev, 0, start, dev->_width-1, end-1, scroll, 1);
+	} else {
+		if (start > end) return;
+		lcdScrollRect(dev, start, 0, end, dev->_height-1, scroll, 1);
+	}
+}
+
+// Define vertical scroll area of the panel
+// Rows count in the frame memory of the panel, which has
+// LCD_MEMORY_HEIGHT rows whatever the screen height.
+// top:Fixed rows above the area
+// area:Rows that scroll, the rest below is fixed
+void lcdSetScrollArea(TFT_t * dev, uint16_t top, uint16_t area) {
+	if (top + area > LCD_MEMORY_HEIGHT) area = LCD_MEMORY_HEIGHT - top;
+	spi_master_write_command(dev, 0x33);	// Vertical Scrolling Definition
+	spi_master_write_data_word(dev, top);
+	spi_master_write_data_word(dev, area);
+	spi_master_write_data_word(dev, LCD_MEMORY_HEIGHT - top - area);
+}
+
+// Show the scroll area starting from a frame memory row
+// line:Frame memory row shown at the top of the area
+void lcdSetScrollStart(TFT_t * dev, uint16_t line) {
+	spi_master_write_command(dev, 0x37);	// Vertical Scroll Start Address
+	spi_master_write_data_word(dev, line);
+}
+
 // Invert a rectangular area
 // x1:Start X coordinate
 // y1:Start Y coordinate
@@ -1082,11 +2110,14 @@ void lcdInversionArea(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16
 
 	int index = 0;
 	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
-	if (dev->_use_frame_buffer) {
+	if (dev->_mono) {
+		if (save) lcdGetRect(dev, x1, y1, x2, y2, save);
+		if (x1 <= x2) monoInvertRect(dev, x1, y1, x2, y2);
+	} else if (dev->_use_frame_buffer) {
 		for (int16_t j = y1; j <= y2; j++){
 			for(int16_t i = x1; i <= x2; i++){
-				if (save) save[index++] = dev->_frame_buffer[j*dev->_width+i];
-				dev->_frame_buffer[j*dev->_width+i] = ~dev->_frame_buffer[j*dev->_width+i];
+				if (save) save[index++] = dev->_frame_buffer[j*dev->_stride+i];
+				dev->_frame_buffer[j*dev->_stride+i] = ~dev->_frame_buffer[j*dev->_stride+i];
 			}
 		}
 	} else {
@@ -1105,14 +2136,20 @@ void lcdGetRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
 	if (x2 >= dev->_width) x2=dev->_width-1;
 	if (y1 >= dev->_height) return;
 	if (y2 >= dev->_height) y2=dev->_height-1;
+	if (x1 > x2 || y1 > y2) return;
 
-	int index = 0;
 	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
-	if (dev->_use_frame_buffer) {
+	if (dev->_mono) {
+		size_t w = x2 - x1 + 1;
 		for (int16_t j = y1; j <= y2; j++){
-			for(int16_t i = x1; i <= x2; i++){
-				save[index++] = dev->_frame_buffer[j*dev->_width+i];
-			}
+			monoExpandRow(dev, save, x1, j, w);
+			save += w;
+		}
+	} else if (dev->_use_frame_buffer) {
+		size_t w = x2 - x1 + 1;
+		for (int16_t j = y1; j <= y2; j++){
+			memcpy(save, &dev->_frame_buffer[j*dev->_stride+x1], w * sizeof(uint16_t));
+			save += w;
 		}
 	} else {
 		ESP_LOGW(TAG,"Disable frame buffer");
@@ -1130,14 +2167,18 @@ void lcdSetRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
 	if (x2 >= dev->_width) x2=dev->_width-1;
 	if (y1 >= dev->_height) return;
 	if (y2 >= dev->_height) y2=dev->_height-1;
+	if (x1 > x2 || y1 > y2) return;
 
-	int index = 0;
 	ESP_LOGD(TAG,"offset(x)=%d offset(y)=%d",dev->_offsetx,dev->_offsety);
-	if (dev->_use_frame_buffer) {
+	if (dev->_mono) {
 		for (int16_t j = y1; j <= y2; j++){
-			for(int16_t i = x1; i <= x2; i++){
-				dev->_frame_buffer[j*dev->_width+i] = save[index++];
-			}
+			for (int16_t i = x1; i <= x2; i++) monoSetPixel(dev, i, j, *save++);
+		}
+	} else if (dev->_use_frame_buffer) {
+		size_t w = x2 - x1 + 1;
+		for (int16_t j = y1; j <= y2; j++){
+			memcpy(&dev->_frame_buffer[j*dev->_stride+x1], save, w * sizeof(uint16_t));
+			save += w;
 		}
 	} else {
 		ESP_LOGW(TAG,"Disable frame buffer");
@@ -1159,26 +2200,307 @@ void lcdResetCursor(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t r, uint16_t
 	//lcdDrawCircle(dev, x0, y0, r, color);
 }
 
-// Draw Frame Buffer
-void lcdDrawFinish(TFT_t *dev)
+// Create off-screen surface
+// The pixel buffer is allocated from heap.
+// w:Width of surface
+// h:Height of surface
+bool lcdCreateSurface(SURFACE_t * surface, uint16_t w, uint16_t h) {
+	uint16_t *buffer = heap_caps_malloc(sizeof(uint16_t)*w*h, MALLOC_CAP_DEFAULT);
+	if (buffer == NULL) {
+		ESP_LOGE(TAG, "heap_caps_malloc fail. Surface is not available.");
+		return false;
+	}
+	lcdInitSurface(surface, buffer, w, h, w);
+	surface->allocated = true;
+	return true;
+}
+
+// Initialize surface over an existing pixel buffer
+// buffer:Pixel buffer
+// w:Width of surface
+// h:Height of surface
+// stride:Pixels from one row to the next
+void lcdInitSurface(SURFACE_t * surface, uint16_t *buffer, uint16_t w, uint16_t h, uint16_t stride) {
+	surface->buffer = buffer;
+	surface->stride = stride;
+	surface->width = w;
+	surface->height = h;
+	surface->format = SURFACE_RGB565;
+	surface->allocated = false;
+}
+
+// Delete surface
+void lcdDeleteSurface(SURFACE_t * surface) {
+	if (surface->allocated) free(surface->buffer);
+	surface->buffer = NULL;
+	surface->allocated = false;
+}
+
+// Set render target
+// All primitives and text functions draw into the surface until the
+// target is reset with surface=NULL.
+// surface:Off-screen surface, or NULL for the screen
+void lcdSetTarget(TFT_t * dev, SURFACE_t * surface) {
+	if (dev->_target == NULL) {
+		// Save screen
+		dev->_screen.buffer = dev->_frame_buffer;
+		dev->_screen.stride = dev->_stride;
+		dev->_screen.width = dev->_width;
+		dev->_screen.height = dev->_height;
+		dev->_screen_use_frame_buffer = dev->_use_frame_buffer;
+	}
+	if (surface == NULL) surface = &dev->_screen;
+	dev->_frame_buffer = surface->buffer;
+	dev->_stride = surface->stride;
+	dev->_width = surface->width;
+	dev->_height = surface->height;
+	if (surface == &dev->_screen) {
+		dev->_use_frame_buffer = dev->_screen_use_frame_buffer;
+		dev->_mono = (dev->_mono_buffer != NULL);
+		dev->_target = NULL;
+	} else {
+		dev->_use_frame_buffer = true;
+		dev->_mono = false;
+		dev->_target = surface;
+	}
+}
+
+// Copy surface to the render target
+// surface:Off-screen surface
+// x:Start X coordinate
+// y:Start Y coordinate
+void lcdBlitSurface(TFT_t * dev, SURFACE_t * surface, uint16_t x, uint16_t y) {
+	lcdBlitSurfaceRect(dev, surface, 0, 0, surface->width, surface->height, x, y);
+}
+
+// Copy part of surface to the render target
+// surface:Off-screen surface
+// sx:Start X coordinate in surface
+// sy:Start Y coordinate in surface
+// w:Width of area
+// h:Height of area
+// x:Start X coordinate
+// y:Start Y coordinate
+void lcdBlitSurfaceRect(TFT_t * dev, SURFACE_t * surface, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, uint16_t x, uint16_t y) {
+	if (sx >= surface->width) return;
+	if (sy >= surface->height) return;
+	if (sx + w > surface->width) w = surface->width - sx;
+	if (sy + h > surface->height) h = surface->height - sy;
+	if (!lcdClipImage(dev, x, y, &w, &h)) return;
+
+	const uint16_t *src = &surface->buffer[sy*surface->stride+sx];
+	if (dev->_mono) {
+		for (int16_t j = 0; j < h; j++){
+			for (int16_t i = 0; i < w; i++) monoSetPixel(dev, x+i, y+j, src[j*surface->stride+i]);
+		}
+	} else if (dev->_use_frame_buffer) {
+		for (int16_t j = 0; j < h; j++){
+			memmove(&dev->_frame_buffer[(y+j)*dev->_stride+x], &src[j*surface->stride], w*2);
+		}
+	} else {
+		uint16_t _x1 = x + dev->_offsetx;
+		uint16_t _x2 = _x1 + (w-1);
+		uint16_t _y1 = y + dev->_offsety;
+		uint16_t _y2 = _y1 + (h-1);
+
+		spi_master_write_command(dev, 0x2A);	// set column(x) address
+		spi_master_write_addr(dev, _x1, _x2);
+		spi_master_write_command(dev, 0x2B);	// set Page(y) address
+		spi_master_write_addr(dev, _y1, _y2);
+		spi_master_write_command(dev, 0x2C);	// Memory Write
+		for (int16_t j = 0; j < h; j++){
+			for (uint16_t i = 0; i < w; i += 512) {
+				uint16_t bs = (w - i > 512) ? 512 : w - i;
+				spi_master_write_colors(dev, (uint16_t *)&src[j*surface->stride+i], bs);
+			}
+		}
+	}
+}
+
+// Set cursor sprite
+// The cursor is an overlay. It is composited into the outgoing pixel data
+// and never written into the frame buffer.
+// sprite:w*h colors
+// hotx:Hot spot X offset in sprite
+// hoty:Hot spot Y offset in sprite
+// transparent:Color key of transparent pixel
+void lcdSetCursorSprite(TFT_t * dev, const uint16_t *sprite, uint16_t w, uint16_t h, uint16_t hotx, uint16_t hoty, uint16_t transparent) {
+	bool visible = dev->_cursor.visible;
+	if (visible) lcdHideCursor(dev);
+	dev->_cursor.sprite = sprite;
+	dev->_cursor.w = w;
+	dev->_cursor.h = h;
+	dev->_cursor.hotx = hotx;
+	dev->_cursor.hoty = hoty;
+	dev->_cursor.transparent = transparent;
+	if (visible) lcdShowCursor(dev, dev->_cursor.x, dev->_cursor.y);
+}
+
+// Get cursor rectangle on screen
+// Return false when cursor is outside of screen
+static bool lcdCursorRect(TFT_t * dev, int16_t x, int16_t y, uint16_t *x1, uint16_t *y1, uint16_t *x2, uint16_t *y2) {
+	int _x1 = x - dev->_cursor.hotx;
+	int _y1 = y - dev->_cursor.hoty;
+	int _x2 = _x1 + dev->_cursor.w - 1;
+	int _y2 = _y1 + dev->_cursor.h - 1;
+	if (_x1 < 0) _x1 = 0;
+	if (_y1 < 0) _y1 = 0;
+	if (_x2 >= dev->_width) _x2 = dev->_width - 1;
+	if (_y2 >= dev->_height) _y2 = dev->_height - 1;
+	if (_x1 > _x2 || _y1 > _y2) return false;
+	*x1 = _x1;
+	*y1 = _y1;
+	*x2 = _x2;
+	*y2 = _y2;
+	return true;
+}
+
+// Show cursor
+// x:Hot spot X coordinate
+// y:Hot spot Y coordinate
+void lcdShowCursor(TFT_t * dev, int16_t x, int16_t y) {
+	if (dev->_cursor.sprite == NULL) return;
+	if (dev->_use_frame_buffer == false) {
+		ESP_LOGW(TAG,"To use this feature, enable the FrameBuffer option.");
+		return;
+	}
+	dev->_cursor.visible = true;
+	dev->_cursor.x = x;
+	dev->_cursor.y = y;
+	uint16_t x1, y1, x2, y2;
+	if (lcdCursorRect(dev, x, y, &x1, &y1, &x2, &y2))
+		lcdDrawFinishRect(dev, x1, y1, x2, y2);
+}
+
+// Hide cursor
+void lcdHideCursor(TFT_t * dev) {
+	if (dev->_cursor.visible == false) return;
+	dev->_cursor.visible = false;
+	uint16_t x1, y1, x2, y2;
+	if (lcdCursorRect(dev, dev->_cursor.x, dev->_cursor.y, &x1, &y1, &x2, &y2))
+		lcdDrawFinishRect(dev, x1, y1, x2, y2);
+}
+
+// Move cursor
+// Only the old and new cursor rectangles are sent to the panel.
+// x:Hot spot X coordinate
+// y:Hot spot Y coordinate
+void lcdMoveCursor(TFT_t * dev, int16_t x, int16_t y) {
+	if (dev->_cursor.visible == false) {
+		lcdShowCursor(dev, x, y);
+		return;
+	}
+	if (dev->_cursor.x == x && dev->_cursor.y == y) return;
+
+	uint16_t ox1, oy1, ox2, oy2;
+	uint16_t nx1, ny1, nx2, ny2;
+	bool old = lcdCursorRect(dev, dev->_cursor.x, dev->_cursor.y, &ox1, &oy1, &ox2, &oy2);
+	dev->_cursor.x = x;
+	dev->_cursor.y = y;
+	bool new = lcdCursorRect(dev, x, y, &nx1, &ny1, &nx2, &ny2);
+
+	if (old && new && ox1 <= nx2 && nx1 <= ox2 && oy1 <= ny2 && ny1 <= oy2) {
+		// Overlapping rectangles go out as one window
+		lcdDrawFinishRect(dev, (ox1 < nx1) ? ox1 : nx1, (oy1 < ny1) ? oy1 : ny1,
+			(ox2 > nx2) ? ox2 : nx2, (oy2 > ny2) ? oy2 : ny2);
+		return;
+	}
+	if (old) lcdDrawFinishRect(dev, ox1, oy1, ox2, oy2);
+	if (new) lcdDrawFinishRect(dev, nx1, ny1, nx2, ny2);
+}
+
+// Composite cursor into one row of outgoing pixel data
+// line:Colors of x1..x2 on row y
+static void lcdComposeCursor(TFT_t * dev, uint16_t *line, uint16_t x1, uint16_t x2, uint16_t y) {
+	int cx = dev->_cursor.x - dev->_cursor.hotx;
+	int cy = dev->_cursor.y - dev->_cursor.hoty;
+	int row = y - cy;
+	if (row < 0 || row >= dev->_cursor.h) return;
+	int i1 = (cx > x1) ? cx : x1;
+	int i2 = cx + dev->_cursor.w - 1;
+	if (i2 > x2) i2 = x2;
+	const uint16_t *sprite = &dev->_cursor.sprite[row * dev->_cursor.w];
+	uint16_t transparent = dev->_cursor.transparent;
+	for (int i = i1; i <= i2; i++) {
+		if (sprite[i - cx] != transparent) line[i - x1] = sprite[i - cx];
+	}
+}
+
+// Draw rectangle area of Frame Buffer
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+void lcdDrawFinishRect(TFT_t *dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 {
 	if (dev->_use_frame_buffer == false) return;
+	if (dev->_target != NULL) {
+		ESP_LOGW(TAG,"Reset render target before drawing frame buffer.");
+		return;
+	}
+	if (x1 >= dev->_width) return;
+	if (x2 >= dev->_width) x2=dev->_width-1;
+	if (y1 >= dev->_height) return;
+	if (y2 >= dev->_height) y2=dev->_height-1;
 
 	spi_master_write_command(dev, 0x2A); // set column(x) address
-	spi_master_write_addr(dev, dev->_offsetx, dev->_offsetx+dev->_width-1);
+	spi_master_write_addr(dev, dev->_offsetx+x1, dev->_offsetx+x2);
 	spi_master_write_command(dev, 0x2B); // set Page(y) address
-	spi_master_write_addr(dev, dev->_offsety, dev->_offsety+dev->_height-1);
+	spi_master_write_addr(dev, dev->_offsety+y1, dev->_offsety+y2);
 	spi_master_write_command(dev, 0x2C); // Memory Write
 
-	//uint16_t size = dev->_width*dev->_height;
-	uint32_t size = dev->_width*dev->_height;
-	uint16_t *image = dev->_frame_buffer;
-	while (size > 0) {
-		// 1024 bytes per time.
-		uint16_t bs = (size > 1024) ? 1024 : size;
-		spi_master_write_colors(dev, image, bs);
-		size -= bs;
-		image += bs;
-	}
-	return;
+	// spi_master_write_colors sends up to 512 colors per time.
+	uint16_t line[512];
+	uint16_t w = x2 - x1 + 1;
+	int cy1 = dev->_cursor.y - dev->_cursor.hoty;
+	int cy2 = cy1 + dev->_cursor.h - 1;
+	bool cursor = dev->_cursor.visible;
+	if (w == dev->_width && w <= 512) {
+		// Full rows are contiguous
+		uint16_t rows = 512 / w;
+		for (uint16_t y = y1; y <= y2; y += rows) {
+			uint16_t n = (y2 - y + 1 < rows) ? y2 - y + 1 : rows;
+			uint16_t *image = line;
+			if (dev->_mono) {
+				for (uint16_t j = 0; j < n; j++) {
+					monoExpandRow(dev, &line[j*w], 0, y+j, w);
+				}
+			} else {
+				image = &dev->_frame_buffer[y*dev->_stride];
+			}
+			if (cursor && y <= cy2 && y+n-1 >= cy1) {
+				if (image != line) memcpy(line, image, n*w*2);
+				for (uint16_t j = 0; j < n; j++) {
+					lcdComposeCursor(dev, &line[j*w], x1, x2, y+j);
+				}
+				image = line;
+			}
+			spi_master_write_colors(dev, image, n*w);
+		}
+	} else {
+		for (uint16_t y = y1; y <= y2; y++) {
+			for (uint16_t x = x1; x <= x2; x += 512) {
+				uint16_t n = (x2 - x + 1 < 512) ? x2 - x + 1 : 512;
+				uint16_t *image = line;
+				if (dev->_mono) {
+					monoExpandRow(dev, line, x, y, n);
+				} else {
+					image = &dev->_frame_buffer[y*dev->_stride+x];
+				}
+				if (cursor && y >= cy1 && y <= cy2) {
+					if (image != line) memcpy(line, image, n*2);
+					lcdComposeCursor(dev, line, x, x+n-1, y);
+					image = line;
+				}
+				spi_master_write_colors(dev, image, n);
+			}
+		}
+	}
+}
+
+// Draw Frame Buffer
+void lcdDrawFinish(TFT_t *dev)
+{
+	if (dev->_use_frame_buffer == false) return;
+	lcdDrawFinishRect(dev, 0, 0, dev->_width-1, dev->_height-1);
 }
@@ -3,6 +3,10 @@
 
 #include "driver/spi_master.h"
 #include "fontx.h"
+#include "blend.h"
+
+// Rows of panel frame memory
+#define LCD_MEMORY_HEIGHT 320
 
 #define rgb565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
 
@@ -25,6 +29,55 @@ typedef enum {
 	SCROLL_UP = 4,
 } SCROLL_TYPE_t;
 
+typedef struct {
+	int16_t x;
+	int16_t y;
+} POINT_t;
+
+typedef struct {
+	int16_t x1;
+	int16_t y1;
+	int16_t x2;
+	int16_t y2;
+} RECT_t;
+
+typedef enum {
+	JOIN_MITER,
+	JOIN_BEVEL,
+	JOIN_ROUND,
+} JOIN_t;
+
+typedef enum {
+	CAP_BUTT,
+	CAP_SQUARE,
+	CAP_ROUND,
+} CAP_t;
+
+typedef enum {
+	SURFACE_RGB565 = 0,
+} SURFACE_FORMAT_t;
+
+typedef struct {
+	uint16_t *buffer;
+	uint16_t stride;
+	uint16_t width;
+	uint16_t height;
+	SURFACE_FORMAT_t format;
+	bool allocated;
+} SURFACE_t;
+
+typedef struct {
+	const uint16_t *sprite;
+	uint16_t w;
+	uint16_t h;
+	uint16_t hotx;
+	uint16_t hoty;
+	uint16_t transparent;
+	int16_t x;
+	int16_t y;
+	bool visible;
+} CURSOR_t;
+
 typedef struct {
 	uint16_t _width;
 	uint16_t _height;
@@ -35,13 +88,40 @@ typedef struct {
 	uint16_t _font_fill_color;
 	uint16_t _font_underline;
 	uint16_t _font_underline_color;
+	uint8_t _font_scale;
+	bool _font_smooth;
+	uint8_t *_font_scaled;		// Scaled glyph of lcdDrawChar
+	uint16_t _font_scaled_size;
 	int16_t _dc;
 	int16_t _bl;
 	spi_device_handle_t _SPIHandle;
 	bool _use_frame_buffer;
 	uint16_t *_frame_buffer;
+	uint16_t _stride;
+	CURSOR_t _cursor;
+	SURFACE_t *_target;
+	SURFACE_t _screen;
+	bool _screen_use_frame_buffer;
+	bool _mono;
+	uint8_t *_mono_buffer;
+	uint16_t _mono_stride;
+	uint16_t _mono_fg;
+	uint16_t _mono_bg;
+	uint16_t *_mono_lut;
 } TFT_t;
 
+// Text of lcdDrawGlyphRuns
+typedef struct {
+	int16_t x;
+	int16_t y;
+	const uint8_t *text;
+	uint16_t color;
+} GLYPH_RUN_t;
+
+// Span callback of the polygon rasterizer
+// Fill pixels x1..x2 on row y.
+typedef void (*SPAN_FUNC)(TFT_t * dev, int16_t x1, int16_t x2, int16_t y, void *ctx);
+
 void spi_clock_speed(int speed);
 void spi_master_init(TFT_t * dev, int16_t GPIO_MOSI, int16_t GPIO_SCLK, int16_t GPIO_CS, int16_t GPIO_DC, int16_t GPIO_RESET, int16_t GPIO_BL);
 bool spi_master_write_byte(spi_device_handle_t SPIHandle, const uint8_t* Data, size_t DataLength);
@@ -57,10 +137,17 @@ void lcdInit(TFT_t * dev, int width, int height, int offsetx, int offsety);
 void lcdDrawPixel(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color);
 void lcdDrawMultiPixels(TFT_t * dev, uint16_t x, uint16_t y, uint16_t size, uint16_t * colors);
 void lcdDrawFillRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+void lcdDrawPixelAlpha(TFT_t * dev, uint16_t x, uint16_t y, uint16_t color, uint8_t alpha);
+void lcdDrawFillRectAlpha(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, uint8_t alpha);
+void lcdDrawBitmapAlpha(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *colors, uint8_t alpha);
+void lcdDrawAlphaMask(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *mask, uint8_t bpp, uint16_t color);
+void lcdDrawBitmapMask(TFT_t * dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *colors, const uint8_t *mask, uint8_t bpp);
 void lcdDrawFillSquare(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t size, uint16_t color);
 void lcdDisplayOff(TFT_t * dev);
 void lcdDisplayOn(TFT_t * dev);
 void lcdFillScreen(TFT_t * dev, uint16_t color);
+void lcdDrawHLine(TFT_t * dev, uint16_t x1, uint16_t x2, uint16_t y, uint16_t color);
+void lcdDrawVLine(TFT_t * dev, uint16_t x, uint16_t y1, uint16_t y2, uint16_t color);
 void lcdDrawLine(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
 void lcdDrawRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
 void lcdDrawRectAngle(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t w, uint16_t h, uint16_t angle, uint16_t color);
@@ -71,26 +158,61 @@ void lcdDrawFillCircle(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t r, uint16
 void lcdDrawRoundRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t r, uint16_t color);
 void lcdDrawArrow(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t w, uint16_t color);
 void lcdDrawFillArrow(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t w, uint16_t color);
+void lcdDrawFillPolygon(TFT_t * dev, const POINT_t *points, uint16_t n, uint16_t color);
+void lcdDrawPolyline(TFT_t * dev, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, CAP_t cap, uint16_t color);
+void lcdDrawPolygon(TFT_t * dev, const POINT_t *points, uint16_t n, uint16_t width, JOIN_t join, uint16_t color);
+void lcdDrawThickLine(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t width, CAP_t cap, uint16_t color);
+void lcdDrawQuadBezier(TFT_t * dev, const POINT_t *points, uint16_t width, CAP_t cap, uint16_t color);
+void lcdDrawCubicBezier(TFT_t * dev, const POINT_t *points, uint16_t width, CAP_t cap, uint16_t color);
+void lcdDrawArc(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t r, int16_t start, int16_t end, uint16_t width, CAP_t cap, uint16_t color);
+void lcdDrawFillPie(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t r, int16_t start, int16_t end, uint16_t color);
+void lcdDrawFillAnnulus(TFT_t * dev, uint16_t xc, uint16_t yc, uint16_t r1, uint16_t r2, int16_t start, int16_t end, uint16_t color);
 int lcdDrawChar(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, uint8_t ascii, uint16_t color);
+int lcdDrawGlyph(TFT_t * dev, const uint8_t *fonts, uint8_t pw, uint8_t ph, uint16_t x, uint16_t y, uint16_t color);
 int lcdDrawString(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, uint8_t * ascii, uint16_t color);
 int lcdDrawCode(TFT_t * dev, FontxFile *fx, uint16_t x,uint16_t y,uint8_t code,uint16_t color);
-//int lcdDrawUTF8Char(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, uint8_t *utf8, uint16_t color);
-//int lcdDrawUTF8String(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, unsigned char *utfs, uint16_t color);
+int lcdDrawSJISChar(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, uint16_t sjis, uint16_t color);
+int lcdDrawUTF8Char(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, uint8_t *utf8, uint16_t color);
+int lcdDrawUTF8String(TFT_t * dev, FontxFile *fx, uint16_t x, uint16_t y, unsigned char *utfs, uint16_t color);
+void lcdDrawPixels(TFT_t * dev, const POINT_t *points, const uint16_t *colors, uint16_t n, uint16_t color);
+void lcdDrawFillRects(TFT_t * dev, const RECT_t *rects, const uint16_t *colors, uint16_t n, uint16_t color);
+void lcdDrawLines(TFT_t * dev, const RECT_t *lines, const uint16_t *colors, uint16_t n, uint16_t color);
+void lcdDrawGlyphRuns(TFT_t * dev, FontxFile *fx, const GLYPH_RUN_t *runs, uint16_t n);
 void lcdSetFontDirection(TFT_t * dev, uint16_t);
 void lcdSetFontFill(TFT_t * dev, uint16_t color);
 void lcdUnsetFontFill(TFT_t * dev);
 void lcdSetFontUnderLine(TFT_t * dev, uint16_t color);
 void lcdUnsetFontUnderLine(TFT_t * dev);
+void lcdSetFontScale(TFT_t * dev, uint8_t scale, bool smooth);
+uint8_t lcdGetFontScale(TFT_t * dev, uint8_t pw, uint8_t ph);
+const uint8_t *lcdGetScaledGlyph(TFT_t * dev, FontxFile *fx, uint16_t code, uint8_t *pw, uint8_t *ph);
 void lcdBacklightOff(TFT_t * dev);
 void lcdBacklightOn(TFT_t * dev);
 void lcdInversionOff(TFT_t * dev);
 void lcdInversionOn(TFT_t * dev);
+void lcdMoveRect(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x, int16_t y);
+void lcdScrollRect(TFT_t * dev, int16_t x1, int16_t y1, int16_t x2, int16_t y2, SCROLL_TYPE_t scroll, uint16_t n);
 void lcdWrapArround(TFT_t * dev, SCROLL_TYPE_t scroll, int start, int end);
+void lcdSetScrollArea(TFT_t * dev, uint16_t top, uint16_t area);
+void lcdSetScrollStart(TFT_t * dev, uint16_t line);
 void lcdInversionArea(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t *save);
 void lcdGetRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t *save);
 void lcdSetRect(TFT_t * dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t *save);
 void lcdSetCursor(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t r, uint16_t color, uint16_t *save);
 void lcdResetCursor(TFT_t * dev, uint16_t x0, uint16_t y0, uint16_t r, uint16_t color, uint16_t *save);
+void lcdSetCursorSprite(TFT_t * dev, const uint16_t *sprite, uint16_t w, uint16_t h, uint16_t hotx, uint16_t hoty, uint16_t transparent);
+void lcdShowCursor(TFT_t * dev, int16_t x, int16_t y);
+void lcdHideCursor(TFT_t * dev);
+void lcdMoveCursor(TFT_t * dev, int16_t x, int16_t y);
+bool lcdCreateSurface(SURFACE_t * surface, uint16_t w, uint16_t h);
+void lcdInitSurface(SURFACE_t * surface, uint16_t *buffer, uint16_t w, uint16_t h, uint16_t stride);
+void lcdDeleteSurface(SURFACE_t * surface);
+void lcdSetTarget(TFT_t * dev, SURFACE_t * surface);
+void lcdBlitSurface(TFT_t * dev, SURFACE_t * surface, uint16_t x, uint16_t y);
+void lcdBlitSurfaceRect(TFT_t * dev, SURFACE_t * surface, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, uint16_t x, uint16_t y);
+bool lcdInitMono(TFT_t * dev, uint16_t fg, uint16_t bg);
+void lcdSetMonoColor(TFT_t * dev, uint16_t fg, uint16_t bg);
+void lcdDrawFinishRect(TFT_t *dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void lcdDrawFinish(TFT_t *dev);
 #endif /* MAIN_ST7789_H_ */
 
@@ -0,0 +1,323 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "st7789.h"
+#include "blend.h"
+#include "text.h"
+
+#define TAG "TEXT"
+
+// Glyph size of the font GetFontx draws from, scaled as lcdDrawChar
+static bool textFont(TFT_t * dev, FontxFile *fx, uint8_t *pw, uint8_t *ph) {
+	for (int i = 0; i < 2; i++) {
+		if (!OpenFontx(&fx[i])) continue;
+		if (!fx[i].is_ank) continue;
+		uint8_t scale = lcdGetFontScale(dev, fx[i].w, fx[i].h);
+		*pw = fx[i].w * scale;
+		*ph = fx[i].h * scale;
+		return (*pw > 0 && *ph > 0);
+	}
+	return false;
+}
+
+// Measure string drawn with lcdDrawString
+// Glyphs of FONTX fonts all have the same width.
+// height:Glyph height, may be NULL
+// Returns width in pixels
+uint16_t lcdMeasureString(TFT_t * dev, FontxFile *fx, const uint8_t *ascii, uint8_t *height) {
+	uint8_t pw, ph;
+	if (!textFont(dev, fx, &pw, &ph)) return 0;
+	if (height) *height = ph;
+	return strlen((const char *)ascii) * pw;
+}
+
+// Break text into lines of a w*h box
+// lines:Lines found
+// max:Size of lines
+// Returns the number of lines
+uint8_t lcdLayoutText(TFT_t * dev, FontxFile *fx, const uint8_t *text, uint16_t w, uint16_t h, TEXT_ALIGN_t align, TEXT_LINE_t *lines, uint8_t max) {
+	uint8_t pw, ph;
+	if (!textFont(dev, fx, &pw, &ph)) return 0;
+	uint16_t cols = w / pw;
+	uint16_t rows = h / ph;
+	if (rows > max) rows = max;
+	if (cols == 0) return 0;
+
+	uint8_t n = 0;
+	uint16_t i = 0;
+	while (text[i] && n < rows) {
+		uint16_t start = i;
+		uint16_t length = 0;
+		int word_end = -1;
+		while (text[i]) {
+			uint8_t c = text[i];
+			if (c == '\n') {
+				i++;
+				break;
+			}
+			if (length == cols) {
+				// Wrap at the last space, or break a long word
+				if (c != ' ' && word_end > 0) {
+					length = word_end;
+					i = start + word_end;
+				}
+				while (text[i] == ' ') i++;
+				if (text[i] == '\n') i++;
+				break;
+			}
+			if (c == ' ') word_end = length;
+			length++;
+			i++;
+		}
+		while (length > 0 && text[start + length - 1] == ' ') length--;
+
+		TEXT_LINE_t *line = &lines[n++];
+		line->start = start;
+		line->length = length;
+		line->x = 0;
+		if (align == TEXT_CENTER) line->x = (w - length * pw) / 2;
+		if (align == TEXT_RIGHT) line->x = w - length * pw;
+	}
+	return n;
+}
+
+// Measure height of text wrapped to width w
+uint16_t lcdMeasureTextBox(TFT_t * dev, FontxFile *fx, const uint8_t *text, uint16_t w) {
+	uint8_t pw, ph;
+	if (!textFont(dev, fx, &pw, &ph)) return 0;
+	TEXT_LINE_t lines[TEXT_MAX_LINES];
+	return lcdLayoutText(dev, fx, text, w, UINT16_MAX, TEXT_LEFT, lines, TEXT_MAX_LINES) * ph;
+}
+
+// Draw lines of a layout, horizontal whatever the font direction
+static void textDrawLines(TFT_t * dev, FontxFile *fx, int16_t x, int16_t y, uint8_t ph, const uint8_t *text, const TEXT_LINE_t *lines, uint8_t n, uint16_t color) {
+	uint16_t direction = dev->_font_direction;
+	dev->_font_direction = DIRECTION0;
+	for (uint8_t k = 0; k < n; k++) {
+		uint8_t buf[lines[k].length + 1];
+		memcpy(buf, &text[lines[k].start], lines[k].length);
+		buf[lines[k].length] = 0;
+		lcdDrawString(dev, fx, x + lines[k].x, y + (k + 1) * ph - 1, buf, color);
+	}
+	dev->_font_direction = direction;
+}
+
+// Draw text wrapped in a box
+// Lines that do not fit in the box are not drawn.
+// x1:Start X coordinate
+// y1:Start Y coordinate
+// x2:End X coordinate
+// y2:End Y coordinate
+// align:TEXT_LEFT, TEXT_CENTER or TEXT_RIGHT
+// color:color
+// Returns the Y coordinate below the last line
+uint16_t lcdDrawTextBox(TFT_t * dev, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, const uint8_t *text, TEXT_ALIGN_t align, uint16_t color) {
+	uint8_t pw, ph;
+	if (x1 > x2 || y1 > y2 || !textFont(dev, fx, &pw, &ph)) return y1;
+	TEXT_LINE_t lines[TEXT_MAX_LINES];
+	uint8_t n = lcdLayoutText(dev, fx, text, x2 - x1 + 1, y2 - y1 + 1, align, lines, TEXT_MAX_LINES);
+	textDrawLines(dev, fx, x1, y1, ph, text, lines, n, color);
+	return y1 + n * ph;
+}
+
+// Initialize label cache
+// size:Number of labels kept
+bool lcdTextCacheInit(TEXT_CACHE_t *cache, uint16_t size) {
+	memset(cache, 0, sizeof(TEXT_CACHE_t));
+	cache->labels = calloc(size, sizeof(TEXT_LABEL_t));
+	if (cache->labels == NULL) {
+		ESP_LOGE(TAG, "Error allocating label cache.");
+		return false;
+	}
+	cache->size = size;
+	return true;
+}
+
+static void textFreeLabel(TEXT_LABEL_t *label) {
+	free(label->text);
+	free(label->mask);
+	lcdDeleteSurface(&label->surface);
+	memset(label, 0, sizeof(TEXT_LABEL_t));
+}
+
+// Forget all labels
+// Call after changing the contents of a font.
+void lcdTextCacheClear(TEXT_CACHE_t *cache) {
+	for (uint16_t i = 0; i < cache->size; i++) textFreeLabel(&cache->labels[i]);
+}
+
+// Free label cache
+void lcdTextCacheDelete(TEXT_CACHE_t *cache) {
+	lcdTextCacheClear(cache);
+	free(cache->labels);
+	cache->labels = NULL;
+	cache->size = 0;
+}
+
+static uint32_t textHash(const uint8_t *text) {
+	uint32_t hash = 2166136261U;
+	while (*text) hash = (hash ^ *text++) * 16777619U;
+	return hash;
+}
+
+static bool textMatch(const TEXT_LABEL_t *label, const TFT_t * dev, FontxFile *fx, const uint8_t *text, uint32_t hash,
+		uint16_t box_w, uint16_t box_h, uint8_t align, uint16_t color) {
+	if (label->text == NULL) return false;
+	if (label->hash != hash || label->fx != fx) return false;
+	if (label->box_w != box_w || label->box_h != box_h || label->align != align) return false;
+	if (label->color != color) return false;
+	if (label->fill != (dev->_font_fill != 0) || label->underline != (dev->_font_underline != 0)) return false;
+	if (label->fill && label->fill_color != dev->_font_fill_color) return false;
+	if (label->scale != dev->_font_scale || label->smooth != dev->_font_smooth) return false;
+	if (label->underline && label->underline_color != dev->_font_underline_color) return false;
+	return strcmp((const char *)label->text, (const char *)text) == 0;
+}
+
+// Rasterize label
+// Filled labels are drawn into a surface with the font state of dev,
+// transparent ones become a 1-bpp glyph mask.
+static bool textRender(TFT_t * dev, TEXT_LABEL_t *label, FontxFile *fx, const uint8_t *text, uint8_t pw, uint8_t ph) {
+	if (label->fill) {
+		if (!lcdCreateSurface(&label->surface, label->w, label->h)) return false;
+		SURFACE_t *target = dev->_target;
+		lcdSetTarget(dev, &label->surface);
+		textDrawLines(dev, fx, -label->x, 0, ph, text, label->lines, label->nlines, label->color);
+		lcdSetTarget(dev, target);
+		return true;
+	}
+
+	uint16_t stride = (label->w + 7) / 8;
+	label->mask = calloc((size_t)stride * label->h, 1);
+	if (label->mask == NULL) return false;
+	uint16_t bpr = (pw + 7) / 8;
+	for (uint8_t k = 0; k < label->nlines; k++) {
+		const TEXT_LINE_t *line = &label->lines[k];
+		for (uint16_t c = 0; c < line->length; c++) {
+			uint8_t gw, gh;
+			const uint8_t *fonts = lcdGetScaledGlyph(dev, fx, text[line->start + c], &gw, &gh);
+			if (fonts == NULL || gw != pw || gh != ph) continue;
+			int x0 = line->x - label->x + c * pw;
+			for (int h = 0; h < ph; h++) {
+				const uint8_t *row = &fonts[h * bpr];
+				uint8_t *dst = &label->mask[(k * ph + h) * stride];
+				for (int i = 0; i < pw; i++) {
+					if (row[i >> 3] & (0x80 >> (i & 7))) dst[(x0 + i) >> 3] |= 0x80 >> ((x0 + i) & 7);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// Draw mask rows in the label color
+static void textDrawMask(TFT_t * dev, const TEXT_LABEL_t *label, int x, int y) {
+	uint16_t stride = (label->w + 7) / 8;
+	int i1 = (x + label->w > dev->_width) ? dev->_width - x : label->w;
+	if (i1 <= 0) return;
+	for (int j = 0; j < label->h; j++) {
+		int yy = y + j;
+		if (yy >= dev->_height) break;
+		const uint8_t *row = &label->mask[j * stride];
+		if (dev->_use_frame_buffer && !dev->_mono) {
+			rgb565BlendMask(&dev->_frame_buffer[yy * dev->_stride + x], label->color, row, 1, 0, i1);
+			continue;
+		}
+		int start = -1;
+		for (int i = 0; i <= i1; i++) {
+			bool on = (i < i1) && (row[i >> 3] & (0x80 >> (i & 7)));
+			if (on && start < 0) start = i;
+			if (!on && start >= 0) {
+				lcdDrawFillRect(dev, x + start, yy, x + i - 1, yy, label->color);
+				start = -1;
+			}
+		}
+	}
+}
+
+// Draw label bitmap with its top left corner of the box at x,y
+static void textDrawLabel(TFT_t * dev, const TEXT_LABEL_t *label, uint16_t x, uint16_t y, uint8_t pw) {
+	int bx = x + label->x;
+	if (label->mask) textDrawMask(dev, label, bx, y);
+	for (uint8_t k = 0; k < label->nlines; k++) {
+		const TEXT_LINE_t *line = &label->lines[k];
+		if (line->length == 0) continue;
+		int lx = x + line->x;
+		int ly = y + k * label->ph;
+		int w = line->length * pw;
+		if (label->mask) {
+			if (label->underline) lcdDrawFillRect(dev, lx, ly + label->ph - 2, lx + w - 1, ly + label->ph - 1, label->underline_color);
+			continue;
+		}
+		// One window per line
+		int sx = line->x - label->x;
+		int sy = k * label->ph;
+		lcdBlitSurfaceRect(dev, (SURFACE_t *)&label->surface, sx, sy, w, label->ph, lx, ly);
+	}
+}
+
+// Draw text wrapped in a box through the label cache
+// Same as lcdDrawTextBox. The first call lays out and rasterizes the
+// text, later calls with the same font, text, box size, color and font
+// state, scale included, only copy the bitmap.
+uint16_t lcdDrawLabel(TFT_t * dev, TEXT_CACHE_t *cache, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, const uint8_t *text, TEXT_ALIGN_t align, uint16_t color) {
+	uint8_t pw, ph;
+	if (x1 > x2 || y1 > y2 || !textFont(dev, fx, &pw, &ph)) return y1;
+	uint16_t box_w = x2 - x1 + 1;
+	uint16_t box_h = y2 - y1 + 1;
+	uint32_t hash = textHash(text);
+
+	cache->clock++;
+	TEXT_LABEL_t *label = &cache->labels[0];
+	for (uint16_t i = 0; i < cache->size; i++) {
+		TEXT_LABEL_t *l = &cache->labels[i];
+		if (textMatch(l, dev, fx, text, hash, box_w, box_h, align, color)) {
+			cache->hits++;
+			l->used = cache->clock;
+			textDrawLabel(dev, l, x1, y1, pw);
+			return y1 + l->nlines * ph;
+		}
+		if (l->used < label->used) label = l;
+	}
+	cache->misses++;
+	if (cache->size == 0) return lcdDrawTextBox(dev, fx, x1, y1, x2, y2, text, align, color);
+
+	textFreeLabel(label);
+	label->nlines = lcdLayoutText(dev, fx, text, box_w, box_h, align, label->lines, TEXT_MAX_LINES);
+	int left = box_w, right = 0;
+	for (uint8_t k = 0; k < label->nlines; k++) {
+		const TEXT_LINE_t *line = &label->lines[k];
+		if (line->length == 0) continue;
+		if (line->x < left) left = line->x;
+		if (line->x + line->length * pw > right) right = line->x + line->length * pw;
+	}
+	if (right <= left) return y1 + label->nlines * ph;
+
+	size_t length = strlen((const char *)text);
+	label->text = malloc(length + 1);
+	label->fx = fx;
+	label->hash = hash;
+	label->box_w = box_w;
+	label->box_h = box_h;
+	label->align = align;
+	label->color = color;
+	label->fill = (dev->_font_fill != 0);
+	label->fill_color = dev->_font_fill_color;
+	label->underline = (dev->_font_underline != 0);
+	label->underline_color = dev->_font_underline_color;
+	label->scale = dev->_font_scale;
+	label->smooth = dev->_font_smooth;
+	label->x = left;
+	label->w = right - left;
+	label->h = label->nlines * ph;
+	label->ph = ph;
+	label->used = cache->clock;
+	if (label->text == NULL || !textRender(dev, label, fx, text, pw, ph)) {
+		textFreeLabel(label);
+		return lcdDrawTextBox(dev, fx, x1, y1, x2, y2, text, align, color);
+	}
+	memcpy(label->text, text, length + 1);
+	textDrawLabel(dev, label, x1, y1, pw);
+	return y1 + label->nlines * ph;
+}
@@ -0,0 +1,74 @@
+#ifndef MAIN_TEXT_H_
+#define MAIN_TEXT_H_
+
+#include "st7789.h"
+
+// Text layout and label cache.
+// Text is laid out horizontally in a box: words wrap at spaces, words
+// wider than the box are broken, '\n' starts a new line. Lines are aligned
+// in the box and lines below the box are not drawn. Fill, underline and
+// scale follow the font state of TFT_t.
+// Labels are laid out and rasterized once. Filled labels keep their RGB565
+// pixels and are drawn back one window per line. Transparent labels keep a
+// 1-bpp mask of the glyphs and are drawn back in the text color, with the
+// underline as one rectangle per line.
+
+#define TEXT_MAX_LINES 32
+
+typedef enum {
+	TEXT_LEFT,
+	TEXT_CENTER,
+	TEXT_RIGHT,
+} TEXT_ALIGN_t;
+
+typedef struct {
+	uint16_t start;		// Offset of first character in the text
+	uint16_t length;	// Characters
+	int16_t x;		// Left edge from the box
+} TEXT_LINE_t;
+
+typedef struct {
+	// Key
+	FontxFile *fx;
+	uint8_t *text;
+	uint32_t hash;
+	uint16_t box_w;
+	uint16_t box_h;
+	uint8_t align;
+	uint8_t fill;
+	uint8_t underline;
+	uint16_t color;
+	uint16_t fill_color;
+	uint16_t underline_color;
+	uint8_t scale;
+	bool smooth;
+	// Bitmap
+	int16_t x;		// Left edge of bitmap from the box
+	uint16_t w;
+	uint16_t h;
+	uint8_t ph;
+	uint8_t nlines;
+	TEXT_LINE_t lines[TEXT_MAX_LINES];
+	SURFACE_t surface;	// Filled labels
+	uint8_t *mask;		// Transparent labels, (w + 7) / 8 bytes per row
+	uint32_t used;
+} TEXT_LABEL_t;
+
+typedef struct {
+	TEXT_LABEL_t *labels;
+	uint16_t size;
+	uint32_t clock;
+	uint32_t hits;
+	uint32_t misses;
+} TEXT_CACHE_t;
+
+uint16_t lcdMeasureString(TFT_t * dev, FontxFile *fx, const uint8_t *ascii, uint8_t *height);
+uint8_t lcdLayoutText(TFT_t * dev, FontxFile *fx, const uint8_t *text, uint16_t w, uint16_t h, TEXT_ALIGN_t align, TEXT_LINE_t *lines, uint8_t max);
+uint16_t lcdMeasureTextBox(TFT_t * dev, FontxFile *fx, const uint8_t *text, uint16_t w);
+uint16_t lcdDrawTextBox(TFT_t * dev, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, const uint8_t *text, TEXT_ALIGN_t align, uint16_t color);
+bool lcdTextCacheInit(TEXT_CACHE_t *cache, uint16_t size);
+void lcdTextCacheClear(TEXT_CACHE_t *cache);
+void lcdTextCacheDelete(TEXT_CACHE_t *cache);
+uint16_t lcdDrawLabel(TFT_t * dev, TEXT_CACHE_t *cache, FontxFile *fx, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, const uint8_t *text, TEXT_ALIGN_t align, uint16_t color);
+
+#endif /* MAIN_TEXT_H_ */
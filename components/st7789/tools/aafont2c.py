@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""Convert a FONTX or BDF font to an anti-aliased font in const C tables.
+
+Writes <name>.c and <name>.h. The header declares
+
+    extern const AAFONT_t <name>;
+
+which is drawn with lcdDrawAAString. The source font is drawn --scale
+times larger than the result: each block of scale*scale pixels becomes
+one pixel of 2 or 4 bits of coverage. Only the bounding box of each glyph
+is stored, identical glyphs share bitmaps. BDF glyphs advance by their
+DWIDTH, FONTX glyphs by the cell width. FONTX fonts have no baseline, it
+is put at the bottom of the cell.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+from fontx2c import read_bdf, read_fontx
+
+
+def coverage(cell, w, h, left, pad_top, scale, bpp):
+    """Return {(x, y): level} of one glyph cell, x from the pen, y from the top"""
+    bpr = (w + 7) // 8
+    counts = {}
+    for y in range(h):
+        for x in range(w):
+            if cell[y * bpr + x // 8] & (0x80 >> (x % 8)):
+                key = ((x + left) // scale, (y + pad_top) // scale)
+                counts[key] = counts.get(key, 0) + 1
+    levels = (1 << bpp) - 1
+    area = scale * scale
+    pixels = {}
+    for key, n in counts.items():
+        level = (n * levels + area // 2) // area
+        if level:
+            pixels[key] = level
+    return pixels
+
+
+def pack(pixels, bpp):
+    """Return (x, y, w, h, bytes) of the bounding box of pixels"""
+    if not pixels:
+        return 0, 0, 0, 0, b''
+    x0 = min(x for x, _ in pixels)
+    x1 = max(x for x, _ in pixels) + 1
+    y0 = min(y for _, y in pixels)
+    y1 = max(y for _, y in pixels) + 1
+    w = x1 - x0
+    per_byte = 8 // bpp
+    data = bytearray()
+    for y in range(y0, y1):
+        row = bytearray((w * bpp + 7) // 8)
+        for i in range(w):
+            level = pixels.get((x0 + i, y), 0)
+            row[i // per_byte] |= level << (8 - bpp * (i % per_byte + 1))
+        data += row
+    return x0, y0, w, y1 - y0, bytes(data)
+
+
+def convert(path, scale, bpp):
+    metrics = {}
+    if path.lower().endswith('.bdf'):
+        w, h, glyphs, first, count = read_bdf(path, metrics)
+        left = metrics['left']
+        descent = metrics['descent']
+    else:
+        w, h, glyphs, first, count = read_fontx(path)
+        left = 0
+        descent = 0
+    advances = metrics.get('advance', {})
+
+    # Put the baseline on a block boundary
+    ascent = h - descent
+    pad_top = -ascent % scale
+    height = (h + pad_top + scale - 1) // scale
+    result = []
+    for c in range(first, first + count):
+        pixels = coverage(glyphs[c], w, h, left, pad_top, scale, bpp)
+        advance = (advances.get(c, w) + scale // 2) // scale
+        x, y, gw, gh, data = pack(pixels, bpp)
+        if x < -128 or x > 127 or y > 127 or gw > 255 or gh > 255 or advance > 255:
+            sys.exit('%s: glyph %d too large' % (path, c))
+        result.append((x, y, gw, gh, advance, data))
+    return height, (ascent + pad_top) // scale, first, result
+
+
+def write(name, out_dir, bpp, height, ascent, first, glyphs):
+    offsets = {}
+    bitmaps = bytearray()
+    for g in glyphs:
+        data = g[5]
+        if data not in offsets:
+            offsets[data] = len(bitmaps)
+            bitmaps += data
+    if len(bitmaps) > 65535:
+        sys.exit('%s: more than 65535 bytes of bitmaps' % name)
+
+    with open(os.path.join(out_dir, name + '.h'), 'w') as f:
+        guard = 'MAIN_%s_H_' % name.upper()
+        f.write('// Generated by aafont2c.py, do not edit\n')
+        f.write('#ifndef %s\n#define %s\n\n' % (guard, guard))
+        f.write('#include "aafont.h"\n\n')
+        f.write('extern const AAFONT_t %s;\n\n' % name)
+        f.write('#endif /* %s */\n' % guard)
+
+    with open(os.path.join(out_dir, name + '.c'), 'w') as f:
+        f.write('// Generated by aafont2c.py, do not edit\n')
+        f.write('#include "%s.h"\n\n' % name)
+        f.write('static const uint8_t %s_bitmaps[%d] = {\n' % (name, max(len(bitmaps), 1)))
+        for i in range(0, len(bitmaps), 16):
+            f.write('\t' + ', '.join('0x%02x' % b for b in bitmaps[i:i + 16]) + ',\n')
+        if not bitmaps:
+            f.write('\t0,\n')
+        f.write('};\n\n')
+        f.write('static const AAFONT_GLYPH_t %s_glyphs[%d] = {\n' % (name, len(glyphs)))
+        for x, y, w, h, advance, data in glyphs:
+            f.write('\t{ %d, %d, %d, %d, %d, %d },\n' % (offsets[data], w, h, x, y, advance))
+        f.write('};\n\n')
+        f.write('const AAFONT_t %s = {\n' % name)
+        f.write('\t.name = "%s",\n' % name)
+        f.write('\t.bpp = %d,\n\t.height = %d,\n\t.ascent = %d,\n' % (bpp, height, ascent))
+        f.write('\t.first = %d,\n\t.count = %d,\n' % (first, len(glyphs)))
+        f.write('\t.glyphs = %s_glyphs,\n\t.bitmaps = %s_bitmaps,\n};\n' % (name, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('font', help='FONTX (.fnt) or BDF (.bdf) file')
+    parser.add_argument('--name', required=True, help='C name of the font')
+    parser.add_argument('--out-dir', default='.', help='directory of the generated files')
+    parser.add_argument('--bpp', type=int, choices=(2, 4), default=4, help='bits of coverage per pixel')
+    parser.add_argument('--scale', type=int, default=4, help='source pixels per result pixel in each direction')
+    args = parser.parse_args()
+    if not re.match(r'^[A-Za-z_][A-Za-z0-9_]*$', args.name):
+        sys.exit('%s: not a C identifier' % args.name)
+    if args.scale < 1:
+        sys.exit('scale must be at least 1')
+
+    font = convert(args.font, args.scale, args.bpp)
+    os.makedirs(args.out_dir, exist_ok=True)
+    write(args.name, args.out_dir, args.bpp, *font)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Convert a FONTX or BDF font to const C tables.
+
+Writes <name>.c and <name>.h. The header declares
+
+    extern const FONTX_FONT_t <name>_font;
+    extern FontxFile <name>[2];
+
+<name> can be passed to lcdDrawString and the other text functions as is.
+Only single byte (ANK) fonts are supported. BDF glyphs are placed in the
+FONTBOUNDINGBOX cell, so every glyph has the same width.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+def read_fontx(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < 17 or data[:6] != b'FONTX2':
+        sys.exit('%s: not FONTX format' % path)
+    w, h, code = data[14], data[15], data[16]
+    if code != 0:
+        sys.exit('%s: only ANK fonts are supported' % path)
+    fsz = (w + 7) // 8 * h
+    count = min(256, (len(data) - 17) // fsz)
+    glyphs = {c: data[17 + c * fsz:17 + (c + 1) * fsz] for c in range(count)}
+    return w, h, glyphs, 0, count
+
+
+def read_bdf(path, metrics=None):
+    """Read a BDF font.
+
+    If metrics is a dict, the left edge of the cell from the pen, the descent
+    of the font and the DWIDTH of each glyph are stored in metrics['left'],
+    metrics['descent'] and metrics['advance'].
+    """
+    w = h = bx = by = None
+    glyphs = {}
+    code = None
+    rows = None
+    with open(path, encoding='latin-1') as f:
+        for line in f:
+            words = line.split()
+            if not words:
+                continue
+            key = words[0]
+            if key == 'FONTBOUNDINGBOX':
+                w, h, bx, by = map(int, words[1:5])
+            elif key == 'STARTCHAR':
+                # Glyphs without BBX fill the font bounding box
+                gw, gh, gx, gy = w, h, bx, by
+            elif key == 'ENCODING':
+                code = int(words[1])
+            elif key == 'DWIDTH' and metrics is not None:
+                metrics.setdefault('advance', {})[code] = int(words[1])
+            elif key == 'BBX':
+                gw, gh, gx, gy = map(int, words[1:5])
+            elif key == 'BITMAP':
+                rows = []
+            elif key == 'ENDCHAR':
+                if 0 <= code < 256:
+                    glyphs[code] = bdf_glyph(rows, w, h, bx, by, gw, gh, gx, gy)
+                rows = None
+            elif rows is not None:
+                rows.append((int(key, 16), len(key) * 4))
+    if w is None or not glyphs:
+        sys.exit('%s: not BDF format' % path)
+    if metrics is not None:
+        metrics['left'] = bx
+        metrics['descent'] = -by
+    if w > 255 or h > 255:
+        sys.exit('%s: glyphs larger than 255 pixels' % path)
+    first = min(glyphs)
+    last = max(glyphs)
+    blank = bytes((w + 7) // 8 * h)
+    return w, h, {c: glyphs.get(c, blank) for c in range(first, last + 1)}, first, last - first + 1
+
+
+def bdf_glyph(rows, w, h, bx, by, gw, gh, gx, gy):
+    bpr = (w + 7) // 8
+    cell = bytearray(bpr * h)
+    top = (h + by) - (gy + gh)
+    left = gx - bx
+    for j, (bits, n) in enumerate(rows[:gh]):
+        y = top + j
+        if y < 0 or y >= h:
+            continue
+        for i in range(gw):
+            x = left + i
+            if 0 <= x < w and i < n and bits & (1 << (n - 1 - i)):
+                cell[y * bpr + x // 8] |= 0x80 >> (x % 8)
+    return bytes(cell)
+
+
+def write(name, out_dir, w, h, glyphs, first, count):
+    bitmaps = []
+    numbers = {}
+    index = []
+    for c in range(first, first + count):
+        g = glyphs[c]
+        if g not in numbers:
+            numbers[g] = len(bitmaps)
+            bitmaps.append(g)
+        index.append(numbers[g])
+
+    with open(os.path.join(out_dir, name + '.h'), 'w') as f:
+        guard = 'MAIN_%s_H_' % name.upper()
+        f.write('// Generated by fontx2c.py, do not edit\n')
+        f.write('#ifndef %s\n#define %s\n\n' % (guard, guard))
+        f.write('#include <stdio.h>\n#include <stdbool.h>\n#include <stdint.h>\n\n')
+        f.write('#include "fontx.h"\n\n')
+        f.write('extern const FONTX_FONT_t %s_font;\n' % name)
+        f.write('extern FontxFile %s[2];\n\n' % name)
+        f.write('#endif /* %s */\n' % guard)
+
+    with open(os.path.join(out_dir, name + '.c'), 'w') as f:
+        f.write('// Generated by fontx2c.py, do not edit\n')
+        f.write('#include "%s.h"\n\n' % name)
+        f.write('static const uint16_t %s_index[%d] = {\n' % (name, count))
+        for i in range(0, count, 16):
+            f.write('\t' + ', '.join('%d' % n for n in index[i:i + 16]) + ',\n')
+        f.write('};\n\n')
+        f.write('static const uint8_t %s_bitmaps[%d] = {\n' % (name, len(bitmaps) * len(bitmaps[0])))
+        for g in bitmaps:
+            f.write('\t' + ', '.join('0x%02x' % b for b in g) + ',\n')
+        f.write('};\n\n')
+        f.write('const FONTX_FONT_t %s_font = {\n' % name)
+        f.write('\t.name = "%s",\n' % name[:9])
+        f.write('\t.w = %d,\n\t.h = %d,\n\t.fsz = %d,\n' % (w, h, (w + 7) // 8 * h))
+        f.write('\t.first = %d,\n\t.count = %d,\n' % (first, count))
+        f.write('\t.index = %s_index,\n\t.bitmaps = %s_bitmaps,\n};\n\n' % (name, name))
+        f.write('FontxFile %s[2] = {\n' % name)
+        f.write('\tFONTX_FONT_FILE(%s_font, %d, %d),\n' % (name, w, h))
+        f.write('\tFONTX_NO_FILE,\n};\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('font', help='FONTX (.fnt) or BDF (.bdf) file')
+    parser.add_argument('--name', required=True, help='C name of the font')
+    parser.add_argument('--out-dir', default='.', help='directory of the generated files')
+    args = parser.parse_args()
+    if not re.match(r'^[A-Za-z_][A-Za-z0-9_]*$', args.name):
+        sys.exit('%s: not a C identifier' % args.name)
+
+    if args.font.lower().endswith('.bdf'):
+        font = read_bdf(args.font)
+    else:
+        font = read_fontx(args.font)
+    os.makedirs(args.out_dir, exist_ok=True)
+    write(args.name, args.out_dir, *font)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Generate the UTF8 to SJIS table of fontx.c.
+
+Writes utf8sjis.c from the cp932 and shift_jis codecs of Python. Code
+points from U+0080 to U+FFFF are grouped by their high byte: group h
+holds the entries utf8sjis_page[h]..utf8sjis_page[h+1]-1, sorted by the
+low byte in utf8sjis_low, with the SJIS code in utf8sjis_sjis. The
+private use area is left out.
+"""
+
+import argparse
+
+
+def table():
+    codes = {}
+    for u in range(0x80, 0x10000):
+        if 0xD800 <= u < 0xF900:
+            continue
+        for encoding in ('cp932', 'shift_jis'):
+            try:
+                b = chr(u).encode(encoding)
+            except UnicodeEncodeError:
+                continue
+            codes.setdefault(u, int.from_bytes(b, 'big'))
+    return codes
+
+
+def write(path, codes):
+    keys = sorted(codes)
+    page = [0] * 257
+    for u in keys:
+        page[(u >> 8) + 1] += 1
+    for h in range(256):
+        page[h + 1] += page[h]
+
+    with open(path, 'w') as f:
+        f.write('// Generated by utf8sjis.py, do not edit\n')
+        f.write('#include <stdint.h>\n\n')
+        f.write('// %d characters\n' % len(keys))
+        f.write('const uint16_t utf8sjis_page[257] = {\n')
+        for i in range(0, 257, 16):
+            f.write('\t' + ', '.join('%d' % n for n in page[i:i + 16]) + ',\n')
+        f.write('};\n\n')
+        f.write('const uint8_t utf8sjis_low[%d] = {\n' % len(keys))
+        for i in range(0, len(keys), 16):
+            f.write('\t' + ', '.join('0x%02x' % (u & 0xFF) for u in keys[i:i + 16]) + ',\n')
+        f.write('};\n\n')
+        f.write('const uint16_t utf8sjis_sjis[%d] = {\n' % len(keys))
+        for i in range(0, len(keys), 12):
+            f.write('\t' + ', '.join('0x%04x' % codes[u] for u in keys[i:i + 12]) + ',\n')
+        f.write('};\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--out', default='utf8sjis.c', help='generated file')
+    args = parser.parse_args()
+    write(args.out, table())
+
+
+if __name__ == '__main__':
+    main()
@@ -25,6 +25,8 @@
 
 #define CURSOR_COLOR GREEN
 #define CURSOR_CLICK_COLOR RED
+#define CURSOR_SIZE 24
+#define CURSOR_HOT 2
 
 const static char *TAG = "main";
 
@@ -114,6 +116,19 @@ void btn_cancel_handler(void *handler_args, esp_event_base_t base, int32_t id,
            state_info->state ? "PRESSED" : "RELEASED");
 }
 
+static uint16_t cursor_sprite[CURSOR_SIZE * CURSOR_SIZE];
+static uint16_t cursor_click_sprite[CURSOR_SIZE * CURSOR_SIZE];
+
+// Render the arrow once into the frame buffer corner and keep it as sprite.
+// BLACK is the transparent color key of the sprite.
+static void make_cursor_sprite(uint16_t *sprite, uint16_t color) {
+  lcdDrawFillRect(&dev, 0, 0, CURSOR_SIZE - 1, CURSOR_SIZE - 1, BLACK);
+  lcdDrawFillArrow(&dev, CURSOR_HOT + 14, CURSOR_HOT + 14, CURSOR_HOT,
+                   CURSOR_HOT, 6, color);
+  lcdGetRect(&dev, 0, 0, CURSOR_SIZE - 1, CURSOR_SIZE - 1, sprite);
+  lcdDrawFillRect(&dev, 0, 0, CURSOR_SIZE - 1, CURSOR_SIZE - 1, BLACK);
+}
+
 void ST7789(void *pvParameters) {
   // Change SPI Clock Frequency
   spi_clock_speed(40000000);  // 40MHz
@@ -123,17 +138,42 @@ void ST7789(void *pvParameters) {
                   CONFIG_DC_GPIO, CONFIG_RESET_GPIO, CONFIG_BL_GPIO);
   lcdInit(&dev, CONFIG_WIDTH, CONFIG_HEIGHT, CONFIG_OFFSETX, CONFIG_OFFSETY);
   lcdFillScreen(&dev, BLACK);
+
+  // The cursor overlay is composited from the frame buffer, without it the
+  // arrow is drawn on the panel directly
+  bool overlay = dev._use_frame_buffer;
+  if (overlay) {
+    make_cursor_sprite(cursor_sprite, CURSOR_COLOR);
+    make_cursor_sprite(cursor_click_sprite, CURSOR_CLICK_COLOR);
+  }
   lcdDrawFinish(&dev);
 
   int16_t x_pos = dev._width / 2;
   int16_t y_pos = dev._height / 2;
+  uint16_t sprite_color = CURSOR_COLOR;
+
+  if (overlay) {
+    lcdSetCursorSprite(&dev, cursor_sprite, CURSOR_SIZE, CURSOR_SIZE,
+                       CURSOR_HOT, CURSOR_HOT, BLACK);
+    lcdShowCursor(&dev, x_pos, y_pos);
+  }
 
   int counter = 0;
   int64_t time_start, delta_time;
   float fps;
   while (1) {
     time_start = esp_timer_get_time();
-    lcdDrawFillArrow(&dev, x_pos + 14, y_pos + 14, x_pos, y_pos, 6, BLACK);
+    if (!overlay) {
+      lcdDrawFillArrow(&dev, x_pos + 14, y_pos + 14, x_pos, y_pos, 6, BLACK);
+    }
+
+    if (overlay && sprite_color != cursor_color) {
+      sprite_color = cursor_color;
+      lcdSetCursorSprite(
+          &dev,
+          sprite_color == CURSOR_COLOR ? cursor_sprite : cursor_click_sprite,
+          CURSOR_SIZE, CURSOR_SIZE, CURSOR_HOT, CURSOR_HOT, BLACK);
+    }
 
     x_pos += x_spd * x_dir;
     y_pos += y_spd * y_dir;
@@ -150,11 +190,14 @@ void ST7789(void *pvParameters) {
       y_pos = dev._height - 1;
     }
 
-    lcdDrawFillArrow(&dev, x_pos + 14, y_pos + 14, x_pos, y_pos, 6,
-                     cursor_color);
-    lcdDrawFinish(&dev);
+    if (overlay) {
+      lcdMoveCursor(&dev, x_pos, y_pos);
+    } else {
+      lcdDrawFillArrow(&dev, x_pos + 14, y_pos + 14, x_pos, y_pos, 6,
+                       cursor_color);
+    }
 
-    // vTaskDelay(pdMS_TO_TICKS(16));
+    vTaskDelay(pdMS_TO_TICKS(16));
 
     counter++;
     if (counter == 100) {
@@ -169,40 +212,81 @@ void ST7789(void *pvParameters) {
   vTaskDelete(NULL);
 }
 
+typedef struct {
+  gpio_num_t pin;
+  esp_event_handler_t handler;
+} button_binding_t;
+
+static const button_binding_t button_bindings[] = {
+    {BUTTON_LEFT_GPIO, btn_left_handler},
+    {BUTTON_UP_GPIO, btn_up_handler},
+    {BUTTON_DOWN_GPIO, btn_down_handler},
+    {BUTTON_RIGHT_GPIO, btn_right_handler},
+    {BUTTON_CONFIRM_GPIO, btn_confirm_handler},
+    {BUTTON_CANCEL_GPIO, btn_cancel_handler},
+};
+
+#if CONFIG_BUTTON_EDGE_FIRST
+void keyboard_task(void *pvParameters) {
+  button_debounce_cfg debounce_cfg = {
+      .debounce_checks = DEBOUNCE_CHECKS,
+      .debounce_interval_ms = DEBOUNCE_INTERVAL_MS,
+  };
+
+  static button_t buttons[sizeof(button_bindings) / sizeof(button_bindings[0])];
+  for (int i = 0; i < sizeof(button_bindings) / sizeof(button_bindings[0]);
+       i++) {
+    button_t *btn = &buttons[i];
+    ESP_ERROR_CHECK(button_init(btn, button_bindings[i].pin, true));
+    ESP_ERROR_CHECK(button_set_pullmode(btn, GPIO_PULLUP_ONLY));
+    ESP_ERROR_CHECK(button_set_debounce_conf(btn, debounce_cfg));
+    ESP_ERROR_CHECK(button_set_debounce_mode(btn, BUTTON_DEBOUNCE_EDGE_FIRST));
+    ESP_ERROR_CHECK(
+        button_set_event_handler(btn, button_bindings[i].handler, NULL));
+  }
+
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+
+  // never reach here
+  vTaskDelete(NULL);
+}
+#else
+// Hand every button changed by a scan to its handler
+void btn_group_handler(void *handler_args, esp_event_base_t base, int32_t id,
+                       void *event_data) {
+  button_group_event_t *event = (button_group_event_t *)event_data;
+
+  for (int i = 0; i < sizeof(button_bindings) / sizeof(button_bindings[0]);
+       i++) {
+    gpio_num_t pin = button_bindings[i].pin;
+    if (!((event->changed >> pin) & 1)) continue;
+
+    button_state_info_t state_info = {
+        .state = (event->state >> pin) & 1,
+        .timestamp = event->timestamp,
+    };
+    button_bindings[i].handler(handler_args, base, pin, &state_info);
+  }
+}
+
 void keyboard_task(void *pvParameters) {
   button_debounce_cfg debounce_cfg = {
       .debounce_checks = DEBOUNCE_CHECKS,
       .debounce_interval_ms = DEBOUNCE_INTERVAL_MS,
   };
 
-  button_t btn_left, btn_up, btn_down, btn_right, btn_confirm, btn_cancel;
-  button_init(&btn_left, BUTTON_LEFT_GPIO, true);
-  button_init(&btn_up, BUTTON_UP_GPIO, true);
-  button_init(&btn_down, BUTTON_DOWN_GPIO, true);
-  button_init(&btn_right, BUTTON_RIGHT_GPIO, true);
-  button_init(&btn_confirm, BUTTON_CONFIRM_GPIO, true);
-  button_init(&btn_cancel, BUTTON_CANCEL_GPIO, true);
-
-  button_set_pullmode(&btn_left, GPIO_PULLUP_ONLY);
-  button_set_pullmode(&btn_up, GPIO_PULLUP_ONLY);
-  button_set_pullmode(&btn_down, GPIO_PULLUP_ONLY);
-  button_set_pullmode(&btn_right, GPIO_PULLUP_ONLY);
-  button_set_pullmode(&btn_confirm, GPIO_PULLUP_ONLY);
-  button_set_pullmode(&btn_cancel, GPIO_PULLUP_ONLY);
-
-  button_set_debounce_conf(&btn_left, debounce_cfg);
-  button_set_debounce_conf(&btn_up, debounce_cfg);
-  button_set_debounce_conf(&btn_down, debounce_cfg);
-  button_set_debounce_conf(&btn_right, debounce_cfg);
-  button_set_debounce_conf(&btn_confirm, debounce_cfg);
-  button_set_debounce_conf(&btn_cancel, debounce_cfg);
-
-  button_set_event_handler(&btn_left, btn_left_handler, NULL);
-  button_set_event_handler(&btn_up, btn_up_handler, NULL);
-  button_set_event_handler(&btn_down, btn_down_handler, NULL);
-  button_set_event_handler(&btn_right, btn_right_handler, NULL);
-  button_set_event_handler(&btn_confirm, btn_confirm_handler, NULL);
-  button_set_event_handler(&btn_cancel, btn_cancel_handler, NULL);
+  button_group_t buttons;
+  ESP_ERROR_CHECK(button_group_init(&buttons, debounce_cfg));
+  for (int i = 0; i < sizeof(button_bindings) / sizeof(button_bindings[0]);
+       i++) {
+    ESP_ERROR_CHECK(button_group_add(&buttons, button_bindings[i].pin, true,
+                                     GPIO_PULLUP_ONLY));
+  }
+  ESP_ERROR_CHECK(
+      button_group_set_event_handler(&buttons, btn_group_handler, NULL));
+  ESP_ERROR_CHECK(button_group_start(&buttons));
 
   while (1) {
     vTaskDelay(pdMS_TO_TICKS(10));
@@ -211,6 +295,7 @@ void keyboard_task(void *pvParameters) {
   // never reach here
   vTaskDelete(NULL);
 }
+#endif
 
 void app_main(void) {
   ESP_LOGI(TAG, "Hello, User!!:)");